@@ -74,13 +74,14 @@
 #include "dsda.h"
 #include "dsda/args.h"
 #include "dsda/analysis.h"
-#include "dsda/args.h"
+#include "dsda/batch.h"
 #include "dsda/endoom.h"
 #include "dsda/settings.h"
 #include "dsda/signal_context.h"
 #include "dsda/split_tracker.h"
 #include "dsda/text_file.h"
 #include "dsda/time.h"
+#include "dsda/video_segment.h"
 #include "dsda/wad_stats.h"
 #include "dsda/zipfile.h"
 
@@ -158,6 +159,7 @@ struct atexit_listentry_s
 
 static atexit_listentry_t *exit_funcs[exit_priority_max];
 static int exit_priority;
+static dboolean skip_exit_handlers;
 
 void I_AtExit(atexit_func_t func, dboolean run_on_error,
               const char* name, exit_priority_t priority)
@@ -173,10 +175,21 @@ void I_AtExit(atexit_func_t func, dboolean run_on_error,
     exit_funcs[priority] = entry;
 }
 
+void I_SkipExitHandlers(void)
+{
+  skip_exit_handlers = true;
+}
+
 void I_SafeExit(int rc)
 {
   atexit_listentry_t *entry;
 
+  if (skip_exit_handlers)
+  {
+    fflush(NULL);
+    _exit(rc);
+  }
+
   lprintf(LO_DEBUG, "\n"); // Separator after game loop
 
   // Run through all exit functions
@@ -205,6 +218,7 @@ static void I_EssentialQuit (void)
   }
   dsda_ExportTextFile();
   dsda_WriteAnalysis();
+  dsda_WriteBatchWorkerResult();
   dsda_WriteSplits();
   dsda_SaveWadStats();
   // We need to close out all wad handles/memory mappings before we can remove
@@ -280,6 +294,14 @@ int main(int argc, char **argv)
     return 0;
   }
 
+  // Play a demo manifest in worker processes instead of starting the game
+  if (dsda_BatchMode())
+    return dsda_RunBatch();
+
+  // Render -viddump segments in worker processes and join them
+  if (dsda_VideoSegmentMode())
+    return dsda_RunVideoSegments();
+
   // e6y: Check for conflicts.
   // Conflicting command-line parameters could cause the engine to be confused
   // in some cases. Added checks to prevent this.
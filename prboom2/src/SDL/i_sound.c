@@ -107,6 +107,9 @@ typedef struct
   int leftvol;
   int rightvol;
   dboolean loop;
+  // Lump locked for the channel data, plus one (0 if none).
+  // Released when the channel is reused.
+  int locked_lump;
 } channel_info_t;
 
 channel_info_t channelinfo[MAX_CHANNELS];
@@ -454,6 +457,7 @@ int I_StartSound(int id, int channel, sfx_params_t *params)
 {
   const unsigned char *data;
   int lump;
+  int old_lump;
   size_t len;
 
   if ((channel < 0) || (channel >= MAX_CHANNELS))
@@ -487,8 +491,15 @@ int I_StartSound(int id, int channel, sfx_params_t *params)
   addsfx(id, channel, data, len);
   updateSoundParams(channel, params);
 
+  // The mixer no longer refers to the previous sound on this channel
+  old_lump = channelinfo[channel].locked_lump;
+  channelinfo[channel].locked_lump = lump + 1;
+
   SDL_UnlockMutex (sfxmutex);
 
+  if (old_lump)
+    W_UnlockLumpNum(old_lump - 1);
+
 
   return channel;
 }
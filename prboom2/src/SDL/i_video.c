@@ -89,6 +89,7 @@
 #include "dsda/palette.h"
 #include "dsda/pause.h"
 #include "dsda/settings.h"
+#include "dsda/startup_profile.h"
 #include "dsda/time.h"
 #include "dsda/gl/render_scale.h"
 
@@ -426,6 +427,12 @@ void I_StartTic (void)
     dsda_PollGameController();
 }
 
+void I_PumpEvents (void)
+{
+  SDL_PumpEvents();
+  SDL_FlushEvents(SDL_KEYDOWN, SDL_MULTIGESTURE);
+}
+
 //
 // I_StartFrame
 //
@@ -1415,7 +1422,9 @@ void I_UpdateVideoMode(void)
     SDL_GL_GetAttribute( SDL_GL_STENCIL_SIZE, &temp );
     lprintf(LO_DEBUG, "    SDL_GL_STENCIL_SIZE: %i\n",temp);
 
+    dsda_StartupPhaseBegin(dsda_startup_opengl);
     gld_Init(SCREENWIDTH, SCREENHEIGHT);
+    dsda_StartupPhaseEnd(dsda_startup_opengl);
   }
 
   ST_SetResolution();
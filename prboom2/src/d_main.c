@@ -74,6 +74,7 @@
 #include "st_stuff.h"
 #include "am_map.h"
 #include "p_setup.h"
+#include "r_data.h"
 #include "r_draw.h"
 #include "r_main.h"
 #include "r_fps.h"
@@ -84,6 +85,7 @@
 #include "e6y.h"
 
 #include "dsda/args.h"
+#include "dsda/benchmark.h"
 #include "dsda/configuration.h"
 #include "dsda/demo.h"
 #include "dsda/exdemo.h"
@@ -93,18 +95,24 @@
 #include "dsda/data_organizer.h"
 #include "dsda/map_format.h"
 #include "dsda/mapinfo.h"
+#include "dsda/memory.h"
 #include "dsda/mobjinfo.h"
 #include "dsda/options.h"
 #include "dsda/pause.h"
 #include "dsda/playback.h"
 #include "dsda/preferences.h"
+#include "dsda/profiler.h"
 #include "dsda/render_stats.h"
 #include "dsda/settings.h"
 #include "dsda/signal_context.h"
 #include "dsda/skill_info.h"
 #include "dsda/skip.h"
 #include "dsda/sndinfo.h"
+#include "dsda/startup_cache.h"
+#include "dsda/startup_jobs.h"
+#include "dsda/startup_profile.h"
 #include "dsda/time.h"
+#include "dsda/tranmap.h"
 #include "dsda/utility.h"
 #include "dsda/wad_stats.h"
 #include "dsda/zipfile.h"
@@ -369,6 +377,9 @@ void D_Display (fixed_t frac)
   if (!I_StartDisplay())
     return;
 
+  dsda_BenchmarkFrameStart();
+  dsda_StartupPhaseBegin(dsda_startup_first_frame);
+
   if (setsizeneeded) {               // change the view size if needed
     R_ExecuteSetViewSize();
     oldgamestate = -1;            // force background redraw
@@ -458,7 +469,9 @@ void D_Display (fixed_t frac)
     R_InterpolateView(&players[displayplayer], frac);
 
     DSDA_ADD_CONTEXT(sf_player_view);
+    DSDA_PROFILE_BEGIN(dsda_profile_render);
     R_RenderPlayerView(&players[displayplayer]);
+    DSDA_PROFILE_END(dsda_profile_render);
     DSDA_REMOVE_CONTEXT(sf_player_view);
 
     dsda_UpdateRenderStats();
@@ -518,6 +531,9 @@ void D_Display (fixed_t frac)
     I_uSleep(5000);
   }
 
+  dsda_BenchmarkFrameEnd();
+  dsda_StartupPhaseEnd(dsda_startup_first_frame);
+
   dsda_LimitFPS();
 
   I_EndDisplay();
@@ -825,6 +841,7 @@ void D_AddFile (const char *file, wad_source_t source)
     AddDefaultExtension(strcpy(Z_Malloc(strlen(file)+5), file), ".wad");
   wadfiles[numwadfiles].src = source; // Ty 08/29/98
   wadfiles[numwadfiles].handle = 0;
+  wadfiles[numwadfiles].zip_member = 0;
 
   // No Rest For The Living
   len=strlen(wadfiles[numwadfiles].name);
@@ -844,6 +861,7 @@ void D_AddFile (const char *file, wad_source_t source)
     wadfiles[numwadfiles].name = gwa_filename;
     wadfiles[numwadfiles].src = source_pwad; // Ty 08/29/98
     wadfiles[numwadfiles].handle = 0;
+    wadfiles[numwadfiles].zip_member = 0;
     numwadfiles++;
   }
 }
@@ -1331,6 +1349,22 @@ static void LoadWADsAtPath(const char *path, wad_source_t source)
     I_EndGlob(glob);
 }
 
+static void LoadDehackedFile(const char *filename, dboolean defer_loading, deh_queue_t *deh_queue)
+{
+    if (deh_queue)
+    {
+        D_QueueAutoloadDeh(deh_queue, filename);
+    }
+    else if (defer_loading)
+    {
+        dsda_AppendStringArg(dsda_arg_deh, filename);
+    }
+    else
+    {
+        ProcessDehFile(filename, D_dehout(), 0);
+    }
+}
+
 static void LoadDehackedFilesAtPath(const char *path, dboolean defer_loading, deh_queue_t *deh_queue)
 {
     const char *filename;
@@ -1346,33 +1380,77 @@ static void LoadDehackedFilesAtPath(const char *path, dboolean defer_loading, de
             break;
         }
 
-        if (deh_queue)
-        {
-            D_QueueAutoloadDeh(deh_queue, filename);
-        }
-        else if (defer_loading)
-        {
-            dsda_AppendStringArg(dsda_arg_deh, filename);
-        }
-        else
-        {
-            ProcessDehFile(filename, D_dehout(), 0);
-        }
+        LoadDehackedFile(filename, defer_loading, deh_queue);
     }
 
     I_EndGlob(glob);
 }
 
+static void D_AddZipMember(int member, wad_source_t source)
+{
+  wadfiles = Z_Realloc(wadfiles, sizeof(*wadfiles)*(numwadfiles+1));
+  wadfiles[numwadfiles].name = Z_Strdup(dsda_ZipMemberPath(member));
+  wadfiles[numwadfiles].src = source;
+  wadfiles[numwadfiles].handle = 0;
+  wadfiles[numwadfiles].zip_member = member;
+  numwadfiles++;
+}
+
 static void D_AddZip(const char* zipped_file_name, wad_source_t source, deh_queue_t *deh_queue)
 {
+  int i;
+  int archive;
   char* full_zip_path;
-  const char* temporary_directory;
 
   full_zip_path = I_RequireZip(zipped_file_name);
-  temporary_directory = dsda_UnzipFile(full_zip_path);
+  archive = dsda_MountZip(full_zip_path);
 
-  LoadWADsAtPath(temporary_directory, source);
-  LoadDehackedFilesAtPath(temporary_directory, true, deh_queue);
+  if (archive < 0)
+  {
+    const char* temporary_directory;
+
+    temporary_directory = dsda_UnzipFile(full_zip_path);
+
+    LoadWADsAtPath(temporary_directory, source);
+    LoadDehackedFilesAtPath(temporary_directory, true, deh_queue);
+  }
+  else
+  {
+    // Same order as loading the extracted files: wads, then patches
+    for (i = 0; i < dsda_ZipMemberCount(archive); ++i)
+    {
+      int member = dsda_ZipMember(archive, i);
+      const char* name = dsda_ZipMemberPath(member);
+
+      if (dsda_HasFileExt(name, ".wad") || dsda_HasFileExt(name, ".lmp"))
+      {
+        D_AddZipMember(member, source);
+
+        if (dsda_HasFileExt(name, ".wad"))
+        {
+          dsda_string_t gwa_name;
+          int gwa_member;
+
+          dsda_InitString(&gwa_name, dsda_BaseName(name));
+          strcpy(gwa_name.string + strlen(gwa_name.string) - 4, ".gwa");
+          gwa_member = dsda_FindZipMember(archive, gwa_name.string);
+          dsda_FreeString(&gwa_name);
+
+          if (gwa_member)
+            D_AddZipMember(gwa_member, source_pwad);
+        }
+      }
+    }
+
+    for (i = 0; i < dsda_ZipMemberCount(archive); ++i)
+    {
+      int member = dsda_ZipMember(archive, i);
+      const char* name = dsda_ZipMemberPath(member);
+
+      if (dsda_HasFileExt(name, ".deh") || dsda_HasFileExt(name, ".bex"))
+        LoadDehackedFile(dsda_ExtractZipMember(member), true, deh_queue);
+    }
+  }
 
   Z_Free(full_zip_path);
 }
@@ -1649,6 +1727,12 @@ static void D_DoomMainSetup(void)
     I_SafeExit(0);
   }
 
+  arg = dsda_Arg(dsda_arg_startup_profile);
+  if (arg->found)
+    dsda_InitStartupProfile(arg->value.v_string);
+
+  dsda_StartupPhaseBegin(dsda_startup_setup);
+
   // figgi 09/18/00-- added switch to force classic bsp nodes
   if (dsda_Flag(dsda_arg_forceoldbsp))
     forceOldBsp = true;
@@ -1810,7 +1894,9 @@ static void D_DoomMainSetup(void)
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_DEBUG, "W_Init: Init WADfiles.\n");
+  dsda_StartupPhaseBegin(dsda_startup_wad_files);
   W_Init(); // CPhipps - handling of wadfiles init changed
+  dsda_StartupPhaseEnd(dsda_startup_wad_files);
 
   if (hexen)
   {
@@ -1826,10 +1912,16 @@ static void D_DoomMainSetup(void)
     }
   }
 
+  // The lump directory is final, so independent work can start
+  R_QueuePatchFormatJobs();
+  dsda_QueueTranMapJobs();
+
   lprintf(LO_DEBUG, "G_ReloadDefaults: Checking OPTIONS.\n");
   dsda_ParseOptionsLump();
   G_ReloadDefaults();
 
+  dsda_StartupPhaseBegin(dsda_startup_dehacked);
+
   // e6y
   // option to disable automatic loading of dehacked-in-wad lump
   if (!dsda_Flag(dsda_arg_nodeh))
@@ -1914,6 +2006,9 @@ static void D_DoomMainSetup(void)
 
   PostProcessDeh();
   dsda_AppendZDoomMobjInfo();
+
+  dsda_StartupPhaseEnd(dsda_startup_dehacked);
+
   dsda_ApplyDefaultMapFormat();
 
   lprintf(LO_DEBUG, "dsda_InitWadStats: Setting up wad stats.\n");
@@ -1925,26 +2020,42 @@ static void D_DoomMainSetup(void)
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_DEBUG, "M_Init: Init miscellaneous info.\n");
+  dsda_StartupPhaseBegin(dsda_startup_misc);
   M_Init();
+  dsda_StartupPhaseEnd(dsda_startup_misc);
 
+  dsda_StartupPhaseBegin(dsda_startup_sndinfo);
   dsda_LoadSndInfo();
 
   if (map_format.sndseq)
   {
     SN_InitSequenceScript();
   }
+  dsda_StartupPhaseEnd(dsda_startup_sndinfo);
+
+  // Sound names are final after dehacked and SNDINFO
+  dsda_QueueSoundLumpJobs();
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_DEBUG, "R_Init: Init DOOM refresh daemon - ");
+  dsda_StartupPhaseBegin(dsda_startup_renderer);
   R_Init();
+  dsda_StartupPhaseEnd(dsda_startup_renderer);
 
+  dsda_StartupPhaseBegin(dsda_startup_mapinfo);
   dsda_LoadWadPreferences();
   dsda_LoadMapInfo();
   dsda_InitSkills();
+  dsda_StartupPhaseEnd(dsda_startup_mapinfo);
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_DEBUG, "\nP_Init: Init Playloop state.\n");
+  dsda_StartupPhaseBegin(dsda_startup_playloop);
   P_Init();
+  dsda_StartupPhaseEnd(dsda_startup_playloop);
+
+  // Nothing reads the startup cache after this
+  dsda_SaveStartupCache();
 
   // Must be after P_Init
   HandleWarp();
@@ -1954,18 +2065,26 @@ static void D_DoomMainSetup(void)
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_DEBUG, "I_Init: Setting up machine state.\n");
+  dsda_StartupPhaseBegin(dsda_startup_system);
   I_Init();
+  dsda_StartupPhaseEnd(dsda_startup_system);
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_DEBUG, "S_Init: Setting up sound.\n");
+  dsda_StartupPhaseBegin(dsda_startup_sound);
   S_Init();
+  dsda_StartupPhaseEnd(dsda_startup_sound);
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_DEBUG, "dsda_InitFont: Loading the hud fonts.\n");
+  dsda_StartupPhaseBegin(dsda_startup_fonts);
   dsda_InitFont();
+  dsda_StartupPhaseEnd(dsda_startup_fonts);
 
+  dsda_StartupPhaseBegin(dsda_startup_graphics);
   if (!(dsda_Flag(dsda_arg_nodraw) && dsda_Flag(dsda_arg_nosound)))
     I_InitGraphics();
+  dsda_StartupPhaseEnd(dsda_startup_graphics);
 
   // NSM
   arg = dsda_Arg(dsda_arg_viddump);
@@ -1976,7 +2095,12 @@ static void D_DoomMainSetup(void)
 
   //jff 9/3/98 use logical output routine
   lprintf(LO_DEBUG, "ST_Init: Init status bar.\n");
+  dsda_StartupPhaseBegin(dsda_startup_status_bar);
   ST_Init();
+  dsda_StartupPhaseEnd(dsda_startup_status_bar);
+
+  // Everything started on the startup workers is in place before play
+  dsda_JoinStartupJobs();
 
   // start the appropriate game based on parms
 
@@ -2005,6 +2129,8 @@ static void D_DoomMainSetup(void)
   // do not try to interpolate during timedemo
   M_ChangeUncappedFrameRate();
 
+  dsda_StartupPhaseEnd(dsda_startup_setup);
+
   lprintf(LO_DEBUG, "\n"); // Separator after setup
 }
 
@@ -29,6 +29,7 @@
 
 #include "dsda/analysis.h"
 #include "dsda/args.h"
+#include "dsda/benchmark.h"
 #include "dsda/build.h"
 #include "dsda/demo.h"
 #include "dsda/exhud.h"
@@ -36,9 +37,12 @@
 #include "dsda/ghost.h"
 #include "dsda/key_frame.h"
 #include "dsda/mouse.h"
+#include "dsda/profiler.h"
 #include "dsda/settings.h"
 #include "dsda/split_tracker.h"
+#include "dsda/state_hash.h"
 #include "dsda/tracker.h"
+#include "dsda/video_segment.h"
 #include "dsda/wad_stats.h"
 #include "dsda.h"
 
@@ -174,6 +178,28 @@ void dsda_ReadCommandLine(void) {
   dsda_HandleTurbo();
   dsda_HandleBuild();
 
+  arg = dsda_Arg(dsda_arg_timedemo_report);
+  if (arg->found)
+    dsda_InitBenchmark(arg->value.v_string);
+
+  arg = dsda_Arg(dsda_arg_profile);
+  if (arg->found)
+    dsda_InitProfiler(arg->value.v_string);
+
+  arg = dsda_Arg(dsda_arg_hash_stream);
+  if (arg->found)
+    dsda_InitStateHashStream(arg->value.v_string);
+
+  arg = dsda_Arg(dsda_arg_hash_compare);
+  if (arg->found)
+    dsda_InitStateHashCompare(arg->value.v_string);
+
+  arg = dsda_Arg(dsda_arg_zone_stats);
+  if (arg->found)
+    Z_EnableStats(arg->value.v_string);
+
+  dsda_InitVideoSegments();
+
   arg = dsda_Arg(dsda_arg_import_ghost);
   if (arg->found)
     dsda_InitGhostImport(arg->value.v_string_array, arg->count);
@@ -385,6 +411,7 @@ int dsda_MaxKillRequirement() {
 
 void dsda_WatchPTickCompleted(void) {
   dsda_FlipLineActivationTracker();
+  dsda_StateHashTic();
 }
 
 void dsda_WatchCommand(void) {
@@ -417,6 +444,8 @@ void dsda_WatchCommand(void) {
 }
 
 void dsda_WatchBeforeLevelSetup(void) {
+  dsda_BenchmarkLevelSetupStart();
+
   dsda_100k_on_map = false;
   dsda_kills_on_map = 0;
   dsda_100k_note_shown = false;
@@ -428,6 +457,8 @@ void dsda_WatchAfterLevelSetup(void) {
   dsda_ResetTrackers();
   dsda_ResetLineActivationTracker();
   dsda_WadStatsEnterMap();
+  dsda_ProfilerNewMap();
+  dsda_BenchmarkNewMap();
   player_damage_last_tic = 0;
   player_damage_leveltime = 0;
 }
@@ -18,6 +18,8 @@
 #ifndef __DSDA_ANALYSIS__
 #define __DSDA_ANALYSIS__
 
+#include <stdio.h>
+
 #include "doomtype.h"
 
 extern int dsda_analysis;
@@ -49,6 +51,7 @@ extern dboolean dsda_100k_note_shown;
 extern dboolean dsda_pacifist_note_shown;
 
 void dsda_ResetAnalysis(void);
+void dsda_WriteAnalysisToStream(FILE* fstream);
 void dsda_WriteAnalysis(void);
 const char* dsda_DetectCategory(void);
 
@@ -88,6 +88,11 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "plays the given demo file as fast as possible, skipping some frames",
     arg_string,
   },
+  [dsda_arg_timedemo_report] = {
+    "-timedemo_report", NULL, NULL,
+    "writes frame and tic time percentiles and histograms (per map) to the given json file",
+    arg_string,
+  },
   [dsda_arg_record] = {
     "-record", NULL, NULL,
     "records a demo to the given file",
@@ -328,6 +333,76 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "writes level stats to levelstat.txt",
     arg_null,
   },
+  [dsda_arg_batch] = {
+    "-batch", NULL, NULL,
+    "plays the demos listed in the given manifest in parallel and writes a report",
+    arg_string,
+  },
+  [dsda_arg_batch_jobs] = {
+    "-batch_jobs", NULL, NULL,
+    "sets the number of parallel -batch workers (defaults to the cpu count)",
+    arg_int, 1, 256,
+  },
+  [dsda_arg_batch_report] = {
+    "-batch_report", NULL, "batch_report.json",
+    "sets the -batch report file (.json or .csv)",
+    arg_string,
+  },
+  [dsda_arg_batch_worker] = {
+    "-batch_worker", NULL, NULL,
+    "writes demo results to the given file (used internally by -batch)",
+    arg_string,
+  },
+  [dsda_arg_profile] = {
+    "-profile", NULL, NULL,
+    "writes a chrome trace of tic and render timing to the given file",
+    arg_string,
+  },
+  [dsda_arg_hash_stream] = {
+    "-hash_stream", NULL, NULL,
+    "writes a hash of the game state after every tic to the given file",
+    arg_string,
+  },
+  [dsda_arg_hash_compare] = {
+    "-hash_compare", NULL, NULL,
+    "compares the game state against the given -hash_stream file and exits at the first divergence",
+    arg_string,
+  },
+  [dsda_arg_zone_stats] = {
+    "-zone_stats", NULL, NULL,
+    "tracks zone memory by allocation site and writes a report to the given file on exit",
+    arg_string,
+  },
+  [dsda_arg_no_startup_cache] = {
+    "-no_startup_cache", NULL, NULL,
+    "rebuilds the lump directory, texture, and sprite tables instead of using the startup cache",
+    arg_null,
+  },
+  [dsda_arg_startup_profile] = {
+    "-startup_profile", NULL, NULL,
+    "times each startup phase through the first frame and writes a json report to the given file",
+    arg_string,
+  },
+  [dsda_arg_no_sight_cache] = {
+    "-no_sight_cache", NULL, NULL,
+    "runs every sight check in full instead of reusing results within a tic",
+    arg_null,
+  },
+  [dsda_arg_no_sound_graph] = {
+    "-no_sound_graph", NULL, NULL,
+    "floods monster sounds with the original recursion instead of the sector graph",
+    arg_null,
+  },
+  [dsda_arg_no_sector_scan_resume] = {
+    "-no_sector_scan_resume", NULL, NULL,
+    "restarts the sector thing scan after every thing when floors and ceilings move",
+    arg_null,
+  },
+  [dsda_arg_no_thinker_slabs] = {
+    "-no_thinker_slabs", NULL, NULL,
+    "allocates mobjs and sector thinkers from the level zone instead of block pools",
+    arg_null,
+  },
   [dsda_arg_export_text_file] = {
     "-export_text_file", NULL, NULL,
     "export a dsda-format text file template",
@@ -398,6 +473,26 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "dumps a video to the chosen file name",
     arg_string,
   },
+  [dsda_arg_viddump_jobs] = {
+    "-viddump_jobs", NULL, NULL,
+    "splits -viddump into segments rendered by the given number of parallel processes",
+    arg_int, 1, 256,
+  },
+  [dsda_arg_viddump_key_frames] = {
+    "-viddump_key_frames", NULL, NULL,
+    "writes -viddump_jobs segment key frames with the given prefix (used internally)",
+    arg_string,
+  },
+  [dsda_arg_viddump_temp] = {
+    "-viddump_temp", NULL, NULL,
+    "prefixes the -viddump temp files (used internally by -viddump_jobs)",
+    arg_string,
+  },
+  [dsda_arg_viddump_end_tic] = {
+    "-viddump_end_tic", NULL, NULL,
+    "exits after the given logic tic (used internally by -viddump_jobs)",
+    arg_int, 1, INT_MAX,
+  },
   [dsda_arg_dehout] = {
     "-dehout", "-bexout", NULL,
     "sets dehacked log file",
@@ -563,6 +658,11 @@ static arg_config_t arg_config[dsda_arg_count] = {
     "rebuild the blockmap (ignore BLOCKMAP lump)",
     arg_null,
   },
+  [dsda_arg_reject] = {
+    "-reject", NULL, NULL,
+    "build a missing or all-zero REJECT lump from sector connectivity (not while recording or playing demos)",
+    arg_null,
+  },
   [dsda_arg_force_monster_avoid_hazards] = {
     "-force_monster_avoid_hazards", NULL, NULL,
     "sets a special flag to compensate for sync errors in certain demos",
@@ -28,6 +28,7 @@ typedef enum {
   dsda_arg_playdemo,
   dsda_arg_timedemo,
   dsda_arg_fastdemo,
+  dsda_arg_timedemo_report,
   dsda_arg_record,
   dsda_arg_recordfromto,
   dsda_arg_from_key_frame,
@@ -76,6 +77,20 @@ typedef enum {
   dsda_arg_update,
   dsda_arg_analysis,
   dsda_arg_levelstat,
+  dsda_arg_batch,
+  dsda_arg_batch_jobs,
+  dsda_arg_batch_report,
+  dsda_arg_batch_worker,
+  dsda_arg_profile,
+  dsda_arg_hash_stream,
+  dsda_arg_hash_compare,
+  dsda_arg_zone_stats,
+  dsda_arg_no_startup_cache,
+  dsda_arg_startup_profile,
+  dsda_arg_no_sight_cache,
+  dsda_arg_no_sound_graph,
+  dsda_arg_no_sector_scan_resume,
+  dsda_arg_no_thinker_slabs,
   dsda_arg_export_text_file,
   dsda_arg_track_playback,
   dsda_arg_export_ghost,
@@ -90,6 +105,10 @@ typedef enum {
   dsda_arg_shotdir,
   dsda_arg_movie,
   dsda_arg_viddump,
+  dsda_arg_viddump_jobs,
+  dsda_arg_viddump_key_frames,
+  dsda_arg_viddump_temp,
+  dsda_arg_viddump_end_tic,
   dsda_arg_dehout,
   dsda_arg_verbose,
   dsda_arg_quiet,
@@ -123,6 +142,7 @@ typedef enum {
   dsda_arg_emulate,
   dsda_arg_doom95,
   dsda_arg_blockmap,
+  dsda_arg_reject,
   dsda_arg_force_monster_avoid_hazards,
   dsda_arg_force_remove_slime_trails,
   dsda_arg_force_no_dropoff,
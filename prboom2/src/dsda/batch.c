@@ -0,0 +1,439 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Batch
+//
+//  Plays a list of demos in parallel worker processes and collects
+//  the analysis of each one into a single report.
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "z_zone.h"
+
+#include "dsda/analysis.h"
+#include "dsda/args.h"
+#include "dsda/utility.h"
+
+#include "batch.h"
+
+#define MAX_BATCH_JOBS 256
+
+typedef struct {
+  char* key;
+  char* value;
+} batch_pair_t;
+
+typedef struct {
+  char* demo;
+  char* args;
+  dsda_string_t command;
+  dsda_string_t result_path;
+
+  // Written by the worker threads
+  int exit_status;
+  unsigned long long wall_time;
+
+  // Read back from the worker process
+  int final_tic;
+  batch_pair_t* analysis;
+  int analysis_count;
+} batch_job_t;
+
+static batch_job_t* jobs;
+static int job_count;
+static int next_job;
+static int finished_jobs;
+static SDL_mutex* job_mutex;
+
+dboolean dsda_BatchMode(void) {
+  return dsda_Arg(dsda_arg_batch)->found;
+}
+
+void dsda_WriteBatchWorkerResult(void) {
+  FILE* fstream;
+  dsda_arg_t* arg;
+
+  arg = dsda_Arg(dsda_arg_batch_worker);
+  if (!arg->found)
+    return;
+
+  fstream = M_OpenFile(arg->value.v_string, "w");
+  if (!fstream) {
+    lprintf(LO_ERROR, "dsda_WriteBatchWorkerResult: unable to open %s\n", arg->value.v_string);
+    return;
+  }
+
+  fprintf(fstream, "final_tic %d\n", true_logictic);
+  dsda_WriteAnalysisToStream(fstream);
+
+  fclose(fstream);
+}
+
+static char* dsda_TrimLine(char* line) {
+  char* end;
+
+  while (*line == ' ' || *line == '\t')
+    ++line;
+
+  end = line + strlen(line);
+  while (end > line && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t'))
+    --end;
+  *end = '\0';
+
+  return line;
+}
+
+// Manifest lines look like: <demo> [extra arguments]
+// The demo may be quoted if the path contains spaces.
+static void dsda_ParseManifestLine(char* line) {
+  batch_job_t* job;
+  char* demo;
+  char* args;
+
+  line = dsda_TrimLine(line);
+
+  if (!*line || *line == '#')
+    return;
+
+  if (*line == '"') {
+    demo = ++line;
+    args = strchr(line, '"');
+    if (!args)
+      I_Error("dsda_ParseManifestLine: unterminated quote in \"%s\"", demo);
+  }
+  else {
+    demo = line;
+    args = line + strcspn(line, " \t");
+  }
+
+  if (*args)
+    *args++ = '\0';
+
+  jobs = Z_Realloc(jobs, (job_count + 1) * sizeof(*jobs));
+  job = &jobs[job_count++];
+  memset(job, 0, sizeof(*job));
+
+  job->demo = Z_Strdup(demo);
+  job->args = Z_Strdup(dsda_TrimLine(args));
+}
+
+static void dsda_LoadManifest(const char* filename) {
+  FILE* fstream;
+  char line[4096];
+
+  fstream = M_OpenFile(filename, "r");
+  if (!fstream)
+    I_Error("dsda_LoadManifest: unable to open %s", filename);
+
+  while (fgets(line, sizeof(line), fstream))
+    dsda_ParseManifestLine(line);
+
+  fclose(fstream);
+
+  if (!job_count)
+    I_Error("dsda_LoadManifest: no demos found in %s", filename);
+}
+
+static void dsda_PrepareJobs(void) {
+  int i;
+  extern char** dsda_argv;
+
+  for (i = 0; i < job_count; ++i) {
+    batch_job_t* job = &jobs[i];
+
+    dsda_StringPrintF(&job->result_path, "%s/dsda-batch-%u-%d.txt",
+                      I_GetTempDir(), (unsigned int) SDL_GetPerformanceCounter(), i);
+    M_remove(job->result_path.string);
+
+    dsda_StringPrintF(&job->command,
+                      "\"%s\" %s -fastdemo \"%s\" -nosound -nomusic -nodraw -quiet "
+                      "-no_message_box -batch_worker \"%s\"",
+                      dsda_argv[0], job->args, job->demo, job->result_path.string);
+  }
+}
+
+// Runs a shell command and returns its exit code (-1 if it could not run)
+int dsda_SystemCommand(const char* command) {
+  int status;
+
+#ifdef _WIN32
+  // cmd.exe strips the outer quotes when the command starts with one
+  dsda_string_t wrapped;
+
+  dsda_StringPrintF(&wrapped, "\"%s\"", command);
+  status = system(wrapped.string);
+  dsda_FreeString(&wrapped);
+
+  return status;
+#else
+  status = system(command);
+
+#ifdef HAVE_SYS_WAIT_H
+  if (status == -1)
+    return -1;
+
+  if (WIFEXITED(status))
+    return WEXITSTATUS(status);
+
+  return -1;
+#else
+  return status;
+#endif
+#endif
+}
+
+// Worker threads only touch their own job entries and the shared counters,
+// so the zone allocator is never used off the main thread.
+static int dsda_BatchWorker(void* data) {
+  while (1) {
+    batch_job_t* job;
+    Uint64 start;
+
+    SDL_LockMutex(job_mutex);
+    if (next_job >= job_count) {
+      SDL_UnlockMutex(job_mutex);
+      break;
+    }
+    job = &jobs[next_job++];
+    SDL_UnlockMutex(job_mutex);
+
+    start = SDL_GetPerformanceCounter();
+    job->exit_status = dsda_SystemCommand(job->command.string);
+    job->wall_time = (SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency();
+
+    SDL_LockMutex(job_mutex);
+    ++finished_jobs;
+    lprintf(LO_INFO, "[%d / %d] %s: exit %d in %.3f s\n", finished_jobs, job_count,
+            job->demo, job->exit_status, (double) job->wall_time / 1000000);
+    SDL_UnlockMutex(job_mutex);
+  }
+
+  return 0;
+}
+
+static void dsda_ReadJobResult(batch_job_t* job) {
+  FILE* fstream;
+  char line[512];
+
+  job->final_tic = -1;
+
+  fstream = M_OpenFile(job->result_path.string, "r");
+  if (!fstream)
+    return;
+
+  while (fgets(line, sizeof(line), fstream)) {
+    char* key;
+    char* value;
+
+    key = dsda_TrimLine(line);
+    value = key + strcspn(key, " ");
+    if (*value)
+      *value++ = '\0';
+
+    if (!strcmp(key, "final_tic")) {
+      job->final_tic = atoi(value);
+      continue;
+    }
+
+    job->analysis = Z_Realloc(job->analysis, (job->analysis_count + 1) * sizeof(*job->analysis));
+    job->analysis[job->analysis_count].key = Z_Strdup(key);
+    job->analysis[job->analysis_count].value = Z_Strdup(value);
+    ++job->analysis_count;
+  }
+
+  fclose(fstream);
+  M_remove(job->result_path.string);
+}
+
+static void dsda_WriteJSONString(FILE* fstream, const char* str) {
+  fputc('"', fstream);
+
+  for (; *str; ++str) {
+    if (*str == '"' || *str == '\\')
+      fprintf(fstream, "\\%c", *str);
+    else if ((unsigned char) *str < 0x20)
+      fprintf(fstream, "\\u%04x", (unsigned char) *str);
+    else
+      fputc(*str, fstream);
+  }
+
+  fputc('"', fstream);
+}
+
+static void dsda_WriteCSVString(FILE* fstream, const char* str) {
+  fputc('"', fstream);
+
+  for (; *str; ++str) {
+    if (*str == '"')
+      fputc('"', fstream);
+    fputc(*str, fstream);
+  }
+
+  fputc('"', fstream);
+}
+
+static void dsda_WriteJSONReport(FILE* fstream) {
+  int i, j;
+
+  fprintf(fstream, "[\n");
+
+  for (i = 0; i < job_count; ++i) {
+    batch_job_t* job = &jobs[i];
+
+    fprintf(fstream, "  {\n    \"demo\": ");
+    dsda_WriteJSONString(fstream, job->demo);
+    fprintf(fstream, ",\n    \"args\": ");
+    dsda_WriteJSONString(fstream, job->args);
+    fprintf(fstream, ",\n    \"exit_status\": %d", job->exit_status);
+    fprintf(fstream, ",\n    \"final_tic\": %d", job->final_tic);
+    fprintf(fstream, ",\n    \"wall_time\": %.6f", (double) job->wall_time / 1000000);
+    fprintf(fstream, ",\n    \"analysis\": {");
+
+    for (j = 0; j < job->analysis_count; ++j) {
+      fprintf(fstream, "%s\n      ", j ? "," : "");
+      dsda_WriteJSONString(fstream, job->analysis[j].key);
+      fprintf(fstream, ": ");
+      dsda_WriteJSONString(fstream, job->analysis[j].value);
+    }
+
+    fprintf(fstream, "%s}\n  }%s\n", job->analysis_count ? "\n    " : "", i < job_count - 1 ? "," : "");
+  }
+
+  fprintf(fstream, "]\n");
+}
+
+static const char* dsda_JobAnalysisValue(batch_job_t* job, const char* key) {
+  int i;
+
+  for (i = 0; i < job->analysis_count; ++i)
+    if (!strcmp(job->analysis[i].key, key))
+      return job->analysis[i].value;
+
+  return "";
+}
+
+static void dsda_WriteCSVReport(FILE* fstream) {
+  int i, j;
+  batch_job_t* header_job = NULL;
+
+  // Every worker prints the same analysis keys, so any complete result defines the columns
+  for (i = 0; i < job_count; ++i)
+    if (!header_job || jobs[i].analysis_count > header_job->analysis_count)
+      header_job = &jobs[i];
+
+  fprintf(fstream, "demo,args,exit_status,final_tic,wall_time");
+  for (j = 0; j < header_job->analysis_count; ++j)
+    fprintf(fstream, ",%s", header_job->analysis[j].key);
+  fprintf(fstream, "\n");
+
+  for (i = 0; i < job_count; ++i) {
+    batch_job_t* job = &jobs[i];
+
+    dsda_WriteCSVString(fstream, job->demo);
+    fprintf(fstream, ",");
+    dsda_WriteCSVString(fstream, job->args);
+    fprintf(fstream, ",%d,%d,%.6f", job->exit_status, job->final_tic,
+            (double) job->wall_time / 1000000);
+
+    for (j = 0; j < header_job->analysis_count; ++j) {
+      fprintf(fstream, ",");
+      dsda_WriteCSVString(fstream, dsda_JobAnalysisValue(job, header_job->analysis[j].key));
+    }
+
+    fprintf(fstream, "\n");
+  }
+}
+
+static void dsda_WriteBatchReport(void) {
+  FILE* fstream;
+  const char* filename;
+
+  filename = dsda_Arg(dsda_arg_batch_report)->value.v_string;
+
+  fstream = M_OpenFile(filename, "w");
+  if (!fstream)
+    I_Error("dsda_WriteBatchReport: unable to open %s", filename);
+
+  if (dsda_HasFileExt(filename, ".csv"))
+    dsda_WriteCSVReport(fstream);
+  else
+    dsda_WriteJSONReport(fstream);
+
+  fclose(fstream);
+
+  lprintf(LO_INFO, "dsda_WriteBatchReport: wrote %s\n", filename);
+}
+
+int dsda_RunBatch(void) {
+  int i;
+  int worker_count;
+  int failures;
+  SDL_Thread* workers[MAX_BATCH_JOBS];
+  dsda_arg_t* arg;
+
+  dsda_LoadManifest(dsda_Arg(dsda_arg_batch)->value.v_string);
+  dsda_PrepareJobs();
+
+  arg = dsda_Arg(dsda_arg_batch_jobs);
+  worker_count = arg->found ? arg->value.v_int : SDL_GetCPUCount();
+  worker_count = BETWEEN(1, MIN(job_count, MAX_BATCH_JOBS), worker_count);
+
+  lprintf(LO_INFO, "dsda_RunBatch: playing %d demos with %d workers\n", job_count, worker_count);
+
+  job_mutex = SDL_CreateMutex();
+
+  for (i = 0; i < worker_count; ++i) {
+    workers[i] = SDL_CreateThread(dsda_BatchWorker, "dsda_BatchWorker", NULL);
+    if (!workers[i])
+      I_Error("dsda_RunBatch: unable to create worker thread: %s", SDL_GetError());
+  }
+
+  for (i = 0; i < worker_count; ++i)
+    SDL_WaitThread(workers[i], NULL);
+
+  SDL_DestroyMutex(job_mutex);
+
+  failures = 0;
+  for (i = 0; i < job_count; ++i) {
+    dsda_ReadJobResult(&jobs[i]);
+
+    if (jobs[i].exit_status || jobs[i].final_tic < 0)
+      ++failures;
+  }
+
+  dsda_WriteBatchReport();
+
+  lprintf(LO_INFO, "dsda_RunBatch: %d / %d demos completed successfully\n",
+          job_count - failures, job_count);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Batch
+//
+
+#ifndef __DSDA_BATCH__
+#define __DSDA_BATCH__
+
+#include "doomtype.h"
+
+dboolean dsda_BatchMode(void);
+int dsda_RunBatch(void);
+void dsda_WriteBatchWorkerResult(void);
+int dsda_SystemCommand(const char* command);
+
+#endif
@@ -0,0 +1,308 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Benchmark
+//
+//  Collects frame and tic timings during playback and writes
+//  percentiles and histograms (overall and per map) as json.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "v_video.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/mapinfo.h"
+#include "dsda/time.h"
+#include "dsda/utility.h"
+
+#include "benchmark.h"
+
+typedef struct {
+  unsigned int* samples; // microseconds
+  int count;
+  int size;
+} sample_list_t;
+
+typedef struct {
+  char name[9];
+  int gametics;
+  unsigned long long unload_time; // nanoseconds
+  unsigned long long load_time;
+  sample_list_t frames;
+  sample_list_t tics;
+} map_benchmark_t;
+
+static const char* report_filename;
+static map_benchmark_t* maps;
+static int map_count;
+static sample_list_t all_frames;
+static sample_list_t all_tics;
+static unsigned long long frame_start;
+static unsigned long long tic_start;
+static unsigned long long wall_start;
+static int first_gametic = -1;
+static unsigned long long level_setup_start;
+static unsigned long long level_unload_end;
+
+// Upper bounds in microseconds, the last bucket is open ended
+static const unsigned int histogram_bounds[] = {
+  250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000, 0
+};
+
+#define HISTOGRAM_SIZE (sizeof(histogram_bounds) / sizeof(histogram_bounds[0]))
+
+static void dsda_AddSample(sample_list_t* list, unsigned int sample) {
+  if (list->count == list->size) {
+    list->size = list->size ? list->size * 2 : 1024;
+    list->samples = Z_Realloc(list->samples, list->size * sizeof(*list->samples));
+  }
+
+  list->samples[list->count++] = sample;
+}
+
+static map_benchmark_t* dsda_CurrentMapBenchmark(void) {
+  if (!map_count) {
+    maps = Z_Calloc(1, sizeof(*maps));
+    strcpy(maps[0].name, "none");
+    map_count = 1;
+  }
+
+  return &maps[map_count - 1];
+}
+
+void dsda_BenchmarkFrameStart(void) {
+  // Frames drawn before the first tic (title, wipe, loading) would skew
+  // the fps against the wall time, which also starts at the first tic
+  if (!report_filename || first_gametic < 0)
+    return;
+
+  frame_start = dsda_ElapsedTimeNS(dsda_timer_benchmark);
+}
+
+void dsda_BenchmarkFrameEnd(void) {
+  unsigned int sample;
+
+  if (!report_filename || !frame_start)
+    return;
+
+  sample = (unsigned int) ((dsda_ElapsedTimeNS(dsda_timer_benchmark) - frame_start) / 1000);
+  frame_start = 0;
+
+  dsda_AddSample(&dsda_CurrentMapBenchmark()->frames, sample);
+  dsda_AddSample(&all_frames, sample);
+}
+
+void dsda_BenchmarkTicStart(void) {
+  if (!report_filename)
+    return;
+
+  tic_start = dsda_ElapsedTimeNS(dsda_timer_benchmark);
+
+  // Startup and level loading before the first tic are not part of the run
+  if (first_gametic < 0) {
+    first_gametic = gametic;
+    wall_start = tic_start;
+  }
+}
+
+void dsda_BenchmarkTicEnd(void) {
+  unsigned int sample;
+  map_benchmark_t* map;
+
+  if (!report_filename || !tic_start)
+    return;
+
+  sample = (unsigned int) ((dsda_ElapsedTimeNS(dsda_timer_benchmark) - tic_start) / 1000);
+  tic_start = 0;
+
+  map = dsda_CurrentMapBenchmark();
+  dsda_AddSample(&map->tics, sample);
+  dsda_AddSample(&all_tics, sample);
+  ++map->gametics;
+}
+
+void dsda_BenchmarkLevelSetupStart(void) {
+  if (!report_filename)
+    return;
+
+  level_setup_start = dsda_ElapsedTimeNS(dsda_timer_benchmark);
+}
+
+void dsda_BenchmarkLevelUnloaded(void) {
+  if (!report_filename)
+    return;
+
+  level_unload_end = dsda_ElapsedTimeNS(dsda_timer_benchmark);
+}
+
+void dsda_BenchmarkNewMap(void) {
+  map_benchmark_t* map;
+  unsigned long long now;
+
+  if (!report_filename)
+    return;
+
+  now = dsda_ElapsedTimeNS(dsda_timer_benchmark);
+
+  // Drop the placeholder if nothing was measured before the first map
+  map = dsda_CurrentMapBenchmark();
+  if (map->frames.count || map->tics.count) {
+    maps = Z_Realloc(maps, (map_count + 1) * sizeof(*maps));
+    map = &maps[map_count++];
+  }
+
+  memset(map, 0, sizeof(*map));
+  strncpy(map->name, dsda_MapLumpName(gameepisode, gamemap), 8);
+
+  if (level_setup_start && level_unload_end >= level_setup_start) {
+    map->unload_time = level_unload_end - level_setup_start;
+    map->load_time = now - level_unload_end;
+  }
+
+  level_setup_start = 0;
+  level_unload_end = 0;
+}
+
+static int C_DECL dicmp_samples(const void* a, const void* b) {
+  unsigned int x = *(const unsigned int *) a;
+  unsigned int y = *(const unsigned int *) b;
+
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Nearest rank percentile of a sorted list
+static double dsda_Percentile(sample_list_t* list, int percent) {
+  int rank;
+
+  rank = (list->count * percent + 99) / 100;
+  if (rank < 1)
+    rank = 1;
+
+  return (double) list->samples[rank - 1] / 1000;
+}
+
+static void dsda_WriteSampleStats(FILE* fstream, const char* name,
+                                  sample_list_t* list, const char* indent) {
+  int i, bucket;
+  unsigned long long total;
+  int histogram[HISTOGRAM_SIZE];
+
+  fprintf(fstream, "%s\"%s\": {\n", indent, name);
+  fprintf(fstream, "%s  \"count\": %d", indent, list->count);
+
+  if (list->count) {
+    qsort(list->samples, list->count, sizeof(*list->samples), dicmp_samples);
+
+    total = 0;
+    memset(histogram, 0, sizeof(histogram));
+
+    for (i = 0, bucket = 0; i < list->count; ++i) {
+      total += list->samples[i];
+
+      // Samples are sorted, so the bucket only moves forward
+      while (histogram_bounds[bucket] && list->samples[i] >= histogram_bounds[bucket])
+        ++bucket;
+      ++histogram[bucket];
+    }
+
+    fprintf(fstream, ",\n%s  \"total_ms\": %.3f", indent, (double) total / 1000);
+    fprintf(fstream, ",\n%s  \"mean_ms\": %.3f", indent, (double) total / 1000 / list->count);
+    fprintf(fstream, ",\n%s  \"p50_ms\": %.3f", indent, dsda_Percentile(list, 50));
+    fprintf(fstream, ",\n%s  \"p95_ms\": %.3f", indent, dsda_Percentile(list, 95));
+    fprintf(fstream, ",\n%s  \"p99_ms\": %.3f", indent, dsda_Percentile(list, 99));
+    fprintf(fstream, ",\n%s  \"max_ms\": %.3f", indent, dsda_Percentile(list, 100));
+    fprintf(fstream, ",\n%s  \"histogram\": [", indent);
+
+    for (i = 0; i < HISTOGRAM_SIZE; ++i) {
+      if (histogram_bounds[i])
+        fprintf(fstream, "%s\n%s    { \"below_ms\": %.3f, \"count\": %d }",
+                i ? "," : "", indent, (double) histogram_bounds[i] / 1000, histogram[i]);
+      else
+        fprintf(fstream, "%s\n%s    { \"below_ms\": null, \"count\": %d }",
+                i ? "," : "", indent, histogram[i]);
+    }
+
+    fprintf(fstream, "\n%s  ]", indent);
+  }
+
+  fprintf(fstream, "\n%s}", indent);
+}
+
+static void dsda_WriteBenchmark(void) {
+  int i;
+  dboolean first;
+  FILE* fstream;
+  unsigned long long wall_time;
+
+  if (first_gametic < 0)
+    return;
+
+  wall_time = (dsda_ElapsedTimeNS(dsda_timer_benchmark) - wall_start) / 1000;
+
+  fstream = M_OpenFile(report_filename, "w");
+  if (!fstream) {
+    lprintf(LO_ERROR, "dsda_WriteBenchmark: unable to open %s\n", report_filename);
+    return;
+  }
+
+  fprintf(fstream, "{\n");
+  fprintf(fstream, "  \"renderer\": \"%s\",\n", V_IsOpenGLMode() ? "opengl" : "software");
+  fprintf(fstream, "  \"resolution\": \"%dx%d\",\n", SCREENWIDTH, SCREENHEIGHT);
+  fprintf(fstream, "  \"gametics\": %d,\n", gametic - first_gametic);
+  fprintf(fstream, "  \"wall_time_ms\": %.3f,\n", (double) wall_time / 1000);
+  fprintf(fstream, "  \"fps\": %.3f,\n",
+          wall_time ? (double) all_frames.count * 1000000 / wall_time : 0.0);
+  dsda_WriteSampleStats(fstream, "frame", &all_frames, "  ");
+  fprintf(fstream, ",\n");
+  dsda_WriteSampleStats(fstream, "tic", &all_tics, "  ");
+  fprintf(fstream, ",\n  \"maps\": [");
+
+  first = true;
+  for (i = 0; i < map_count; ++i) {
+    if (!maps[i].frames.count && !maps[i].tics.count && !maps[i].load_time)
+      continue;
+
+    fprintf(fstream, "%s\n    {\n", first ? "" : ",");
+    first = false;
+    fprintf(fstream, "      \"map\": \"%s\",\n", maps[i].name);
+    fprintf(fstream, "      \"gametics\": %d,\n", maps[i].gametics);
+    fprintf(fstream, "      \"level_unload_ms\": %.3f,\n", (double) maps[i].unload_time / 1000000);
+    fprintf(fstream, "      \"level_load_ms\": %.3f,\n", (double) maps[i].load_time / 1000000);
+    dsda_WriteSampleStats(fstream, "frame", &maps[i].frames, "      ");
+    fprintf(fstream, ",\n");
+    dsda_WriteSampleStats(fstream, "tic", &maps[i].tics, "      ");
+    fprintf(fstream, "\n    }");
+  }
+
+  fprintf(fstream, "\n  ]\n}\n");
+  fclose(fstream);
+
+  lprintf(LO_INFO, "dsda_WriteBenchmark: wrote %s\n", report_filename);
+}
+
+void dsda_InitBenchmark(const char* filename) {
+  report_filename = filename;
+
+  dsda_StartTimer(dsda_timer_benchmark);
+
+  I_AtExit(dsda_WriteBenchmark, true, "dsda_WriteBenchmark", exit_priority_normal);
+}
@@ -0,0 +1,30 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Benchmark
+//
+
+#ifndef __DSDA_BENCHMARK__
+#define __DSDA_BENCHMARK__
+
+void dsda_InitBenchmark(const char* filename);
+void dsda_BenchmarkFrameStart(void);
+void dsda_BenchmarkFrameEnd(void);
+void dsda_BenchmarkTicStart(void);
+void dsda_BenchmarkTicEnd(void);
+void dsda_BenchmarkLevelSetupStart(void);
+void dsda_BenchmarkLevelUnloaded(void);
+void dsda_BenchmarkNewMap(void);
+
+#endif
@@ -14,20 +14,47 @@
 // DESCRIPTION:
 //	DSDA Brute Force
 //
+//  With dsda_brute_force_jobs above 1, the sequence space is split into
+//  contiguous ranges, one per forked worker process. Each worker runs the
+//  serial search over its range and reports back through shared memory.
+//  Picking the earliest winning range gives the same result as the serial
+//  search.
+//
+//  With pruning enabled, the player state at each depth is hashed into a
+//  transposition table, and subtrees reached from a state that has already
+//  been explored at the same depth are skipped.
+//
 
 #include <math.h>
-
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include "d_main.h"
 #include "d_player.h"
 #include "d_ticcmd.h"
 #include "doomstat.h"
+#include "g_game.h"
+#include "i_system.h"
+#include "i_video.h"
 #include "lprintf.h"
 #include "m_random.h"
+#include "p_saveg.h"
 #include "r_state.h"
 
 #include "dsda/build.h"
+#include "dsda/configuration.h"
 #include "dsda/demo.h"
 #include "dsda/features.h"
 #include "dsda/key_frame.h"
+#include "dsda/save.h"
 #include "dsda/skip.h"
 #include "dsda/time.h"
 #include "dsda/utility.h"
@@ -36,6 +63,7 @@
 
 #define MAX_BF_DEPTH 35
 #define MAX_BF_CONDITIONS 16
+#define MAX_BF_JOBS 64
 
 typedef struct {
   int min;
@@ -82,6 +110,38 @@ static dsda_key_frame_t nomo_key_frame;
 static bf_target_t bf_target;
 static ticcmd_t bf_result[MAX_BF_DEPTH];
 
+// Shared between the parent and the worker processes
+typedef struct {
+  long long start;
+  long long volume;
+  int result;
+  dboolean done;
+  dboolean evaluated;
+  fixed_t best_value;
+  int best_depth;
+  ticcmd_t result_cmds[MAX_BF_DEPTH];
+  long long lookups;
+  long long hits;
+  long long skipped;
+} bf_worker_t;
+
+typedef struct {
+  unsigned long long* keys;
+  int size;
+  int count;
+  long long lookups;
+  long long hits;
+  long long skipped;
+} bf_table_t;
+
+static dboolean bf_prune;
+static bf_table_t bf_table;
+
+static bf_worker_t* bf_workers;
+static int bf_worker_count;
+static int bf_worker_id;
+static dboolean bf_worker;
+
 const char* dsda_bf_attribute_names[dsda_bf_attribute_max] = {
   [dsda_bf_x] = "x",
   [dsda_bf_y] = "y",
@@ -192,6 +252,69 @@ static int dsda_AdvanceBruteForce(void) {
   return i;
 }
 
+static int dsda_BFRangeSize(bf_range_t* range) {
+  return range->max - range->min + 1;
+}
+
+static long long dsda_BFFrameVolume(int frame) {
+  return (long long) dsda_BFRangeSize(&brute_force[frame].forwardmove) *
+         dsda_BFRangeSize(&brute_force[frame].sidemove) *
+         dsda_BFRangeSize(&brute_force[frame].angleturn);
+}
+
+static int dsda_BFFrameDigit(int frame) {
+  bf_t* bf = &brute_force[frame];
+
+  return ((bf->forwardmove.i - bf->forwardmove.min) * dsda_BFRangeSize(&bf->sidemove) +
+          bf->sidemove.i - bf->sidemove.min) * dsda_BFRangeSize(&bf->angleturn) +
+         bf->angleturn.i - bf->angleturn.min;
+}
+
+static long long dsda_BFSubtreeVolume(int frame) {
+  long long volume = 1;
+
+  for (; frame < bf_depth; ++frame)
+    volume *= dsda_BFFrameVolume(frame);
+
+  return volume;
+}
+
+// Position of the current sequence within the subtree starting at frame
+static long long dsda_BFSubtreeIndex(int frame) {
+  long long index = 0;
+
+  for (; frame < bf_depth; ++frame)
+    index = index * dsda_BFFrameVolume(frame) + dsda_BFFrameDigit(frame);
+
+  return index;
+}
+
+#ifndef _WIN32
+// Sequences are ordered the way dsda_AdvanceBruteForce walks them
+static void dsda_SetBFSequence(long long index) {
+  int i;
+
+  for (i = bf_depth - 1; i >= 0; --i) {
+    int digit;
+    long long volume;
+
+    volume = dsda_BFFrameVolume(i);
+    digit = index % volume;
+    index /= volume;
+
+    brute_force[i].angleturn.i = brute_force[i].angleturn.min +
+                                 digit % dsda_BFRangeSize(&brute_force[i].angleturn);
+    digit /= dsda_BFRangeSize(&brute_force[i].angleturn);
+
+    brute_force[i].sidemove.i = brute_force[i].sidemove.min +
+                                digit % dsda_BFRangeSize(&brute_force[i].sidemove);
+    digit /= dsda_BFRangeSize(&brute_force[i].sidemove);
+
+    brute_force[i].forwardmove.i = brute_force[i].forwardmove.min + digit;
+  }
+}
+#endif
+
 static void dsda_CopyBFCommandDepth(ticcmd_t* cmd, bf_t* bf) {
   memset(cmd, 0, sizeof(*cmd));
 
@@ -215,8 +338,11 @@ static void dsda_RestoreBFKeyFrame(int frame) {
   dsda_RestoreKeyFrame(&brute_force[frame].key_frame, true);
 }
 
+// With pruning on, the masked ranges are kept so the key frame can be hashed
 static void dsda_StoreBFKeyFrame(int frame) {
+  P_RecordSaveMask(bf_prune);
   dsda_StoreKeyFrame(&brute_force[frame].key_frame, true, false);
+  P_RecordSaveMask(false);
 }
 
 static void dsda_PrintBFProgress(void) {
@@ -240,12 +366,45 @@ dboolean dsda_BruteForceEnded(void) {
   return brute_force_ended;
 }
 
+#ifndef _WIN32
+static void dsda_FinishBFWorker(int result) {
+  bf_worker_t* worker;
+
+  worker = &bf_workers[bf_worker_id];
+  worker->volume = bf_volume;
+  worker->result = result;
+  worker->evaluated = bf_target.evaluated;
+  worker->best_value = bf_target.best_value;
+  worker->best_depth = bf_target.best_depth;
+  memcpy(worker->result_cmds, bf_result, sizeof(bf_result));
+  worker->lookups = bf_table.lookups;
+  worker->hits = bf_table.hits;
+  worker->skipped = bf_table.skipped;
+
+  __sync_synchronize();
+  worker->done = true;
+
+  _exit(0);
+}
+#endif
+
 static void dsda_EndBF(int result) {
+#ifndef _WIN32
+  if (bf_worker)
+    dsda_FinishBFWorker(result);
+#endif
+
   brute_force_ended = true;
 
   lprintf(LO_INFO, "Brute force complete (%s)!\n", bf_result_text[result]);
   dsda_PrintBFProgress();
 
+  if (bf_prune)
+    lprintf(LO_INFO, "  %lld / %lld states pruned (%d%%), skipping %lld sequences\n",
+            bf_table.hits, bf_table.lookups,
+            bf_table.lookups ? (int) (100 * bf_table.hits / bf_table.lookups) : 0,
+            bf_table.skipped);
+
   if (bf_nomonsters)
     dsda_RestoreKeyFrame(&nomo_key_frame, true);
   else
@@ -386,19 +545,13 @@ static dboolean dsda_BFConditionReached(int i) {
   }
 }
 
-static void dsda_BFUpdateBestResult(fixed_t value) {
+static void dsda_PrintBFBestResult(void) {
   int i;
   char str[FIXED_STRING_LENGTH];
   char cmd_str[COMMAND_MOVEMENT_STRING_LENGTH];
+  fixed_t value;
 
-  bf_target.evaluated = true;
-  bf_target.best_value = value;
-  bf_target.best_depth = true_logictic - bf_logictic;
-
-  for (i = 0; i < bf_target.best_depth; ++i)
-    bf_target.best_bf[i] = brute_force[i];
-
-  dsda_CopyBFResult(bf_target.best_bf, bf_target.best_depth);
+  value = bf_target.best_value;
 
   if (fixed_point_attribute[bf_target.attribute])
     dsda_FixedToString(str, value);
@@ -415,6 +568,22 @@ static void dsda_BFUpdateBestResult(fixed_t value) {
   lprintf(LO_INFO, "\n");
 }
 
+static void dsda_BFUpdateBestResult(fixed_t value) {
+  int i;
+
+  bf_target.evaluated = true;
+  bf_target.best_value = value;
+  bf_target.best_depth = true_logictic - bf_logictic;
+
+  for (i = 0; i < bf_target.best_depth; ++i)
+    bf_target.best_bf[i] = brute_force[i];
+
+  dsda_CopyBFResult(bf_target.best_bf, bf_target.best_depth);
+
+  if (!bf_worker)
+    dsda_PrintBFBestResult();
+}
+
 static dboolean dsda_BFNewBestResult(fixed_t value) {
   if (!bf_target.evaluated)
     return true;
@@ -593,6 +762,354 @@ void dsda_BruteForceWithMonsters(void) {
   bf_nomonsters = false;
 }
 
+void dsda_BruteForceWithPruning(void) {
+  bf_prune = true;
+}
+
+void dsda_BruteForceWithoutPruning(void) {
+  bf_prune = false;
+}
+
+static void dsda_ResetBFTable(void) {
+  Z_Free(bf_table.keys);
+  memset(&bf_table, 0, sizeof(bf_table));
+
+  if (bf_prune) {
+    bf_table.size = 1 << 16;
+    bf_table.keys = Z_Calloc(bf_table.size, sizeof(*bf_table.keys));
+  }
+}
+
+static void dsda_GrowBFTable(void) {
+  int i;
+  int old_size;
+  unsigned long long* old_keys;
+
+  old_size = bf_table.size;
+  old_keys = bf_table.keys;
+
+  bf_table.size *= 2;
+  bf_table.keys = Z_Calloc(bf_table.size, sizeof(*bf_table.keys));
+
+  for (i = 0; i < old_size; ++i)
+    if (old_keys[i]) {
+      int j;
+
+      for (j = old_keys[i] & (bf_table.size - 1); bf_table.keys[j]; j = (j + 1) & (bf_table.size - 1));
+
+      bf_table.keys[j] = old_keys[i];
+    }
+
+  Z_Free(old_keys);
+}
+
+static dboolean dsda_CheckBFTable(unsigned long long key, dboolean insert) {
+  int i;
+
+  ++bf_table.lookups;
+
+  for (i = key & (bf_table.size - 1); bf_table.keys[i]; i = (i + 1) & (bf_table.size - 1))
+    if (bf_table.keys[i] == key) {
+      ++bf_table.hits;
+      return true;
+    }
+
+  if (insert) {
+    bf_table.keys[i] = key;
+    ++bf_table.count;
+
+    if (bf_table.count * 2 > bf_table.size)
+      dsda_GrowBFTable();
+  }
+
+  return false;
+}
+
+static unsigned long long dsda_BFHashBytes(unsigned long long hash, const void* data, size_t size) {
+  const byte* p = data;
+
+  while (size--) {
+    hash ^= *p++;
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+#define BF_HASH(x) hash = dsda_BFHashBytes(hash, &(x), sizeof(x))
+
+static int C_DECL dicmp_save_mask(const void* a, const void* b) {
+  const save_mask_t* mask_a = a;
+  const save_mask_t* mask_b = b;
+
+  return (mask_a->offset > mask_b->offset) - (mask_a->offset < mask_b->offset);
+}
+
+// Hashes the key frame just stored for this frame, skipping the ranges
+// masked while it was archived: the demo buffers, player input, and
+// pointers. Different inputs reaching the same game state then match.
+static unsigned long long dsda_BFStateHash(int frame) {
+  int i;
+  size_t offset;
+  dsda_key_frame_t* key_frame;
+  unsigned long long hash = 14695981039346656037ull;
+
+  BF_HASH(frame);
+
+  key_frame = &brute_force[frame].key_frame;
+
+  // Thinker headers are masked after the fields inside them
+  qsort(save_mask, save_mask_count, sizeof(*save_mask), dicmp_save_mask);
+
+  offset = 0;
+  for (i = 0; i < save_mask_count; ++i) {
+    if (save_mask[i].offset > offset)
+      hash = dsda_BFHashBytes(hash, key_frame->buffer + offset, save_mask[i].offset - offset);
+
+    offset = MAX(offset, save_mask[i].offset + save_mask[i].length);
+  }
+
+  if (key_frame->buffer_length > offset)
+    hash = dsda_BFHashBytes(hash, key_frame->buffer + offset, key_frame->buffer_length - offset);
+
+  // Condition inputs that live outside the archive
+  for (i = 0; i < bf_condition_count; ++i)
+    if (bf_condition[i].operator == dsda_bf_operator_misc &&
+        bf_condition[i].attribute != dsda_bf_have_item)
+      BF_HASH(lines[bf_condition[i].value].player_activations);
+
+  return hash ? hash : 1;
+}
+
+#undef BF_HASH
+
+static void dsda_FinishBFSearch(void) {
+  if (bf_target.enabled && bf_target.evaluated)
+    dsda_EndBF(BF_SUCCESS);
+  else
+    dsda_EndBF(BF_FAILURE);
+}
+
+// Skips the subtree starting at frame if an equivalent state was explored
+static dboolean dsda_PruneBruteForce(int frame) {
+  int i;
+  long long index;
+
+  index = dsda_BFSubtreeIndex(frame);
+
+  // A worker may start partway through a subtree, which doesn't count as explored
+  if (!dsda_CheckBFTable(dsda_BFStateHash(frame), index == 0))
+    return false;
+
+  bf_table.skipped += dsda_BFSubtreeVolume(frame) - index;
+  bf_volume += dsda_BFSubtreeVolume(frame) - index;
+
+  if (bf_worker)
+    bf_workers[bf_worker_id].volume = bf_volume;
+
+  for (i = frame; i < bf_depth; ++i) {
+    brute_force[i].forwardmove.i = brute_force[i].forwardmove.min;
+    brute_force[i].sidemove.i = brute_force[i].sidemove.min;
+    brute_force[i].angleturn.i = brute_force[i].angleturn.min;
+  }
+
+  for (i = frame - 1; i >= 0; --i)
+    if (dsda_AdvanceBruteForceFrame(i))
+      break;
+
+  if (i < 0 || bf_volume >= bf_volume_max)
+    dsda_FinishBFSearch();
+  else
+    dsda_RestoreBFKeyFrame(i);
+
+  return true;
+}
+
+static dboolean dsda_BFWorkerPreempted(void) {
+  int i;
+
+  // A target compares every sequence, so only plain conditions end early
+  if (bf_target.enabled)
+    return false;
+
+  for (i = 0; i < bf_worker_id; ++i)
+    if (bf_workers[i].done && bf_workers[i].result == BF_SUCCESS)
+      return true;
+
+  return false;
+}
+
+#ifndef _WIN32
+static int dsda_MergeBFWorkers(void) {
+  int i;
+  bf_worker_t* best = NULL;
+
+  bf_volume = 0;
+  for (i = 0; i < bf_worker_count; ++i) {
+    bf_volume += bf_workers[i].volume;
+    bf_table.lookups += bf_workers[i].lookups;
+    bf_table.hits += bf_workers[i].hits;
+    bf_table.skipped += bf_workers[i].skipped;
+  }
+
+  bf_target.evaluated = false;
+
+  for (i = 0; i < bf_worker_count; ++i) {
+    bf_worker_t* worker = &bf_workers[i];
+
+    if (!worker->done) {
+      lprintf(LO_ERROR, "Brute force worker %d failed!\n", i);
+      return BF_FAILURE;
+    }
+
+    if (worker->result != BF_SUCCESS)
+      continue;
+
+    // Without a target, the earliest range to reach the conditions wins
+    if (!bf_target.enabled) {
+      best = worker;
+      break;
+    }
+
+    // Ties go to the earlier range, as in the serial search
+    if (dsda_BFNewBestResult(worker->best_value)) {
+      bf_target.evaluated = true;
+      bf_target.best_value = worker->best_value;
+      best = worker;
+    }
+  }
+
+  if (!best)
+    return BF_FAILURE;
+
+  memcpy(bf_result, best->result_cmds, sizeof(bf_result));
+
+  if (bf_target.enabled) {
+    bf_target.best_depth = best->best_depth;
+    dsda_PrintBFBestResult();
+  }
+
+  return BF_SUCCESS;
+}
+
+static void dsda_RunBFWorker(int id) {
+  long long end;
+
+  bf_worker = true;
+  bf_worker_id = id;
+
+  end = id + 1 < bf_worker_count ? bf_workers[id + 1].start : bf_volume_max;
+  bf_volume_max = end - bf_workers[id].start;
+  dsda_SetBFSequence(bf_workers[id].start);
+
+  nosfxparm = true;
+  nomusicparm = true;
+
+  // Errors in the worker must not run the parent's exit handlers
+  I_SkipExitHandlers();
+
+  // The worker never draws or reads input, and exits through dsda_EndBF
+  while (1) {
+    G_Ticker();
+    ++gametic;
+  }
+}
+#endif
+
+static dboolean dsda_RunParallelBF(int jobs) {
+#ifdef _WIN32
+  return false;
+#else
+  int i;
+  int remaining;
+  size_t size;
+  pid_t pids[MAX_BF_JOBS];
+  unsigned long long last_progress = 0;
+
+  if (jobs > bf_volume_max)
+    jobs = bf_volume_max;
+
+  if (jobs < 2)
+    return false;
+
+  size = jobs * sizeof(*bf_workers);
+  bf_workers = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (bf_workers == MAP_FAILED) {
+    bf_workers = NULL;
+    lprintf(LO_WARN, "Unable to share memory with brute force workers!\n");
+    return false;
+  }
+
+  memset(bf_workers, 0, size);
+  bf_worker_count = jobs;
+
+  for (i = 0; i < jobs; ++i)
+    bf_workers[i].start = bf_volume_max * i / jobs;
+
+  // dsda_EndBF restores this in the parent
+  dsda_StoreBFKeyFrame(0);
+
+  lprintf(LO_INFO, "Splitting the search across %d processes\n\n", jobs);
+  fflush(NULL);
+
+  for (i = 0; i < jobs; ++i) {
+    pids[i] = fork();
+
+    if (!pids[i])
+      dsda_RunBFWorker(i);
+
+    if (pids[i] < 0) {
+      lprintf(LO_WARN, "Unable to start brute force worker, running in a single process!\n");
+
+      while (i--) {
+        kill(pids[i], SIGKILL);
+        waitpid(pids[i], NULL, 0);
+      }
+
+      munmap(bf_workers, size);
+      bf_workers = NULL;
+      bf_worker_count = 0;
+
+      return false;
+    }
+  }
+
+  for (remaining = jobs; remaining; ) {
+    unsigned long long elapsed_time;
+
+    for (i = 0; i < jobs; ++i)
+      if (pids[i] && waitpid(pids[i], NULL, WNOHANG) == pids[i]) {
+        pids[i] = 0;
+        --remaining;
+      }
+
+    elapsed_time = dsda_ElapsedTimeMS(dsda_timer_brute_force);
+    if (remaining && elapsed_time - last_progress >= 2000) {
+      last_progress = elapsed_time;
+
+      bf_volume = 0;
+      for (i = 0; i < jobs; ++i)
+        bf_volume += bf_workers[i].volume;
+
+      dsda_PrintBFProgress();
+    }
+
+    if (remaining) {
+      I_PumpEvents();
+      I_uSleep(10000);
+    }
+  }
+
+  dsda_EndBF(dsda_MergeBFWorkers());
+
+  munmap(bf_workers, size);
+  bf_workers = NULL;
+  bf_worker_count = 0;
+
+  return true;
+#endif
+}
+
 dboolean dsda_StartBruteForce(int depth) {
   int i;
 
@@ -613,6 +1130,8 @@ dboolean dsda_StartBruteForce(int depth) {
   bf_volume = 0;
   bf_volume_max = 1;
 
+  dsda_ResetBFTable();
+
   for (i = 0; i < bf_depth; ++i) {
     lprintf(LO_INFO, "  %d: F %d:%d S %d:%d T %d:%d B %d\n", i,
             brute_force[i].forwardmove.min, brute_force[i].forwardmove.max,
@@ -620,9 +1139,7 @@ dboolean dsda_StartBruteForce(int depth) {
             brute_force[i].angleturn.min, brute_force[i].angleturn.max,
             brute_force[i].buttons);
 
-    bf_volume_max *= (brute_force[i].forwardmove.max - brute_force[i].forwardmove.min + 1) *
-                     (brute_force[i].sidemove.max - brute_force[i].sidemove.min + 1) *
-                     (brute_force[i].angleturn.max - brute_force[i].angleturn.min + 1);
+    bf_volume_max *= dsda_BFFrameVolume(i);
 
     brute_force[i].forwardmove.i = brute_force[i].forwardmove.min;
     brute_force[i].sidemove.i = brute_force[i].sidemove.min;
@@ -643,6 +1160,8 @@ dboolean dsda_StartBruteForce(int depth) {
 
   dsda_StartTimer(dsda_timer_brute_force);
 
+  dsda_RunParallelBF(MIN(dsda_IntConfig(dsda_config_brute_force_jobs), MAX_BF_JOBS));
+
   return true;
 }
 
@@ -652,7 +1171,7 @@ void dsda_UpdateBruteForce(void) {
   frame = true_logictic - bf_logictic;
 
   if (frame == bf_depth) {
-    if (bf_volume % 10000 == 0)
+    if (bf_volume % 10000 == 0 && !bf_worker)
       dsda_PrintBFProgress();
 
     frame = dsda_AdvanceBruteForce();
@@ -660,8 +1179,12 @@ void dsda_UpdateBruteForce(void) {
     if (frame >= 0)
       dsda_RestoreBFKeyFrame(frame);
   }
-  else
+  else {
     dsda_StoreBFKeyFrame(frame);
+
+    if (frame && bf_prune)
+      dsda_PruneBruteForce(frame);
+  }
 }
 
 void dsda_EvaluateBruteForce(void) {
@@ -670,16 +1193,17 @@ void dsda_EvaluateBruteForce(void) {
 
   ++bf_volume;
 
+  if (bf_worker)
+    bf_workers[bf_worker_id].volume = bf_volume;
+
   if (dsda_BFConditionsReached()) {
     dsda_CopyBFResult(brute_force, bf_depth);
     dsda_EndBF(BF_SUCCESS);
   }
-  else if (bf_volume >= bf_volume_max) {
-    if (bf_target.enabled && bf_target.evaluated)
-      dsda_EndBF(BF_SUCCESS);
-    else
-      dsda_EndBF(BF_FAILURE);
-  }
+  else if (bf_volume >= bf_volume_max)
+    dsda_FinishBFSearch();
+  else if (bf_worker && dsda_BFWorkerPreempted())
+    dsda_EndBF(BF_FAILURE);
 }
 
 void dsda_CopyBruteForceCommand(ticcmd_t* cmd) {
@@ -882,12 +882,24 @@ dsda_config_t dsda_config[dsda_config_count] = {
   },
   [dsda_config_auto_key_frame_depth] = {
     "dsda_auto_key_frame_depth", dsda_config_auto_key_frame_depth,
-    dsda_config_int, 0, 600, { 60 }, NULL, STRICT_INT(0), dsda_InitKeyFrame
+    dsda_config_int, 0, 6000, { 60 }, NULL, STRICT_INT(0), dsda_InitKeyFrame
   },
   [dsda_config_auto_key_frame_timeout] = {
     "dsda_auto_key_frame_timeout", dsda_config_auto_key_frame_timeout,
     dsda_config_int, 0, 25, { 10 }, NULL, NOT_STRICT, dsda_InitKeyFrame
   },
+  [dsda_config_seek_index_interval] = {
+    "dsda_seek_index_interval", dsda_config_seek_index_interval,
+    dsda_config_int, 0, 600, { 0 }
+  },
+  [dsda_config_brute_force_jobs] = {
+    "dsda_brute_force_jobs", dsda_config_brute_force_jobs,
+    dsda_config_int, 1, 64, { 1 }
+  },
+  [dsda_config_sound_cache_budget] = {
+    "dsda_sound_cache_budget", dsda_config_sound_cache_budget,
+    dsda_config_int, 0, 4096, { 128 }
+  },
   [dsda_config_ex_text_scale_x] = {
     "ex_text_scale_x", dsda_config_ex_text_scale_x,
     dsda_config_int, 0, 4000, { 0 }, NULL, NOT_STRICT, dsda_SetupStretchParams
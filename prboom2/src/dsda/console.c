@@ -48,6 +48,8 @@
 #include "dsda/features.h"
 #include "dsda/font.h"
 #include "dsda/global.h"
+#include "dsda/key_frame.h"
+#include "dsda/lump_cache.h"
 #include "dsda/map_format.h"
 #include "dsda/messenger.h"
 #include "dsda/mobjinfo.h"
@@ -848,6 +850,18 @@ static dboolean console_BruteForceMonsters(const char* command, const char* args
   return true;
 }
 
+static dboolean console_BruteForcePrune(const char* command, const char* args) {
+  dsda_BruteForceWithPruning();
+
+  return true;
+}
+
+static dboolean console_BruteForceNoPrune(const char* command, const char* args) {
+  dsda_BruteForceWithoutPruning();
+
+  return true;
+}
+
 static dboolean console_BruteForceFrame(const char* command, const char* args) {
   int frame;
   int forwardmove_min, forwardmove_max;
@@ -1249,6 +1263,29 @@ static dboolean console_WadStatsRemember(const char* command, const char* args)
   return true;
 }
 
+static dboolean console_ZoneStats(const char* command, const char* args) {
+  int count;
+
+  if (sscanf(args, "%d", &count) != 1)
+    count = 20;
+
+  Z_PrintStats(count);
+
+  return true;
+}
+
+static dboolean console_KeyFrameMemory(const char* command, const char* args) {
+  dsda_PrintKeyFrameMemory();
+
+  return true;
+}
+
+static dboolean console_LumpCacheStats(const char* command, const char* args) {
+  dsda_PrintLumpCacheStats();
+
+  return true;
+}
+
 static dboolean console_FreeTextUpdate(const char* command, const char* args) {
   dsda_UpdateStringConfig(dsda_config_free_text, args, true);
 
@@ -2284,6 +2321,9 @@ static console_command_entry_t console_commands[] = {
   { "wad_stats.remember", console_WadStatsRemember, CF_ALWAYS },
   { "free_text.update", console_FreeTextUpdate, CF_ALWAYS },
   { "free_text.clear", console_FreeTextClear, CF_ALWAYS },
+  { "key_frame.memory", console_KeyFrameMemory, CF_ALWAYS },
+  { "zone.stats", console_ZoneStats, CF_ALWAYS },
+  { "lump_cache.stats", console_LumpCacheStats, CF_ALWAYS },
 
   // tracking
   { "tracker.add_line", console_TrackerAddLine, CF_DEMO },
@@ -2398,6 +2438,10 @@ static console_command_entry_t console_commands[] = {
   { "bf.nomo", console_BruteForceNoMonsters, CF_DEMO },
   { "brute_force.monsters", console_BruteForceMonsters, CF_DEMO },
   { "bf.mo", console_BruteForceMonsters, CF_DEMO },
+  { "brute_force.prune", console_BruteForcePrune, CF_DEMO },
+  { "bf.prune", console_BruteForcePrune, CF_DEMO },
+  { "brute_force.noprune", console_BruteForceNoPrune, CF_DEMO },
+  { "bf.noprune", console_BruteForceNoPrune, CF_DEMO },
   { "build.turbo", console_BuildTurbo, CF_DEMO },
   { "b.turbo", console_BuildTurbo, CF_DEMO },
   { "mf", console_BuildMF, CF_DEMO },
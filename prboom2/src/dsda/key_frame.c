@@ -14,8 +14,14 @@
 // DESCRIPTION:
 //	DSDA Key Frame
 //
+//  Auto key frames are kept zlib compressed. Most are stored as an XOR
+//  delta against the previous auto key frame, with a full frame every
+//  FULL_KEY_FRAME_INTERVAL frames to bound the reconstruction chain.
+//
 
+#include <stddef.h>
 #include <time.h>
+#include <zlib.h>
 
 #include "doomstat.h"
 #include "s_advsound.h"
@@ -54,6 +60,7 @@ static dboolean auto_kf_timed_out;
 static int auto_kf_timeout_count;
 
 #define TIMEOUT_LIMIT 1
+#define FULL_KEY_FRAME_INTERVAL 16
 
 static dsda_key_frame_t first_kf;
 static dsda_key_frame_t quick_kf;
@@ -63,6 +70,12 @@ static auto_kf_t* last_auto_kf;
 static int auto_kf_size;
 static int restore_key_frame_index = -1;
 
+// Uncompressed copy of the newest auto key frame, the base for the next delta
+static byte* delta_base;
+static int delta_base_length;
+static auto_kf_t* delta_base_kf;
+static byte* delta_base_id;
+
 static int dsda_auto_key_frame_interval;
 static int dsda_auto_key_frame_depth;
 static int dsda_auto_key_frame_timeout;
@@ -117,6 +130,139 @@ static void dsda_ResolveParentKF(dsda_key_frame_t* kf) {
   }
 }
 
+static void dsda_SetDeltaBase(auto_kf_t* auto_kf, byte* buffer, int length) {
+  Z_Free(delta_base);
+
+  delta_base = buffer;
+  delta_base_length = length;
+  delta_base_kf = auto_kf;
+  delta_base_id = auto_kf ? auto_kf->kf.buffer : NULL;
+}
+
+static dboolean dsda_DeltaBaseValid(auto_kf_t* auto_kf) {
+  return delta_base && delta_base_kf == auto_kf &&
+         autoKFExists(auto_kf) && delta_base_id == auto_kf->kf.buffer;
+}
+
+static void dsda_ApplyDelta(byte* buffer, int length, const byte* base, int base_length) {
+  int i;
+
+  length = MIN(length, base_length);
+
+  for (i = 0; i < length; ++i)
+    buffer[i] ^= base[i];
+}
+
+static byte* dsda_CompressKeyFrame(const byte* buffer, int length, int* compressed_length) {
+  byte* result;
+  uLongf size;
+
+  size = compressBound(length);
+  result = Z_Malloc(size);
+
+  if (compress2(result, &size, buffer, length, Z_BEST_SPEED) != Z_OK)
+    I_Error("dsda_CompressKeyFrame: compression failed");
+
+  *compressed_length = size;
+
+  return Z_Realloc(result, size);
+}
+
+// Returns a new uncompressed buffer, following the delta chain back to a full frame
+static byte* dsda_DecodeAutoKeyFrame(auto_kf_t* auto_kf) {
+  byte* buffer;
+  uLongf length;
+
+  length = auto_kf->kf.buffer_length;
+  buffer = Z_Malloc(length);
+
+  if (uncompress(buffer, &length, auto_kf->kf.buffer, auto_kf->kf.compressed_length) != Z_OK ||
+      length != auto_kf->kf.buffer_length)
+    I_Error("dsda_DecodeAutoKeyFrame: corrupt key frame");
+
+  if (auto_kf->delta_depth) {
+    auto_kf_t* base_kf = auto_kf->prev;
+
+    if (dsda_DeltaBaseValid(base_kf))
+      dsda_ApplyDelta(buffer, length, delta_base, delta_base_length);
+    else {
+      byte* base;
+
+      base = dsda_DecodeAutoKeyFrame(base_kf);
+      dsda_ApplyDelta(buffer, length, base, base_kf->kf.buffer_length);
+      Z_Free(base);
+    }
+  }
+
+  return buffer;
+}
+
+// Parent links compare buffer pointers, so they follow the auto key frame
+static void dsda_ReplaceAutoKFBuffer(auto_kf_t* auto_kf, byte* buffer) {
+  byte* old_buffer = auto_kf->kf.buffer;
+
+  if (first_kf.parent.buffer == old_buffer)
+    first_kf.parent.buffer = buffer;
+
+  if (quick_kf.parent.buffer == old_buffer)
+    quick_kf.parent.buffer = buffer;
+
+  if (temp_kf.parent.buffer == old_buffer)
+    temp_kf.parent.buffer = buffer;
+
+  if (delta_base_id == old_buffer)
+    delta_base_id = buffer;
+
+  auto_kf->kf.buffer = buffer;
+  auto_kf->kf.parent.buffer = buffer;
+}
+
+// The oldest frame in the ring loses its base, so it must become a full frame
+static void dsda_PromoteAutoKeyFrame(auto_kf_t* auto_kf) {
+  byte* buffer;
+  byte* old_buffer;
+
+  if (!autoKFExists(auto_kf) || !auto_kf->delta_depth)
+    return;
+
+  buffer = dsda_DecodeAutoKeyFrame(auto_kf);
+  old_buffer = auto_kf->kf.buffer;
+
+  dsda_ReplaceAutoKFBuffer(auto_kf, dsda_CompressKeyFrame(buffer, auto_kf->kf.buffer_length,
+                                                          &auto_kf->kf.compressed_length));
+  auto_kf->delta_depth = 0;
+
+  Z_Free(old_buffer);
+  Z_Free(buffer);
+}
+
+static void dsda_EncodeAutoKeyFrame(auto_kf_t* auto_kf) {
+  byte* buffer;
+  byte* delta = NULL;
+  int length;
+
+  buffer = auto_kf->kf.buffer;
+  length = auto_kf->kf.buffer_length;
+
+  if (dsda_DeltaBaseValid(auto_kf->prev) &&
+      auto_kf->prev->delta_depth < FULL_KEY_FRAME_INTERVAL - 1) {
+    delta = Z_Malloc(length);
+    memcpy(delta, buffer, length);
+    dsda_ApplyDelta(delta, length, delta_base, delta_base_length);
+
+    auto_kf->delta_depth = auto_kf->prev->delta_depth + 1;
+  }
+  else
+    auto_kf->delta_depth = 0;
+
+  dsda_ReplaceAutoKFBuffer(auto_kf, dsda_CompressKeyFrame(delta ? delta : buffer, length,
+                                                         &auto_kf->kf.compressed_length));
+
+  Z_Free(delta);
+
+  dsda_SetDeltaBase(auto_kf, buffer, length);
+}
+
 static void dsda_RewindKF(auto_kf_t** current) {
   auto_kf_t* auto_kf;
 
@@ -176,6 +322,17 @@ void dsda_InitKeyFrame(void) {
   dsda_auto_key_frame_depth = dsda_IntConfig(dsda_config_auto_key_frame_depth);
   dsda_auto_key_frame_timeout = dsda_IntConfig(dsda_config_auto_key_frame_timeout);
 
+  // auto_kf_size still holds the length of the old chain here
+  if (auto_key_frames != NULL) {
+    for (i = 0; i < auto_kf_size; ++i)
+      Z_Free(auto_key_frames[i].kf.buffer);
+
+    Z_Free(auto_key_frames);
+    auto_key_frames = NULL;
+  }
+
+  dsda_SetDeltaBase(NULL, NULL, 0);
+
   auto_kf_size = autoKeyFrameDepth();
 
   if (!auto_kf_size) {
@@ -183,9 +340,6 @@ void dsda_InitKeyFrame(void) {
     return;
   }
 
-  if (auto_key_frames != NULL)
-    Z_Free(auto_key_frames);
-
   ++auto_kf_size; // chain includes a terminator
 
   auto_key_frames = Z_Calloc(auto_kf_size, sizeof(auto_kf_t));
@@ -232,12 +386,16 @@ void dsda_StoreKeyFrame(dsda_key_frame_t* key_frame, byte complete, byte export)
   // Store state of demo recording buffer
   dsda_StoreDemoData(complete);
 
+  // The demo buffers hold input history rather than game state
+  P_MaskSave(savebuffer, save_p - savebuffer);
+
   dsda_ArchiveAll();
 
   if (key_frame->buffer != NULL) Z_Free(key_frame->buffer);
 
   key_frame->buffer = savebuffer;
   key_frame->buffer_length = save_p - savebuffer;
+  key_frame->compressed_length = 0;
 
   P_ForgetSaveBuffer();
 
@@ -256,6 +414,8 @@ void dsda_RestoreKeyFrame(dsda_key_frame_t* key_frame, dboolean skip_wipe) {
   void G_AfterLoad(void);
 
   byte complete;
+  byte* buffer;
+  auto_kf_t* auto_kf = NULL;
 
   if (key_frame->buffer == NULL) {
     doom_printf("No key frame found");
@@ -267,7 +427,15 @@ void dsda_RestoreKeyFrame(dsda_key_frame_t* key_frame, dboolean skip_wipe) {
   if (skip_wipe || dsda_BuildMode())
     dsda_SkipNextWipe();
 
-  save_p = key_frame->buffer;
+  buffer = key_frame->buffer;
+
+  // Only auto key frames are compressed
+  if (key_frame->compressed_length) {
+    auto_kf = (auto_kf_t*) ((byte*) key_frame - offsetof(auto_kf_t, kf));
+    buffer = dsda_DecodeAutoKeyFrame(auto_kf);
+  }
+
+  save_p = buffer;
 
   P_LOAD_BYTE(complete);
   P_LOAD_X(key_frame->game_tic_count);
@@ -290,6 +458,9 @@ void dsda_RestoreKeyFrame(dsda_key_frame_t* key_frame, dboolean skip_wipe) {
 
   dsda_ResolveParentKF(key_frame);
 
+  if (auto_kf)
+    dsda_SetDeltaBase(auto_kf, buffer, key_frame->buffer_length);
+
   doom_printf("Restored key frame");
 }
 
@@ -330,6 +501,17 @@ void dsda_RestoreKeyFrameFile(const char* name) {
   Z_Free(key_frame.buffer);
 }
 
+void dsda_StoreKeyFrameFile(const char* name) {
+  dsda_key_frame_t key_frame = { 0 };
+
+  dsda_StoreKeyFrame(&key_frame, true, false);
+
+  if (!M_WriteFile(name, key_frame.buffer, key_frame.buffer_length))
+    I_Error("dsda_StoreKeyFrameFile: Failed to write key frame.");
+
+  Z_Free(key_frame.buffer);
+}
+
 void dsda_ContinueKeyFrame(void) {
   dsda_arg_t* arg;
 
@@ -386,6 +568,9 @@ void dsda_UpdateAutoKeyFrames(void) {
     last_auto_kf->next->auto_index = 0;
     last_auto_kf->auto_index = last_auto_kf->prev->auto_index + 1;
 
+    if (last_auto_kf->next->next != last_auto_kf)
+      dsda_PromoteAutoKeyFrame(last_auto_kf->next->next);
+
     current_key_frame = &last_auto_kf->kf;
 
     {
@@ -393,6 +578,11 @@ void dsda_UpdateAutoKeyFrames(void) {
 
       dsda_StartTimer(dsda_timer_key_frame);
       dsda_StoreKeyFrame(current_key_frame, false, false);
+
+      if (!first_kf.buffer)
+        dsda_CopyKeyFrame(&first_kf, current_key_frame);
+
+      dsda_EncodeAutoKeyFrame(last_auto_kf);
       elapsed_time = dsda_ElapsedTimeMS(dsda_timer_key_frame);
 
       if (autoKeyFrameTimeout()) {
@@ -408,8 +598,37 @@ void dsda_UpdateAutoKeyFrames(void) {
           auto_kf_timeout_count = 0;
       }
     }
+  }
+}
+
+void dsda_PrintKeyFrameMemory(void) {
+  int count = 0;
+  int full_count = 0;
+  long long total = 0;
+  long long full_total = 0;
+  long long raw_total = 0;
+  auto_kf_t* auto_kf;
+
+  for (auto_kf = last_auto_kf; autoKFExists(auto_kf); dsda_RewindKF(&auto_kf)) {
+    ++count;
+    total += auto_kf->kf.compressed_length;
+    raw_total += auto_kf->kf.buffer_length;
 
-    if (!first_kf.buffer)
-      dsda_CopyKeyFrame(&first_kf, current_key_frame);
+    if (!auto_kf->delta_depth) {
+      ++full_count;
+      full_total += auto_kf->kf.compressed_length;
+    }
   }
+
+  if (!count) {
+    lprintf(LO_INFO, "No auto key frames stored\n");
+    return;
+  }
+
+  lprintf(LO_INFO, "Auto key frames: %d of %d (%d full, %d delta)\n",
+          count, auto_kf_size - 1, full_count, count - full_count);
+  lprintf(LO_INFO, "  Memory: %lld KB (%lld KB uncompressed)\n", total / 1024, raw_total / 1024);
+  lprintf(LO_INFO, "  Per full frame: %lld bytes\n", full_count ? full_total / full_count : 0);
+  lprintf(LO_INFO, "  Per delta frame: %lld bytes\n",
+          count > full_count ? (total - full_total) / (count - full_count) : 0);
 }
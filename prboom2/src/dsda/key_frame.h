@@ -30,12 +30,14 @@ typedef struct {
 typedef struct {
   byte* buffer;
   int buffer_length;
+  int compressed_length; // nonzero for compressed auto key frames
   int game_tic_count;
   parent_kf_t parent;
 } dsda_key_frame_t;
 
 typedef struct auto_kf_s {
   int auto_index;
+  int delta_depth; // 0 for full frames, otherwise a delta against prev
   dsda_key_frame_t kf;
   struct auto_kf_s* prev;
   struct auto_kf_s* next;
@@ -44,6 +46,7 @@ typedef struct auto_kf_s {
 void dsda_StoreKeyFrame(dsda_key_frame_t* key_frame, byte complete, byte export);
 void dsda_RestoreKeyFrame(dsda_key_frame_t* key_frame, dboolean skip_wipe);
 void dsda_InitKeyFrame(void);
+void dsda_StoreKeyFrameFile(const char* name);
 void dsda_ContinueKeyFrame(void);
 int dsda_KeyFrameRestored(void);
 void dsda_StoreTempKeyFrame(void);
@@ -54,5 +57,6 @@ void dsda_RewindAutoKeyFrame(void);
 void dsda_ResetAutoKeyFrameTimeout(void);
 void dsda_UpdateAutoKeyFrames(void);
 void dsda_ForgetAutoKeyFrames(void);
+void dsda_PrintKeyFrameMemory(void);
 
 #endif
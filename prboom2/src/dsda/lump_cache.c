@@ -0,0 +1,233 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Lump Cache
+//
+//  Holds lumps copied out of the wad files. A locked lump stays put until
+//  it is unlocked; unlocked lumps are kept in least recently used order
+//  and evicted once the cache goes over budget. Permanent lumps are
+//  never evicted, for callers that hold on to the data indefinitely.
+//
+//  Only the sound code unlocks what it locks, so in practice the budget
+//  bounds cached sounds; everything else stays pinned.
+//
+
+#include <string.h>
+
+#include "lprintf.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "dsda/configuration.h"
+
+#include "lump_cache.h"
+
+typedef struct {
+  void* data;
+  int locks;
+  dboolean permanent;
+  int prev; // least recently used list of unlocked lumps
+  int next;
+} cached_lump_t;
+
+static cached_lump_t* cache;
+static int cache_size;
+static int lru_head = -1;
+static int lru_tail = -1;
+
+static size_t cached_bytes;
+static size_t peak_cached_bytes;
+static unsigned long long cache_hits;
+static unsigned long long cache_misses;
+static unsigned long long cache_evictions;
+
+static size_t dsda_LumpCacheBudget(void) {
+  return (size_t) dsda_IntConfig(dsda_config_sound_cache_budget) * 1024 * 1024;
+}
+
+static void dsda_UnlinkCachedLump(int lump) {
+  cached_lump_t* entry = &cache[lump];
+
+  if (entry->prev >= 0)
+    cache[entry->prev].next = entry->next;
+  else
+    lru_head = entry->next;
+
+  if (entry->next >= 0)
+    cache[entry->next].prev = entry->prev;
+  else
+    lru_tail = entry->prev;
+
+  entry->prev = entry->next = -1;
+}
+
+static void dsda_LinkCachedLump(int lump) {
+  cached_lump_t* entry = &cache[lump];
+
+  entry->prev = lru_tail;
+  entry->next = -1;
+
+  if (lru_tail >= 0)
+    cache[lru_tail].next = lump;
+  else
+    lru_head = lump;
+
+  lru_tail = lump;
+}
+
+static dboolean dsda_CachedLumpEvictable(int lump) {
+  return cache[lump].data && !cache[lump].locks && !cache[lump].permanent;
+}
+
+static void dsda_EvictCachedLump(int lump) {
+  dsda_UnlinkCachedLump(lump);
+
+  Z_Free(cache[lump].data);
+  cache[lump].data = NULL;
+  cached_bytes -= W_LumpLength(lump);
+  ++cache_evictions;
+}
+
+// Locked lumps can push the cache over budget; it shrinks again as they are unlocked
+static void dsda_TrimLumpCache(size_t incoming) {
+  size_t budget;
+
+  budget = dsda_LumpCacheBudget();
+  if (!budget)
+    return;
+
+  while (lru_head >= 0 && cached_bytes + incoming > budget)
+    dsda_EvictCachedLump(lru_head);
+}
+
+void dsda_InitLumpCache(void) {
+  int i;
+
+  dsda_FreeLumpCache();
+
+  cache_size = numlumps;
+  cache = Z_Calloc(cache_size, sizeof(*cache));
+
+  for (i = 0; i < cache_size; ++i)
+    cache[i].prev = cache[i].next = -1;
+}
+
+void dsda_FreeLumpCache(void) {
+  int i;
+
+  if (!cache)
+    return;
+
+  for (i = 0; i < cache_size; ++i)
+    Z_Free(cache[i].data);
+
+  Z_Free(cache);
+  cache = NULL;
+  cache_size = 0;
+  cached_bytes = 0;
+  lru_head = lru_tail = -1;
+}
+
+const void* dsda_LockCachedLump(int lump, dboolean permanent) {
+  cached_lump_t* entry = &cache[lump];
+
+  if (entry->data) {
+    ++cache_hits;
+
+    if (dsda_CachedLumpEvictable(lump))
+      dsda_UnlinkCachedLump(lump);
+  }
+  else {
+    int length;
+
+    ++cache_misses;
+
+    length = W_LumpLength(lump);
+    dsda_TrimLumpCache(length);
+
+    entry->data = Z_Malloc(length);
+    W_ReadLump(lump, entry->data);
+
+    cached_bytes += length;
+    if (cached_bytes > peak_cached_bytes)
+      peak_cached_bytes = cached_bytes;
+  }
+
+  if (permanent)
+    entry->permanent = true;
+  else
+    ++entry->locks;
+
+  return entry->data;
+}
+
+// Takes over data read outside the cache, such as on a startup worker
+void dsda_AdoptCachedLump(int lump, void* data) {
+  int length;
+  cached_lump_t* entry = &cache[lump];
+
+  if (entry->data) {
+    Z_Free(data);
+    return;
+  }
+
+  length = W_LumpLength(lump);
+  dsda_TrimLumpCache(length);
+
+  entry->data = data;
+  cached_bytes += length;
+  if (cached_bytes > peak_cached_bytes)
+    peak_cached_bytes = cached_bytes;
+
+  dsda_LinkCachedLump(lump);
+}
+
+void dsda_UnlockCachedLump(int lump) {
+  cached_lump_t* entry = &cache[lump];
+
+  if (entry->locks <= 0)
+    I_Error("dsda_UnlockCachedLump: lump %d is not locked", lump);
+
+  --entry->locks;
+
+  if (dsda_CachedLumpEvictable(lump)) {
+    dsda_LinkCachedLump(lump);
+    dsda_TrimLumpCache(0);
+  }
+}
+
+void dsda_PrintLumpCacheStats(void) {
+  int i;
+  int cached = 0;
+  int locked = 0;
+  int permanent = 0;
+
+  for (i = 0; i < cache_size; ++i)
+    if (cache[i].data) {
+      ++cached;
+
+      if (cache[i].permanent)
+        ++permanent;
+      else if (cache[i].locks)
+        ++locked;
+    }
+
+  lprintf(LO_INFO, "Lump cache: %d lumps, %.1f MB (peak %.1f MB, sound budget %d MB)\n",
+          cached, cached_bytes / 1048576.0, peak_cached_bytes / 1048576.0,
+          dsda_IntConfig(dsda_config_sound_cache_budget));
+  lprintf(LO_INFO, "  %d permanent, %d locked, %d evictable\n",
+          permanent, locked, cached - permanent - locked);
+  lprintf(LO_INFO, "  %llu hits, %llu misses, %llu evictions\n",
+          cache_hits, cache_misses, cache_evictions);
+}
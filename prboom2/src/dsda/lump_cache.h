@@ -0,0 +1,30 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Lump Cache
+//
+
+#ifndef __DSDA_LUMP_CACHE__
+#define __DSDA_LUMP_CACHE__
+
+#include "doomtype.h"
+
+void dsda_InitLumpCache(void);
+void dsda_FreeLumpCache(void);
+const void* dsda_LockCachedLump(int lump, dboolean permanent);
+void dsda_UnlockCachedLump(int lump);
+void dsda_AdoptCachedLump(int lump, void* data);
+void dsda_PrintLumpCacheStats(void);
+
+#endif
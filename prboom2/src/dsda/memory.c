@@ -15,23 +15,133 @@
 //	DSDA Memory
 //
 
+#include "d_main.h"
 #include "i_sound.h"
 #include "sounds.h"
 #include "w_wad.h"
 #include "lprintf.h"
+#include "z_zone.h"
 
+#include "dsda/lump_cache.h"
+#include "dsda/startup_jobs.h"
 #include "dsda/time.h"
 
 #include "memory.h"
 
+// Sound lumps are read on the startup workers while the rest of startup
+// runs, then handed to the lump cache
+
+#define SOUND_JOB_SIZE 64
+
+typedef struct {
+  int lump;
+  void* data;
+  dboolean loaded;
+} sound_read_t;
+
+typedef struct {
+  sound_read_t* reads;
+  int count;
+} sound_job_t;
+
+static sound_read_t* sound_reads;
+static sound_job_t* sound_jobs;
+static int sound_job_count;
+static int sound_job_id = -1;
+
+static void dsda_SoundJobWork(void* data) {
+  int i;
+  sound_job_t* job = data;
+
+  for (i = 0; i < job->count; ++i) {
+    sound_read_t* read = &job->reads[i];
+
+    read->loaded = W_ReadLumpRange(read->lump, 0, read->data, W_LumpLength(read->lump));
+  }
+}
+
+static void dsda_SoundJobFinish(void* data) {
+  int i;
+  sound_job_t* job = data;
+
+  for (i = 0; i < job->count; ++i) {
+    sound_read_t* read = &job->reads[i];
+
+    if (read->loaded)
+      dsda_AdoptCachedLump(read->lump, read->data);
+    else
+      Z_Free(read->data);
+  }
+
+  if (job == &sound_jobs[sound_job_count - 1]) {
+    Z_Free(sound_reads);
+    Z_Free(sound_jobs);
+    sound_reads = NULL;
+    sound_jobs = NULL;
+    sound_job_count = 0;
+    sound_job_id = -1;
+  }
+}
+
+// Must be called once the sound names are final
+void dsda_QueueSoundLumpJobs(void) {
+  int i;
+  int count;
+  byte* queued;
+
+  if (nosfxparm || sound_jobs)
+    return;
+
+  queued = Z_Calloc(numlumps, sizeof(*queued));
+  sound_reads = Z_Malloc(num_sfx * sizeof(*sound_reads));
+
+  for (count = 0, i = 1; i < num_sfx; ++i) {
+    int lump = I_GetSfxLumpNum(&S_sfx[i]);
+
+    if (lump < 0 || queued[lump] || !W_LumpLength(lump))
+      continue;
+
+    queued[lump] = true;
+    sound_reads[count].lump = lump;
+    sound_reads[count].data = Z_Malloc(W_LumpLength(lump));
+    sound_reads[count].loaded = false;
+    ++count;
+  }
+
+  Z_Free(queued);
+
+  if (!count) {
+    Z_Free(sound_reads);
+    sound_reads = NULL;
+    return;
+  }
+
+  sound_job_count = (count + SOUND_JOB_SIZE - 1) / SOUND_JOB_SIZE;
+  sound_jobs = Z_Malloc(sound_job_count * sizeof(*sound_jobs));
+
+  for (i = 0; i < sound_job_count; ++i) {
+    sound_jobs[i].reads = sound_reads + i * SOUND_JOB_SIZE;
+    sound_jobs[i].count = MIN(SOUND_JOB_SIZE, count - i * SOUND_JOB_SIZE);
+  }
+
+  // Queue only once the table is complete, since a job may finish right away
+  for (i = 0; i < sound_job_count; ++i)
+    sound_job_id = dsda_QueueStartupJob(dsda_SoundJobWork, dsda_SoundJobFinish, &sound_jobs[i]);
+}
+
 void dsda_CacheSoundLumps(void) {
   int i;
 
+  dsda_WaitStartupJob(sound_job_id);
+
   for (i = 0; i < num_sfx; ++i) {
     sfxinfo_t *sfx = &S_sfx[i];
     sfx->lumpnum = I_GetSfxLumpNum(sfx);
 
-    if (sfx->lumpnum >= 0)
+    // Warm the lump cache; the sounds stay cached until evicted
+    if (sfx->lumpnum >= 0) {
       W_LockLumpNum(sfx->lumpnum);
+      W_UnlockLumpNum(sfx->lumpnum);
+    }
   }
 }
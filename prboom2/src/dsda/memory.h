@@ -18,6 +18,7 @@
 #ifndef __DSDA_MEMORY__
 #define __DSDA_MEMORY__
 
+void dsda_QueueSoundLumpJobs(void);
 void dsda_CacheSoundLumps(void);
 
 #endif
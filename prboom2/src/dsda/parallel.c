@@ -0,0 +1,102 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Parallel
+//
+//  Splits a loop over worker threads for the duration of a call. Indices
+//  are handed out in order to whichever thread is free, the calling
+//  thread included. The loop body must not touch zone memory, the lump
+//  cache or other shared state it doesn't own.
+//
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "doomtype.h"
+
+#include "parallel.h"
+
+#define MAX_PARALLEL_THREADS 16
+
+typedef struct {
+  parallel_func_t func;
+  void* data;
+  int count;
+  int next;
+  SDL_mutex* mutex;
+} parallel_loop_t;
+
+static int dsda_ParallelWorker(void* data) {
+  parallel_loop_t* loop = data;
+
+  while (1) {
+    int index;
+
+    SDL_LockMutex(loop->mutex);
+    index = loop->next < loop->count ? loop->next++ : -1;
+    SDL_UnlockMutex(loop->mutex);
+
+    if (index < 0)
+      break;
+
+    loop->func(index, loop->data);
+  }
+
+  return 0;
+}
+
+int dsda_ParallelThreadCount(void) {
+  int count;
+
+  count = SDL_GetCPUCount();
+
+  return count < 1 ? 1 : MIN(count, MAX_PARALLEL_THREADS);
+}
+
+void dsda_ParallelFor(int count, parallel_func_t func, void* data) {
+  int i;
+  int worker_count;
+  parallel_loop_t loop;
+  SDL_Thread* workers[MAX_PARALLEL_THREADS];
+
+  loop.func = func;
+  loop.data = data;
+  loop.count = count;
+  loop.next = 0;
+  loop.mutex = count > 1 ? SDL_CreateMutex() : NULL;
+
+  if (!loop.mutex) {
+    for (i = 0; i < count; ++i)
+      func(i, data);
+
+    return;
+  }
+
+  // Threads that fail to start are covered by the rest
+  worker_count = 0;
+  while (worker_count < MIN(dsda_ParallelThreadCount(), count) - 1) {
+    workers[worker_count] = SDL_CreateThread(dsda_ParallelWorker, "dsda_ParallelWorker", &loop);
+    if (!workers[worker_count])
+      break;
+
+    ++worker_count;
+  }
+
+  dsda_ParallelWorker(&loop);
+
+  for (i = 0; i < worker_count; ++i)
+    SDL_WaitThread(workers[i], NULL);
+
+  SDL_DestroyMutex(loop.mutex);
+}
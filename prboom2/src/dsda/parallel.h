@@ -0,0 +1,26 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Parallel
+//
+
+#ifndef __DSDA_PARALLEL__
+#define __DSDA_PARALLEL__
+
+typedef void (*parallel_func_t)(int index, void* data);
+
+int dsda_ParallelThreadCount(void);
+void dsda_ParallelFor(int count, parallel_func_t func, void* data);
+
+#endif
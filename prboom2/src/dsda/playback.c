@@ -26,6 +26,7 @@
 #include "dsda/exdemo.h"
 #include "dsda/input.h"
 #include "dsda/key_frame.h"
+#include "dsda/seek_index.h"
 #include "dsda/skip.h"
 
 #include "playback.h"
@@ -54,10 +55,15 @@ dboolean dsda_JumpToLogicTic(int tic) {
   if (tic < 0)
     return false;
 
-  if (tic > true_logictic)
-    dsda_SkipToLogicTic(tic);
+  if (tic > true_logictic) {
+    // Restoring costs a level load, so only use the index to skip ahead a while
+    dsda_RestoreSeekKeyFrame(tic, true_logictic + TICRATE);
+
+    if (tic != true_logictic)
+      dsda_SkipToLogicTic(tic);
+  }
   else if (tic < true_logictic) {
-    if (!dsda_RestoreClosestKeyFrame(tic))
+    if (!dsda_RestoreClosestKeyFrame(tic) && !dsda_RestoreSeekKeyFrame(tic, -1))
       return false;
 
     if (tic != true_logictic)
@@ -172,14 +178,41 @@ int dsda_PlaybackTics(void) {
   return playback_tics;
 }
 
+int dsda_PlaybackTicsRemaining(void) {
+  int tics = 0;
+  const byte* p;
+
+  if (!playback_p)
+    return 0;
+
+  for (p = playback_p;
+       p + dsda_BytesPerTic() <= playback_origin_p + playback_length && *p != DEMOMARKER;
+       p += dsda_BytesPerTic())
+    ++tics;
+
+  return tics;
+}
+
+// The position is stored as an offset so that key frames
+// can be restored by another process playing the same demo
 void dsda_StorePlaybackPosition(void) {
+  int64_t playback_offset;
+
+  playback_offset = playback_p ? playback_p - playback_origin_p : -1;
+
   P_SAVE_X(playback_tics);
-  P_SAVE_X(playback_p);
+  P_SAVE_X(playback_offset);
 }
 
 void dsda_RestorePlaybackPosition(void) {
+  int64_t playback_offset;
+
   P_LOAD_X(playback_tics);
-  P_LOAD_X(playback_p);
+  P_LOAD_X(playback_offset);
+
+  playback_p = playback_offset >= 0 && playback_origin_p ?
+               playback_origin_p + playback_offset :
+               NULL;
 }
 
 void dsda_ClearPlaybackStream(void) {
@@ -30,6 +30,7 @@ void dsda_ClearPlaybackStream(void);
 void dsda_InitDemoPlayback(void);
 void dsda_AttachPlaybackStream(const byte* demo_p, int length, int behaviour);
 int dsda_PlaybackTics(void);
+int dsda_PlaybackTicsRemaining(void);
 void dsda_StorePlaybackPosition(void);
 void dsda_RestorePlaybackPosition(void);
 void dsda_JoinDemo(ticcmd_t* cmd);
@@ -0,0 +1,435 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Profiler
+//
+//  Times the simulation and render phases and writes them as a
+//  chrome / perfetto trace, plus a summary table for each map.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "p_mobj.h"
+#include "p_spec.h"
+#include "p_tick.h"
+#include "z_zone.h"
+
+#include "hexen/p_acs.h"
+#include "hexen/po_man.h"
+
+#include "dsda/ambient.h"
+#include "dsda/mapinfo.h"
+#include "dsda/scroll.h"
+#include "dsda/time.h"
+#include "dsda/utility.h"
+
+#include "profiler.h"
+
+dboolean dsda_profiling;
+
+typedef struct {
+  const char* name;
+  int depth;
+  unsigned long long start;
+  unsigned long long tic_time;
+  int tic_calls;
+  unsigned long long map_time;
+  unsigned long long map_max_tic;
+  int map_calls;
+} profile_zone_t;
+
+static profile_zone_t zones[DSDA_PROFILE_ZONE_COUNT] = {
+  [dsda_profile_ticker] = { "P_Ticker" },
+  [dsda_profile_thinkers] = { "P_RunThinkers" },
+  [dsda_profile_specials] = { "P_UpdateSpecials" },
+  [dsda_profile_sight] = { "P_CheckSight" },
+  [dsda_profile_sight_uncached] = { "P_CheckSight (uncached)" },
+  [dsda_profile_path_traverse] = { "P_PathTraverse" },
+  [dsda_profile_render] = { "R_RenderPlayerView" },
+};
+
+typedef struct {
+  think_t function;
+  const char* name;
+} thinker_name_t;
+
+static const thinker_name_t thinker_names[] = {
+  { P_MobjThinker, "P_MobjThinker" },
+  { P_BlasterMobjThinker, "P_BlasterMobjThinker" },
+  { P_RemoveThinkerDelayed, "P_RemoveThinkerDelayed" },
+  { T_MoveCeiling, "T_MoveCeiling" },
+  { T_VerticalDoor, "T_VerticalDoor" },
+  { T_MoveFloor, "T_MoveFloor" },
+  { T_PlatRaise, "T_PlatRaise" },
+  { T_LightFlash, "T_LightFlash" },
+  { T_StrobeFlash, "T_StrobeFlash" },
+  { T_Glow, "T_Glow" },
+  { T_ZDoom_Glow, "T_ZDoom_Glow" },
+  { T_FireFlicker, "T_FireFlicker" },
+  { T_ZDoom_Flicker, "T_ZDoom_Flicker" },
+  { T_MoveElevator, "T_MoveElevator" },
+  { T_Pusher, "T_Pusher" },
+  { T_Friction, "T_Friction" },
+  { T_Light, "T_Light" },
+  { T_Phase, "T_Phase" },
+  { T_InterpretACS, "T_InterpretACS" },
+  { T_BuildPillar, "T_BuildPillar" },
+  { T_FloorWaggle, "T_FloorWaggle" },
+  { T_CeilingWaggle, "T_CeilingWaggle" },
+  { T_RotatePoly, "T_RotatePoly" },
+  { T_MovePoly, "T_MovePoly" },
+  { T_PolyDoor, "T_PolyDoor" },
+  { dsda_UpdateSideScroller, "dsda_UpdateSideScroller" },
+  { dsda_UpdateFloorScroller, "dsda_UpdateFloorScroller" },
+  { dsda_UpdateCeilingScroller, "dsda_UpdateCeilingScroller" },
+  { dsda_UpdateFloorCarryScroller, "dsda_UpdateFloorCarryScroller" },
+  { dsda_UpdateZDoomFloorScroller, "dsda_UpdateZDoomFloorScroller" },
+  { dsda_UpdateZDoomCeilingScroller, "dsda_UpdateZDoomCeilingScroller" },
+  { dsda_UpdateThruster, "dsda_UpdateThruster" },
+  { dsda_UpdateControlSideScroller, "dsda_UpdateControlSideScroller" },
+  { dsda_UpdateControlFloorScroller, "dsda_UpdateControlFloorScroller" },
+  { dsda_UpdateControlCeilingScroller, "dsda_UpdateControlCeilingScroller" },
+  { dsda_UpdateControlFloorCarryScroller, "dsda_UpdateControlFloorCarryScroller" },
+  { dsda_UpdateQuake, "dsda_UpdateQuake" },
+  { dsda_UpdateAmbientSource, "dsda_UpdateAmbientSource" },
+  { NULL, "unknown thinker" }
+};
+
+typedef struct {
+  const thinker_name_t* info;
+  unsigned long long tic_time;
+  int tic_calls;
+  unsigned long long map_time;
+  int map_calls;
+} profile_thinker_t;
+
+static profile_thinker_t* thinkers;
+static int thinker_count;
+
+static FILE* trace_file;
+static dboolean trace_started;
+static dsda_string_t summary_path;
+static char map_name[9];
+static int map_tics;
+
+static unsigned long long dsda_ProfileNow(void) {
+  return dsda_ElapsedTimeNS(dsda_timer_profiler);
+}
+
+static void dsda_TraceEvent(const char* format, ...) {
+  va_list v;
+
+  fprintf(trace_file, trace_started ? ",\n" : "\n");
+  trace_started = true;
+
+  va_start(v, format);
+  vfprintf(trace_file, format, v);
+  va_end(v);
+}
+
+static void dsda_TraceComplete(const char* name, unsigned long long start,
+                               unsigned long long duration, int calls) {
+  dsda_TraceEvent(
+    "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+    "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"calls\":%d,\"tic\":%d}}",
+    name, map_name, (double) start / 1000, (double) duration / 1000, calls, gametic
+  );
+}
+
+static void dsda_TraceCounter(const char* name, unsigned long long time, int calls) {
+  dsda_TraceEvent(
+    "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":%.3f,"
+    "\"args\":{\"us\":%.3f,\"calls\":%d}}",
+    name, (double) zones[dsda_profile_ticker].start / 1000, (double) time / 1000, calls
+  );
+}
+
+static profile_thinker_t* dsda_ProfileThinkerEntry(think_t function) {
+  int i;
+  const thinker_name_t* info;
+
+  for (i = 0; i < thinker_count; ++i)
+    if (thinkers[i].info->function == function)
+      return &thinkers[i];
+
+  for (info = thinker_names; info->function; ++info)
+    if (info->function == function)
+      break;
+
+  // Unnamed thinkers share the last entry
+  if (!info->function)
+    for (i = 0; i < thinker_count; ++i)
+      if (!thinkers[i].info->function)
+        return &thinkers[i];
+
+  thinkers = Z_Realloc(thinkers, (thinker_count + 1) * sizeof(*thinkers));
+  memset(&thinkers[thinker_count], 0, sizeof(*thinkers));
+  thinkers[thinker_count].info = info;
+
+  return &thinkers[thinker_count++];
+}
+
+void dsda_ProfileThinker(thinker_t* thinker) {
+  think_t function;
+  profile_thinker_t* entry;
+  unsigned long long start;
+
+  // The thinker may free itself, so look up the entry first
+  function = thinker->function;
+  entry = dsda_ProfileThinkerEntry(function);
+
+  start = dsda_ProfileNow();
+  function(thinker);
+  entry->tic_time += dsda_ProfileNow() - start;
+  ++entry->tic_calls;
+}
+
+static void dsda_TraceThinkers(unsigned long long start) {
+  int i;
+
+  // Thinker classes are interleaved in the list, so the breakdown is laid
+  //   out back to back inside the P_RunThinkers span
+  for (i = 0; i < thinker_count; ++i) {
+    profile_thinker_t* entry = &thinkers[i];
+
+    if (!entry->tic_calls)
+      continue;
+
+    dsda_TraceComplete(entry->info->name, start, entry->tic_time, entry->tic_calls);
+    start += entry->tic_time;
+
+    entry->map_time += entry->tic_time;
+    entry->map_calls += entry->tic_calls;
+    entry->tic_time = 0;
+    entry->tic_calls = 0;
+  }
+}
+
+static void dsda_EndProfileTic(void) {
+  int i;
+
+  ++map_tics;
+
+  for (i = 0; i < DSDA_PROFILE_ZONE_COUNT; ++i) {
+    profile_zone_t* zone = &zones[i];
+
+    if (i == dsda_profile_sight || i == dsda_profile_sight_uncached ||
+        i == dsda_profile_path_traverse)
+      dsda_TraceCounter(zone->name, zone->tic_time, zone->tic_calls);
+
+    zone->map_time += zone->tic_time;
+    zone->map_calls += zone->tic_calls;
+    if (zone->tic_time > zone->map_max_tic)
+      zone->map_max_tic = zone->tic_time;
+
+    zone->tic_time = 0;
+    zone->tic_calls = 0;
+  }
+}
+
+void dsda_ProfileBegin(dsda_profile_zone_t zone) {
+  if (zones[zone].depth++)
+    return;
+
+  zones[zone].start = dsda_ProfileNow();
+}
+
+void dsda_ProfileEnd(dsda_profile_zone_t zone) {
+  unsigned long long duration;
+
+  if (--zones[zone].depth)
+    return;
+
+  duration = dsda_ProfileNow() - zones[zone].start;
+  zones[zone].tic_time += duration;
+  ++zones[zone].tic_calls;
+
+  switch (zone) {
+    case dsda_profile_ticker:
+      dsda_TraceComplete(zones[zone].name, zones[zone].start, duration, 1);
+      dsda_EndProfileTic();
+      break;
+    case dsda_profile_thinkers:
+      dsda_TraceComplete(zones[zone].name, zones[zone].start, duration, 1);
+      dsda_TraceThinkers(zones[zone].start);
+      break;
+    case dsda_profile_specials:
+    case dsda_profile_render:
+      dsda_TraceComplete(zones[zone].name, zones[zone].start, duration, 1);
+      break;
+    default:
+      break;
+  }
+}
+
+typedef struct {
+  const char* name;
+  unsigned long long time;
+  unsigned long long max_tic;
+  int calls;
+} summary_row_t;
+
+static int C_DECL dicmp_summary_row(const void* a, const void* b) {
+  const summary_row_t* r1 = (const summary_row_t *) a;
+  const summary_row_t* r2 = (const summary_row_t *) b;
+
+  return r1->time < r2->time ? 1 : r1->time > r2->time ? -1 : 0;
+}
+
+static void dsda_PrintSummaryRow(FILE* fstream, summary_row_t* row) {
+  char line[160];
+
+  snprintf(line, sizeof(line), "%-40s %10d %12.3f %12.3f %12.3f\n",
+           row->name, row->calls, (double) row->time / 1000000,
+           map_tics ? (double) row->time / 1000 / map_tics : 0.0,
+           (double) row->max_tic / 1000000);
+
+  lprintf(LO_INFO, "%s", line);
+  if (fstream)
+    fputs(line, fstream);
+}
+
+// Hits are priced at the average full check, less the time they took
+static void dsda_PrintSightCacheSummary(FILE* fstream) {
+  char line[160];
+  int calls, misses, hits;
+  unsigned long long hit_time;
+  double saved;
+
+  calls = zones[dsda_profile_sight].map_calls;
+  misses = zones[dsda_profile_sight_uncached].map_calls;
+  hits = calls - misses;
+
+  if (!calls || !misses)
+    return;
+
+  hit_time = zones[dsda_profile_sight].map_time - zones[dsda_profile_sight_uncached].map_time;
+  saved = (double) zones[dsda_profile_sight_uncached].map_time * hits / misses - hit_time;
+
+  snprintf(line, sizeof(line), "sight cache: %d of %d checks hit (%.1f%%), %.3f ms saved\n",
+           hits, calls, 100.0 * hits / calls, saved / 1000000);
+
+  lprintf(LO_INFO, "%s", line);
+  if (fstream)
+    fputs(line, fstream);
+}
+
+static void dsda_WriteMapSummary(void) {
+  int i;
+  int row_count;
+  summary_row_t* rows;
+  FILE* fstream;
+  char header[160];
+
+  if (!map_tics)
+    return;
+
+  row_count = 0;
+  rows = Z_Malloc((DSDA_PROFILE_ZONE_COUNT + thinker_count) * sizeof(*rows));
+
+  for (i = 0; i < DSDA_PROFILE_ZONE_COUNT; ++i) {
+    rows[row_count].name = zones[i].name;
+    rows[row_count].time = zones[i].map_time;
+    rows[row_count].max_tic = zones[i].map_max_tic;
+    rows[row_count].calls = zones[i].map_calls;
+    ++row_count;
+  }
+
+  for (i = 0; i < thinker_count; ++i) {
+    rows[row_count].name = thinkers[i].info->name;
+    rows[row_count].time = thinkers[i].map_time;
+    rows[row_count].max_tic = 0;
+    rows[row_count].calls = thinkers[i].map_calls;
+    ++row_count;
+
+    thinkers[i].map_time = 0;
+    thinkers[i].map_calls = 0;
+  }
+
+  qsort(rows, row_count, sizeof(*rows), dicmp_summary_row);
+
+  fstream = M_OpenFile(summary_path.string, "a");
+
+  snprintf(header, sizeof(header), "\n%s: %d tics\n%-40s %10s %12s %12s %12s\n",
+           map_name, map_tics, "zone", "calls", "total ms", "us / tic", "max tic ms");
+  lprintf(LO_INFO, "%s", header);
+  if (fstream)
+    fputs(header, fstream);
+
+  for (i = 0; i < row_count; ++i)
+    dsda_PrintSummaryRow(fstream, &rows[i]);
+
+  dsda_PrintSightCacheSummary(fstream);
+
+  for (i = 0; i < DSDA_PROFILE_ZONE_COUNT; ++i) {
+    zones[i].map_time = 0;
+    zones[i].map_max_tic = 0;
+    zones[i].map_calls = 0;
+  }
+
+  if (fstream)
+    fclose(fstream);
+
+  Z_Free(rows);
+
+  map_tics = 0;
+}
+
+void dsda_ProfilerNewMap(void) {
+  if (!dsda_profiling)
+    return;
+
+  dsda_WriteMapSummary();
+
+  strncpy(map_name, dsda_MapLumpName(gameepisode, gamemap), 8);
+  map_name[8] = '\0';
+}
+
+static void dsda_FinishProfiler(void) {
+  dsda_WriteMapSummary();
+
+  fprintf(trace_file, "\n]}\n");
+  fclose(trace_file);
+
+  dsda_profiling = false;
+}
+
+void dsda_InitProfiler(const char* filename) {
+  dsda_string_t base;
+
+  trace_file = M_OpenFile(filename, "w");
+  if (!trace_file)
+    I_Error("dsda_InitProfiler: unable to open %s", filename);
+
+  dsda_InitString(&base, filename);
+  dsda_CutExtension(base.string);
+  dsda_StringPrintF(&summary_path, "%s_summary.txt", base.string);
+  dsda_FreeString(&base);
+
+  M_remove(summary_path.string);
+
+  fprintf(trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  dsda_StartTimer(dsda_timer_profiler);
+  dsda_profiling = true;
+
+  I_AtExit(dsda_FinishProfiler, true, "dsda_FinishProfiler", exit_priority_normal);
+}
@@ -0,0 +1,46 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Profiler
+//
+
+#ifndef __DSDA_PROFILER__
+#define __DSDA_PROFILER__
+
+#include "d_think.h"
+#include "doomtype.h"
+
+typedef enum {
+  dsda_profile_ticker,
+  dsda_profile_thinkers,
+  dsda_profile_specials,
+  dsda_profile_sight,
+  dsda_profile_sight_uncached,
+  dsda_profile_path_traverse,
+  dsda_profile_render,
+  DSDA_PROFILE_ZONE_COUNT
+} dsda_profile_zone_t;
+
+extern dboolean dsda_profiling;
+
+#define DSDA_PROFILE_BEGIN(x) { if (dsda_profiling) dsda_ProfileBegin(x); }
+#define DSDA_PROFILE_END(x) { if (dsda_profiling) dsda_ProfileEnd(x); }
+
+void dsda_InitProfiler(const char* filename);
+void dsda_ProfileBegin(dsda_profile_zone_t zone);
+void dsda_ProfileEnd(dsda_profile_zone_t zone);
+void dsda_ProfileThinker(thinker_t* thinker);
+void dsda_ProfilerNewMap(void);
+
+#endif
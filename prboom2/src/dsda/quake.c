@@ -78,7 +78,7 @@ void dsda_SpawnQuake(mobj_t* location, int intensity, int duration,
                      int damage_radius, int tremor_radius) {
   quake_t* quake;
 
-  quake = Z_MallocLevel(sizeof(*quake));
+  quake = P_MallocThinker(sizeof(*quake));
   memset(quake, 0, sizeof(*quake));
   P_AddThinker(&quake->thinker);
   quake->thinker.function = dsda_UpdateQuake;
@@ -380,7 +380,7 @@ static void dsda_InitControlScroller(control_scroll_t* scroll, int control, int
 void dsda_AddSideScroller(fixed_t dx, fixed_t dy, int affectee, int flags) {
   scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->thinker.function = dsda_UpdateSideScroller;
   dsda_InitScroller(scroll, dx, dy, affectee, flags);
   P_AddThinker(&scroll->thinker);
@@ -390,7 +390,7 @@ void dsda_AddControlSideScroller(fixed_t dx, fixed_t dy,
                                  int control, int affectee, int accel, int flags) {
   control_scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->scroll.thinker.function = dsda_UpdateControlSideScroller;
   dsda_InitScroller(&scroll->scroll, dx, dy, affectee, flags);
   dsda_InitControlScroller(scroll, control, accel);
@@ -400,7 +400,7 @@ void dsda_AddControlSideScroller(fixed_t dx, fixed_t dy,
 void dsda_AddFloorScroller(fixed_t dx, fixed_t dy, int affectee, int flags) {
   scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->thinker.function = dsda_UpdateFloorScroller;
   dsda_InitScroller(scroll, dx, dy, affectee, flags);
   P_AddThinker(&scroll->thinker);
@@ -410,7 +410,7 @@ void dsda_AddControlFloorScroller(fixed_t dx, fixed_t dy,
                                   int control, int affectee, int accel, int flags) {
   control_scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->scroll.thinker.function = dsda_UpdateControlFloorScroller;
   dsda_InitScroller(&scroll->scroll, dx, dy, affectee, flags);
   dsda_InitControlScroller(scroll, control, accel);
@@ -420,7 +420,7 @@ void dsda_AddControlFloorScroller(fixed_t dx, fixed_t dy,
 void dsda_AddCeilingScroller(fixed_t dx, fixed_t dy, int affectee, int flags) {
   scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->thinker.function = dsda_UpdateCeilingScroller;
   dsda_InitScroller(scroll, dx, dy, affectee, flags);
   P_AddThinker(&scroll->thinker);
@@ -430,7 +430,7 @@ void dsda_AddControlCeilingScroller(fixed_t dx, fixed_t dy,
                                     int control, int affectee, int accel, int flags) {
   control_scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->scroll.thinker.function = dsda_UpdateControlCeilingScroller;
   dsda_InitScroller(&scroll->scroll, dx, dy, affectee, flags);
   dsda_InitControlScroller(scroll, control, accel);
@@ -440,7 +440,7 @@ void dsda_AddControlCeilingScroller(fixed_t dx, fixed_t dy,
 void dsda_AddFloorCarryScroller(fixed_t dx, fixed_t dy, int affectee, int flags) {
   scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->thinker.function = dsda_UpdateFloorCarryScroller;
   dsda_InitScroller(scroll, dx, dy, affectee, flags);
   P_AddThinker(&scroll->thinker);
@@ -450,7 +450,7 @@ void dsda_AddControlFloorCarryScroller(fixed_t dx, fixed_t dy,
                                        int control, int affectee, int accel, int flags) {
   control_scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->scroll.thinker.function = dsda_UpdateControlFloorCarryScroller;
   dsda_InitScroller(&scroll->scroll, dx, dy, affectee, flags);
   dsda_InitControlScroller(scroll, control, accel);
@@ -460,7 +460,7 @@ void dsda_AddControlFloorCarryScroller(fixed_t dx, fixed_t dy,
 void dsda_AddZDoomFloorScroller(fixed_t dx, fixed_t dy, int affectee, int flags) {
   scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->thinker.function = dsda_UpdateZDoomFloorScroller;
   dsda_InitScroller(scroll, dx, dy, affectee, flags);
   P_AddThinker(&scroll->thinker);
@@ -469,7 +469,7 @@ void dsda_AddZDoomFloorScroller(fixed_t dx, fixed_t dy, int affectee, int flags)
 void dsda_AddZDoomCeilingScroller(fixed_t dx, fixed_t dy, int affectee, int flags) {
   scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->thinker.function = dsda_UpdateZDoomCeilingScroller;
   dsda_InitScroller(scroll, dx, dy, affectee, flags);
   P_AddThinker(&scroll->thinker);
@@ -478,7 +478,7 @@ void dsda_AddZDoomCeilingScroller(fixed_t dx, fixed_t dy, int affectee, int flag
 void dsda_AddThruster(fixed_t dx, fixed_t dy, int affectee, int flags) {
   scroll_t* scroll;
 
-  scroll = Z_MallocLevel(sizeof(*scroll));
+  scroll = P_MallocThinker(sizeof(*scroll));
   scroll->thinker.function = dsda_UpdateThruster;
   dsda_InitScroller(scroll, dx, dy, affectee, flags);
   P_AddThinker(&scroll->thinker);
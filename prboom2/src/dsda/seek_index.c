@@ -0,0 +1,446 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Seek Index
+//
+//  Stores compressed key frames of user demo playback on disk, keyed by
+//  the demo, the loaded files, and the build, so that later playbacks can
+//  jump close to any tic.
+//  The index is filled in as the demo plays and rewritten on exit.
+//  The least recently written indexes are deleted once the directory
+//  goes over SEEK_INDEX_MAX_BYTES.
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "SDL.h"
+
+#include "d_event.h"
+#include "doomstat.h"
+#include "i_glob.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "md5.h"
+#include "r_defs.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/configuration.h"
+#include "dsda/data_organizer.h"
+#include "dsda/key_frame.h"
+#include "dsda/utility.h"
+#include "dsda/zipfile.h"
+
+#include "seek_index.h"
+
+#define SEEK_INDEX_MAGIC "DSDASEEK"
+#define SEEK_INDEX_FORMAT 2
+#define SEEK_INDEX_VERSION_SIZE 32
+#define SEEK_INDEX_MAX_BYTES (256 * 1024 * 1024)
+
+typedef struct {
+  int tic;
+  int length;
+  int compressed_length;
+  byte* data;
+} seek_entry_t;
+
+static seek_entry_t* entries;
+static int entry_count;
+static dboolean index_dirty;
+static char* index_path;
+static char* index_dir;
+
+static int dsda_SeekIndexInterval(void) {
+  return dsda_IntConfig(dsda_config_seek_index_interval) * TICRATE;
+}
+
+// Index of the first entry after the given tic
+static int dsda_SeekEntryAfter(int tic) {
+  int low = 0;
+  int high = entry_count;
+
+  while (low < high) {
+    int mid = (low + high) / 2;
+
+    if (entries[mid].tic <= tic)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+static void dsda_FreeSeekEntries(void) {
+  int i;
+
+  for (i = 0; i < entry_count; ++i)
+    Z_Free(entries[i].data);
+
+  Z_Free(entries);
+  entries = NULL;
+  entry_count = 0;
+}
+
+static void dsda_InsertSeekEntry(seek_entry_t* entry) {
+  int i;
+
+  i = dsda_SeekEntryAfter(entry->tic);
+
+  entries = Z_Realloc(entries, (entry_count + 1) * sizeof(*entries));
+  memmove(&entries[i + 1], &entries[i], (entry_count - i) * sizeof(*entries));
+  entries[i] = *entry;
+  ++entry_count;
+}
+
+static const char* dsda_SeekIndexVersion(void) {
+  static char version[SEEK_INDEX_VERSION_SIZE];
+
+  // Key frames are only valid for the build that wrote them
+  snprintf(version, sizeof(version), "%s %d", PACKAGE_VERSION, (int) sizeof(void*));
+
+  return version;
+}
+
+static void dsda_ReadSeekIndex(void) {
+  byte* buffer;
+  const byte* p;
+  const byte* end;
+  int length;
+  int count;
+  int format;
+
+  length = M_ReadFile(index_path, &buffer);
+  if (length <= 0)
+    return;
+
+  p = buffer;
+  end = buffer + length;
+
+#define READ_SEEK(x) { \
+  if (p + sizeof(x) > end) goto invalid; \
+  memcpy(&x, p, sizeof(x)); p += sizeof(x); \
+}
+
+  if (length < 8 || memcmp(p, SEEK_INDEX_MAGIC, 8))
+    goto invalid;
+  p += 8;
+
+  READ_SEEK(format);
+  if (format != SEEK_INDEX_FORMAT || p + SEEK_INDEX_VERSION_SIZE > end ||
+      strncmp((const char*) p, dsda_SeekIndexVersion(), SEEK_INDEX_VERSION_SIZE))
+    goto invalid;
+  p += SEEK_INDEX_VERSION_SIZE;
+
+  READ_SEEK(count);
+
+  while (count-- > 0) {
+    seek_entry_t entry;
+
+    READ_SEEK(entry.tic);
+    READ_SEEK(entry.length);
+    READ_SEEK(entry.compressed_length);
+
+    if (entry.compressed_length <= 0 || p + entry.compressed_length > end)
+      goto invalid;
+
+    entry.data = Z_Malloc(entry.compressed_length);
+    memcpy(entry.data, p, entry.compressed_length);
+    p += entry.compressed_length;
+
+    dsda_InsertSeekEntry(&entry);
+  }
+
+#undef READ_SEEK
+
+  Z_Free(buffer);
+
+  lprintf(LO_INFO, "dsda_ReadSeekIndex: loaded %d key frames\n", entry_count);
+
+  return;
+
+invalid:
+  lprintf(LO_WARN, "dsda_ReadSeekIndex: ignoring invalid index %s\n", index_path);
+  dsda_FreeSeekEntries();
+  Z_Free(buffer);
+  index_dirty = true;
+}
+
+typedef struct {
+  char* path;
+  int64_t size;
+  int64_t mtime;
+} seek_file_t;
+
+static int C_DECL dicmp_seek_files(const void* a, const void* b) {
+  const seek_file_t* file_a = a;
+  const seek_file_t* file_b = b;
+
+  return (file_a->mtime > file_b->mtime) - (file_a->mtime < file_b->mtime);
+}
+
+// Deletes the least recently written indexes until the directory fits
+static void dsda_TrimSeekIndexDir(void) {
+  glob_t* glob;
+  const char* filename;
+  seek_file_t* files = NULL;
+  int count = 0;
+  int i;
+  int64_t total = 0;
+
+  glob = I_StartGlob(index_dir, "*.idx", GLOB_FLAG_NOCASE);
+
+  while ((filename = I_NextGlob(glob))) {
+    seek_file_t file;
+
+    if (!M_FileInfo(filename, &file.size, &file.mtime))
+      continue;
+
+    file.path = Z_Strdup(filename);
+    files = Z_Realloc(files, (count + 1) * sizeof(*files));
+    files[count++] = file;
+    total += file.size;
+  }
+
+  I_EndGlob(glob);
+
+  qsort(files, count, sizeof(*files), dicmp_seek_files);
+
+  for (i = 0; i < count; ++i) {
+    if (total > SEEK_INDEX_MAX_BYTES && strcmp(files[i].path, index_path)) {
+      if (!M_remove(files[i].path))
+        total -= files[i].size;
+    }
+
+    Z_Free(files[i].path);
+  }
+
+  Z_Free(files);
+}
+
+// Written to a temporary file and renamed into place, so another process
+// reading or writing the same index never sees a partial file
+static void dsda_WriteSeekIndex(void) {
+  int i;
+  int format;
+  FILE* fstream;
+  dboolean failed;
+  dsda_string_t temp_path;
+  char version[SEEK_INDEX_VERSION_SIZE] = { 0 };
+
+  if (!index_dirty)
+    return;
+
+  dsda_StringPrintF(&temp_path, "%s.%u.tmp", index_path,
+                    (unsigned int) SDL_GetPerformanceCounter());
+
+  fstream = M_OpenFile(temp_path.string, "wb");
+  if (!fstream) {
+    lprintf(LO_WARN, "dsda_WriteSeekIndex: unable to open %s\n", temp_path.string);
+    dsda_FreeString(&temp_path);
+    return;
+  }
+
+  format = SEEK_INDEX_FORMAT;
+  strncpy(version, dsda_SeekIndexVersion(), sizeof(version) - 1);
+
+  fwrite(SEEK_INDEX_MAGIC, 8, 1, fstream);
+  fwrite(&format, sizeof(format), 1, fstream);
+  fwrite(version, sizeof(version), 1, fstream);
+  fwrite(&entry_count, sizeof(entry_count), 1, fstream);
+
+  for (i = 0; i < entry_count; ++i) {
+    fwrite(&entries[i].tic, sizeof(entries[i].tic), 1, fstream);
+    fwrite(&entries[i].length, sizeof(entries[i].length), 1, fstream);
+    fwrite(&entries[i].compressed_length, sizeof(entries[i].compressed_length), 1, fstream);
+    fwrite(entries[i].data, entries[i].compressed_length, 1, fstream);
+  }
+
+  failed = ferror(fstream);
+  failed |= fclose(fstream) != 0;
+
+  if (failed || M_rename(temp_path.string, index_path)) {
+    lprintf(LO_WARN, "dsda_WriteSeekIndex: unable to write %s\n", index_path);
+    M_remove(temp_path.string);
+  }
+  else
+    dsda_TrimSeekIndexDir();
+
+  dsda_FreeString(&temp_path);
+
+  index_dirty = false;
+}
+
+// Key frames are raw game state, so they only fit the same demo played
+// with the same files by a build with the same state layout.
+// Files are identified by path, size, and modification time rather than
+// by content, so starting playback doesn't read every lump.
+static void dsda_GetSeekIndexKey(dsda_cksum_t* key, const byte* demo, int length) {
+  struct MD5Context md5;
+  int i;
+  const int layout[] = {
+    sizeof(void*), sizeof(thinker_t), sizeof(mobj_t), sizeof(player_t),
+    sizeof(sector_t), sizeof(line_t), sizeof(side_t), sizeof(pspdef_t)
+  };
+
+  MD5Init(&md5);
+  MD5Update(&md5, demo, length);
+  MD5Update(&md5, (const md5byte*) PACKAGE_VERSION, strlen(PACKAGE_VERSION));
+  MD5Update(&md5, (const md5byte*) layout, sizeof(layout));
+
+  for (i = 0; i < (int) numwadfiles; ++i) {
+    const char* file;
+    int64_t identity[2] = { 0 };
+
+    // Zip members change with their archive
+    file = wadfiles[i].zip_member ? dsda_ZipMemberArchivePath(wadfiles[i].zip_member) :
+                                    wadfiles[i].name;
+
+    MD5Update(&md5, (const md5byte*) wadfiles[i].name, strlen(wadfiles[i].name) + 1);
+
+    if (M_FileInfo(file, &identity[0], &identity[1]))
+      MD5Update(&md5, (const md5byte*) identity, sizeof(identity));
+  }
+
+  // Names and sizes only, for lumps that don't come from a file on disk
+  for (i = 0; i < numlumps; ++i) {
+    int size;
+
+    size = W_LumpLength(i);
+    MD5Update(&md5, (const md5byte*) lumpinfo[i].name, sizeof(lumpinfo[i].name));
+    MD5Update(&md5, (const md5byte*) &size, sizeof(size));
+  }
+
+  MD5Final(key->bytes, &md5);
+  dsda_TranslateCheckSum(key);
+}
+
+void dsda_InitSeekIndex(const byte* demo, int length) {
+  dsda_cksum_t cksum;
+  dsda_string_t path;
+
+  // Only user demos, and only once per run
+  if (index_path || !userdemo || !dsda_SeekIndexInterval())
+    return;
+
+  // Helper processes play the same demo in parallel and never seek
+  if (dsda_Flag(dsda_arg_batch_worker) ||
+      dsda_Flag(dsda_arg_viddump_key_frames) ||
+      dsda_Flag(dsda_arg_viddump_temp))
+    return;
+
+  dsda_GetSeekIndexKey(&cksum, demo, length);
+
+  dsda_StringPrintF(&path, "%s/seek", dsda_DataDir());
+  M_MakeDir(path.string, false);
+  index_dir = Z_Strdup(path.string);
+  dsda_StringCatF(&path, "/%s.idx", cksum.string);
+  index_path = path.string;
+
+  dsda_ReadSeekIndex();
+
+  I_AtExit(dsda_WriteSeekIndex, true, "dsda_WriteSeekIndex", exit_priority_normal);
+}
+
+void dsda_UpdateSeekIndex(void) {
+  int i;
+  int interval;
+  uLongf compressed_length;
+  seek_entry_t entry;
+  dsda_key_frame_t key_frame = { 0 };
+
+  if (
+    !index_path ||
+    !demoplayback ||
+    demorecording ||
+    gamestate != GS_LEVEL ||
+    gameaction != ga_nothing
+  ) return;
+
+  interval = dsda_SeekIndexInterval();
+  if (!interval)
+    return;
+
+  // The start of the demo counts as an entry
+  i = dsda_SeekEntryAfter(true_logictic);
+  if (true_logictic - (i ? entries[i - 1].tic : 0) < interval ||
+      (i < entry_count && entries[i].tic - true_logictic < interval))
+    return;
+
+  dsda_StoreKeyFrame(&key_frame, false, false);
+
+  compressed_length = compressBound(key_frame.buffer_length);
+  entry.data = Z_Malloc(compressed_length);
+
+  if (compress2(entry.data, &compressed_length, key_frame.buffer,
+                key_frame.buffer_length, Z_BEST_SPEED) != Z_OK) {
+    Z_Free(entry.data);
+    Z_Free(key_frame.buffer);
+    return;
+  }
+
+  entry.tic = true_logictic;
+  entry.length = key_frame.buffer_length;
+  entry.compressed_length = compressed_length;
+  entry.data = Z_Realloc(entry.data, compressed_length);
+
+  Z_Free(key_frame.buffer);
+
+  dsda_InsertSeekEntry(&entry);
+  index_dirty = true;
+}
+
+// Restores the closest indexed key frame at or before tic,
+// but only if it comes after after_tic
+dboolean dsda_RestoreSeekKeyFrame(int tic, int after_tic) {
+  int i;
+  uLongf length;
+  dsda_key_frame_t key_frame = { 0 };
+
+  // Restoring would clobber the demo being recorded
+  if (!demoplayback || demorecording)
+    return false;
+
+  i = dsda_SeekEntryAfter(tic) - 1;
+  if (i < 0 || entries[i].tic <= after_tic)
+    return false;
+
+  length = entries[i].length;
+  key_frame.buffer = Z_Malloc(length);
+
+  if (uncompress(key_frame.buffer, &length, entries[i].data, entries[i].compressed_length) != Z_OK ||
+      length != entries[i].length) {
+    lprintf(LO_WARN, "dsda_RestoreSeekKeyFrame: corrupt key frame at tic %d\n", entries[i].tic);
+    Z_Free(key_frame.buffer);
+    return false;
+  }
+
+  key_frame.buffer_length = length;
+
+  dsda_RestoreKeyFrame(&key_frame, true);
+
+  Z_Free(key_frame.buffer);
+
+  return true;
+}
@@ -30,6 +30,7 @@
 #include "dsda/features.h"
 #include "dsda/pause.h"
 #include "dsda/playback.h"
+#include "dsda/seek_index.h"
 
 #include "skip.h"
 
@@ -156,6 +157,21 @@ void dsda_EvaluateSkipModeBuildTiccmd(void) {
       dsda_ExitSkipMode();
 }
 
+// Jump to the closest seek index key frame and skip the rest from there
+void dsda_EvaluateSkipModeSeekIndex(void) {
+  int tic;
+
+  if (!dsda_SkipMode() || !demo_skiptics || skip_until_map != -1 || skip_until_logictic)
+    return;
+
+  tic = demo_skiptics > 0 ?
+        demo_skiptics :
+        true_logictic + dsda_PlaybackTicsRemaining() + demo_skiptics;
+
+  if (dsda_RestoreSeekKeyFrame(tic, true_logictic + TICRATE))
+    skip_until_logictic = tic;
+}
+
 void dsda_EvaluateSkipModeDoCompleted(void) {
   if (dsda_SkipMode() && (skip_until_end_of_map || demo_warp_reached))
     dsda_ExitSkipMode();
@@ -27,6 +27,7 @@ void dsda_SkipToLogicTic(int tic);
 void dsda_EvaluateSkipModeGTicker(void);
 void dsda_EvaluateSkipModeInitNew(void);
 void dsda_EvaluateSkipModeBuildTiccmd(void);
+void dsda_EvaluateSkipModeSeekIndex(void);
 void dsda_EvaluateSkipModeDoCompleted(void);
 void dsda_EvaluateSkipModeDoTeleportNewMap(void);
 void dsda_EvaluateSkipModeDoWorldDone(void);
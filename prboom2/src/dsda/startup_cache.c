@@ -0,0 +1,255 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Startup Cache
+//
+//  Saves tables built from the wad directory so later runs with the same
+//  files can skip rebuilding them. The cache file is keyed by the wad
+//  headers and directories of every loaded file plus the build, and each
+//  section carries its own validation digest for anything else it uses.
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lprintf.h"
+#include "m_file.h"
+#include "md5.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/data_organizer.h"
+#include "dsda/utility.h"
+
+#include "startup_cache.h"
+
+#define STARTUP_CACHE_MAGIC "DSDASTRT"
+#define STARTUP_CACHE_FORMAT 1
+
+typedef struct {
+  byte validation[STARTUP_CACHE_VALIDATION_SIZE];
+  const byte* data;
+  int length;
+  dboolean owned;
+} cache_section_t;
+
+static cache_section_t sections[STARTUP_CACHE_SECTION_COUNT];
+static byte* cache_buffer;
+static char* cache_path;
+static dboolean cache_active;
+static dboolean cache_dirty;
+static struct MD5Context key_context;
+
+static void dsda_ResetStartupCacheSection(cache_section_t* section) {
+  if (section->owned)
+    Z_Free((void*) section->data);
+
+  memset(section, 0, sizeof(*section));
+}
+
+static void dsda_FreeStartupCache(void) {
+  int i;
+
+  for (i = 0; i < STARTUP_CACHE_SECTION_COUNT; ++i)
+    dsda_ResetStartupCacheSection(&sections[i]);
+
+  Z_Free(cache_buffer);
+  cache_buffer = NULL;
+
+  Z_Free(cache_path);
+  cache_path = NULL;
+
+  cache_active = false;
+  cache_dirty = false;
+}
+
+void dsda_StartStartupCache(void) {
+  char version[32];
+
+  dsda_FreeStartupCache();
+
+  if (dsda_Flag(dsda_arg_no_startup_cache))
+    return;
+
+  cache_active = true;
+
+  // Cached tables are only valid for the build that wrote them
+  snprintf(version, sizeof(version), "%s %d %d",
+           PACKAGE_VERSION, (int) sizeof(void*), STARTUP_CACHE_FORMAT);
+
+  MD5Init(&key_context);
+  MD5Update(&key_context, (const md5byte*) version, strlen(version));
+}
+
+void dsda_HashStartupCacheInput(const void* data, int length) {
+  if (!cache_active)
+    return;
+
+  MD5Update(&key_context, (const md5byte*) &length, sizeof(length));
+  MD5Update(&key_context, data, length);
+}
+
+static void dsda_ReadStartupCache(void) {
+  const byte* p;
+  const byte* end;
+  int length;
+  int format;
+
+  length = M_ReadFile(cache_path, &cache_buffer);
+  if (length <= 0) {
+    Z_Free(cache_buffer);
+    cache_buffer = NULL;
+    return;
+  }
+
+  p = cache_buffer;
+  end = cache_buffer + length;
+
+#define READ_STARTUP(x) { \
+  if (p + sizeof(x) > end) goto invalid; \
+  memcpy(&x, p, sizeof(x)); p += sizeof(x); \
+}
+
+  if (length < 8 || memcmp(p, STARTUP_CACHE_MAGIC, 8))
+    goto invalid;
+  p += 8;
+
+  READ_STARTUP(format);
+  if (format != STARTUP_CACHE_FORMAT)
+    goto invalid;
+
+  while (p < end) {
+    int id;
+    cache_section_t* section;
+
+    READ_STARTUP(id);
+    if (id < 0 || id >= STARTUP_CACHE_SECTION_COUNT)
+      goto invalid;
+
+    section = &sections[id];
+    READ_STARTUP(section->validation);
+    READ_STARTUP(section->length);
+
+    if (section->length < 0 || p + section->length > end)
+      goto invalid;
+
+    section->data = p;
+    p += section->length;
+  }
+
+#undef READ_STARTUP
+
+  return;
+
+invalid:
+  lprintf(LO_WARN, "dsda_ReadStartupCache: ignoring invalid cache %s\n", cache_path);
+
+  for (length = 0; length < STARTUP_CACHE_SECTION_COUNT; ++length)
+    dsda_ResetStartupCacheSection(&sections[length]);
+
+  Z_Free(cache_buffer);
+  cache_buffer = NULL;
+}
+
+void dsda_LoadStartupCache(void) {
+  dsda_cksum_t key;
+  dsda_string_t path;
+
+  if (!cache_active)
+    return;
+
+  MD5Final(key.bytes, &key_context);
+  dsda_TranslateCheckSum(&key);
+
+  dsda_StringPrintF(&path, "%s/startup_cache", dsda_DataRoot());
+  M_MakeDir(path.string, false);
+  dsda_StringCatF(&path, "/%s.cache", key.string);
+  cache_path = path.string;
+
+  dsda_ReadStartupCache();
+}
+
+static void dsda_WriteStartupCache(void) {
+  int i;
+  int format;
+  FILE* fstream;
+
+  fstream = M_OpenFile(cache_path, "wb");
+  if (!fstream) {
+    lprintf(LO_WARN, "dsda_WriteStartupCache: unable to open %s\n", cache_path);
+    return;
+  }
+
+  format = STARTUP_CACHE_FORMAT;
+
+  fwrite(STARTUP_CACHE_MAGIC, 8, 1, fstream);
+  fwrite(&format, sizeof(format), 1, fstream);
+
+  for (i = 0; i < STARTUP_CACHE_SECTION_COUNT; ++i) {
+    if (!sections[i].data)
+      continue;
+
+    fwrite(&i, sizeof(i), 1, fstream);
+    fwrite(sections[i].validation, sizeof(sections[i].validation), 1, fstream);
+    fwrite(&sections[i].length, sizeof(sections[i].length), 1, fstream);
+    fwrite(sections[i].data, sections[i].length, 1, fstream);
+  }
+
+  fclose(fstream);
+}
+
+// Startup is over once everything has had its chance to use the cache
+void dsda_SaveStartupCache(void) {
+  if (cache_active && cache_dirty)
+    dsda_WriteStartupCache();
+
+  dsda_FreeStartupCache();
+}
+
+const byte* dsda_StartupCacheSection(startup_cache_section_t id, const byte* validation, int* length) {
+  cache_section_t* section = &sections[id];
+
+  if (!cache_active || !section->data ||
+      memcmp(section->validation, validation, sizeof(section->validation)))
+    return NULL;
+
+  *length = section->length;
+
+  return section->data;
+}
+
+void dsda_StoreStartupCacheSection(startup_cache_section_t id, const byte* validation,
+                                   const void* data, int length) {
+  byte* copy;
+  cache_section_t* section = &sections[id];
+
+  if (!cache_active)
+    return;
+
+  dsda_ResetStartupCacheSection(section);
+
+  copy = Z_Malloc(length);
+  memcpy(copy, data, length);
+
+  memcpy(section->validation, validation, sizeof(section->validation));
+  section->data = copy;
+  section->length = length;
+  section->owned = true;
+
+  cache_dirty = true;
+}
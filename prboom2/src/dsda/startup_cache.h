@@ -0,0 +1,40 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Startup Cache
+//
+
+#ifndef __DSDA_STARTUP_CACHE__
+#define __DSDA_STARTUP_CACHE__
+
+#include "doomtype.h"
+
+typedef enum {
+  startup_cache_lump_directory,
+  startup_cache_textures,
+  startup_cache_sprites,
+  STARTUP_CACHE_SECTION_COUNT,
+} startup_cache_section_t;
+
+#define STARTUP_CACHE_VALIDATION_SIZE 16
+
+void dsda_StartStartupCache(void);
+void dsda_HashStartupCacheInput(const void* data, int length);
+void dsda_LoadStartupCache(void);
+void dsda_SaveStartupCache(void);
+const byte* dsda_StartupCacheSection(startup_cache_section_t id, const byte* validation, int* length);
+void dsda_StoreStartupCacheSection(startup_cache_section_t id, const byte* validation,
+                                   const void* data, int length);
+
+#endif
@@ -0,0 +1,229 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Startup Jobs
+//
+//  Runs independent startup work on worker threads. The work function of
+//  a job runs on any thread and must not touch zone memory, the lump cache
+//  or other shared state; everything it needs is prepared up front. The
+//  finish function runs on the main thread, and jobs are always finished
+//  in the order they were queued, so the results do not depend on timing.
+//
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "i_system.h"
+#include "lprintf.h"
+
+#include "startup_jobs.h"
+
+#define MAX_STARTUP_JOBS 256
+#define MAX_STARTUP_WORKERS 16
+
+typedef enum {
+  job_queued,
+  job_running,
+  job_done,
+  job_finished,
+} job_state_t;
+
+typedef struct {
+  startup_job_func_t work;
+  startup_job_func_t finish;
+  void* data;
+  job_state_t state;
+} startup_job_t;
+
+static startup_job_t jobs[MAX_STARTUP_JOBS];
+static int job_count;
+static int next_job;      // next job for a worker to pick up
+static int next_finish;   // next job to finish on the main thread
+static dboolean closing;
+static dboolean joined;
+
+static SDL_Thread* workers[MAX_STARTUP_WORKERS];
+static int worker_count;
+static SDL_mutex* job_mutex;
+static SDL_cond* job_queued_cond;
+static SDL_cond* job_done_cond;
+
+static int dsda_StartupJobWorker(void* unused) {
+  SDL_LockMutex(job_mutex);
+
+  while (1) {
+    startup_job_t* job;
+
+    if (next_job >= job_count) {
+      if (closing)
+        break;
+
+      SDL_CondWait(job_queued_cond, job_mutex);
+      continue;
+    }
+
+    job = &jobs[next_job++];
+    job->state = job_running;
+    SDL_UnlockMutex(job_mutex);
+
+    job->work(job->data);
+
+    SDL_LockMutex(job_mutex);
+    job->state = job_done;
+    SDL_CondBroadcast(job_done_cond);
+  }
+
+  SDL_UnlockMutex(job_mutex);
+
+  return 0;
+}
+
+static void dsda_StartStartupWorkers(void) {
+  int i;
+  int count;
+
+  count = SDL_GetCPUCount() - 1;
+  if (count > MAX_STARTUP_WORKERS)
+    count = MAX_STARTUP_WORKERS;
+
+  if (count < 1)
+    return;
+
+  job_mutex = SDL_CreateMutex();
+  job_queued_cond = SDL_CreateCond();
+  job_done_cond = SDL_CreateCond();
+
+  if (!job_mutex || !job_queued_cond || !job_done_cond)
+    I_Error("dsda_StartStartupWorkers: %s", SDL_GetError());
+
+  for (i = 0; i < count; ++i) {
+    workers[worker_count] = SDL_CreateThread(dsda_StartupJobWorker, "dsda_StartupJobWorker", NULL);
+
+    // Whatever workers did start are enough
+    if (!workers[worker_count]) {
+      lprintf(LO_WARN, "dsda_StartStartupWorkers: %s\n", SDL_GetError());
+      break;
+    }
+
+    ++worker_count;
+  }
+}
+
+static void dsda_FinishStartupJob(startup_job_t* job) {
+  if (job->finish)
+    job->finish(job->data);
+
+  job->state = job_finished;
+}
+
+// Without workers, the work runs right away and the finish waits its turn
+static void dsda_RunStartupJob(startup_job_t* job) {
+  job->work(job->data);
+  job->state = job_done;
+}
+
+int dsda_QueueStartupJob(startup_job_func_t work, startup_job_func_t finish, void* data) {
+  int id;
+  startup_job_t* job;
+
+  // Once the pool is joined, or when the queue is full, the job runs right
+  //   away on the main thread, after everything queued before it
+  if (joined || job_count == MAX_STARTUP_JOBS) {
+    startup_job_t inline_job = { work, finish, data, job_queued };
+
+    if (job_count)
+      dsda_WaitStartupJob(job_count - 1);
+
+    dsda_RunStartupJob(&inline_job);
+    dsda_FinishStartupJob(&inline_job);
+
+    return -1;
+  }
+
+  if (!job_count)
+    dsda_StartStartupWorkers();
+
+  id = job_count;
+  job = &jobs[id];
+  job->work = work;
+  job->finish = finish;
+  job->data = data;
+  job->state = job_queued;
+
+  if (!worker_count) {
+    ++job_count;
+    dsda_RunStartupJob(job);
+
+    return id;
+  }
+
+  SDL_LockMutex(job_mutex);
+  ++job_count;
+  SDL_CondSignal(job_queued_cond);
+  SDL_UnlockMutex(job_mutex);
+
+  return id;
+}
+
+// Finishes every job up to and including this one
+void dsda_WaitStartupJob(int id) {
+  if (id < 0)
+    return;
+
+  if (id >= job_count)
+    I_Error("dsda_WaitStartupJob: unknown job %d", id);
+
+  while (next_finish <= id) {
+    startup_job_t* job = &jobs[next_finish];
+
+    if (worker_count) {
+      SDL_LockMutex(job_mutex);
+      while (job->state != job_done)
+        SDL_CondWait(job_done_cond, job_mutex);
+      SDL_UnlockMutex(job_mutex);
+    }
+
+    dsda_FinishStartupJob(job);
+    ++next_finish;
+  }
+}
+
+void dsda_JoinStartupJobs(void) {
+  int i;
+
+  if (joined)
+    return;
+
+  if (job_count)
+    dsda_WaitStartupJob(job_count - 1);
+
+  joined = true;
+
+  if (!worker_count)
+    return;
+
+  SDL_LockMutex(job_mutex);
+  closing = true;
+  SDL_CondBroadcast(job_queued_cond);
+  SDL_UnlockMutex(job_mutex);
+
+  for (i = 0; i < worker_count; ++i)
+    SDL_WaitThread(workers[i], NULL);
+
+  worker_count = 0;
+
+  SDL_DestroyCond(job_done_cond);
+  SDL_DestroyCond(job_queued_cond);
+  SDL_DestroyMutex(job_mutex);
+}
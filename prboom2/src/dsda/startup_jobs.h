@@ -0,0 +1,27 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Startup Jobs
+//
+
+#ifndef __DSDA_STARTUP_JOBS__
+#define __DSDA_STARTUP_JOBS__
+
+typedef void (*startup_job_func_t)(void* data);
+
+int dsda_QueueStartupJob(startup_job_func_t work, startup_job_func_t finish, void* data);
+void dsda_WaitStartupJob(int id);
+void dsda_JoinStartupJobs(void);
+
+#endif
@@ -0,0 +1,233 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Startup Profile
+//
+//  Times the phases of startup, through the first level setup and the
+//  first rendered frame, and reports them as a table and as json.
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "w_wad.h"
+
+#include "dsda/args.h"
+#include "dsda/time.h"
+#include "dsda/utility.h"
+
+#include "startup_profile.h"
+
+typedef struct {
+  const char* name;
+  int parent;
+  dboolean open;
+  dboolean done;
+  unsigned long long start; // nanoseconds since the profile started
+  unsigned long long time;
+} startup_phase_t;
+
+static startup_phase_t phases[DSDA_STARTUP_PHASE_COUNT] = {
+  [dsda_startup_setup] = { "D_DoomMainSetup" },
+  [dsda_startup_wad_files] = { "W_Init" },
+  [dsda_startup_dehacked] = { "DEHACKED" },
+  [dsda_startup_misc] = { "M_Init" },
+  [dsda_startup_sndinfo] = { "SNDINFO" },
+  [dsda_startup_renderer] = { "R_Init" },
+  [dsda_startup_mapinfo] = { "MAPINFO" },
+  [dsda_startup_playloop] = { "P_Init" },
+  [dsda_startup_system] = { "I_Init" },
+  [dsda_startup_sound] = { "S_Init" },
+  [dsda_startup_fonts] = { "dsda_InitFont" },
+  [dsda_startup_graphics] = { "I_InitGraphics" },
+  [dsda_startup_opengl] = { "gld_Init" },
+  [dsda_startup_status_bar] = { "ST_Init" },
+  [dsda_startup_level] = { "P_SetupLevel" },
+  [dsda_startup_tranmap] = { "tranmap" },
+  [dsda_startup_first_frame] = { "first frame" },
+};
+
+static const char* report_filename;
+static int open_phases[DSDA_STARTUP_PHASE_COUNT];
+static int open_phase_count;
+static unsigned long long total_time;
+
+static unsigned long long dsda_StartupProfileNow(void) {
+  return dsda_ElapsedTimeNS(dsda_timer_startup_profile);
+}
+
+static int C_DECL dicmp_startup_phase(const void* a, const void* b) {
+  const startup_phase_t* p1 = *(const startup_phase_t * const *) a;
+  const startup_phase_t* p2 = *(const startup_phase_t * const *) b;
+
+  return p1->time < p2->time ? 1 : p1->time > p2->time ? -1 : 0;
+}
+
+static void dsda_PrintStartupTable(void) {
+  int i;
+  int count;
+  startup_phase_t* sorted[DSDA_STARTUP_PHASE_COUNT];
+
+  count = 0;
+  for (i = 0; i < DSDA_STARTUP_PHASE_COUNT; ++i)
+    if (phases[i].done)
+      sorted[count++] = &phases[i];
+
+  qsort(sorted, count, sizeof(*sorted), dicmp_startup_phase);
+
+  lprintf(LO_INFO, "\nStartup profile: %.3f ms\n%-20s %-20s %12s %8s\n",
+          (double) total_time / 1000000, "phase", "within", "ms", "%");
+
+  for (i = 0; i < count; ++i)
+    lprintf(LO_INFO, "%-20s %-20s %12.3f %8.1f\n",
+            sorted[i]->name,
+            sorted[i]->parent >= 0 ? phases[sorted[i]->parent].name : "",
+            (double) sorted[i]->time / 1000000,
+            total_time ? (double) sorted[i]->time * 100 / total_time : 0.0);
+}
+
+static void dsda_WriteJSONString(FILE* fstream, const char* str) {
+  fputc('"', fstream);
+
+  for (; *str; ++str) {
+    if (*str == '"' || *str == '\\')
+      fprintf(fstream, "\\%c", *str);
+    else if ((unsigned char) *str < 0x20)
+      fprintf(fstream, "\\u%04x", (unsigned char) *str);
+    else
+      fputc(*str, fstream);
+  }
+
+  fputc('"', fstream);
+}
+
+static void dsda_WriteStartupReport(void) {
+  int i;
+  dboolean first;
+  FILE* fstream;
+
+  fstream = M_OpenFile(report_filename, "w");
+  if (!fstream) {
+    lprintf(LO_ERROR, "dsda_WriteStartupReport: unable to open %s\n", report_filename);
+    return;
+  }
+
+  fprintf(fstream, "{\n");
+  fprintf(fstream, "  \"version\": \"%s\",\n", PACKAGE_VERSION);
+  fprintf(fstream, "  \"total_ms\": %.3f,\n", (double) total_time / 1000000);
+  fprintf(fstream, "  \"files\": [");
+
+  first = true;
+  for (i = 0; i < (int) numwadfiles; ++i) {
+    if (wadfiles[i].src == source_skip)
+      continue;
+
+    fprintf(fstream, "%s\n    ", first ? "" : ",");
+    first = false;
+    dsda_WriteJSONString(fstream, dsda_BaseName(wadfiles[i].name));
+  }
+
+  fprintf(fstream, "\n  ],\n  \"phases\": [");
+
+  // Phases are listed in the order they are declared, which follows startup
+  first = true;
+  for (i = 0; i < DSDA_STARTUP_PHASE_COUNT; ++i) {
+    if (!phases[i].done)
+      continue;
+
+    fprintf(fstream, "%s\n    { \"name\": ", first ? "" : ",");
+    first = false;
+    dsda_WriteJSONString(fstream, phases[i].name);
+    fprintf(fstream, ", \"parent\": ");
+    if (phases[i].parent >= 0)
+      dsda_WriteJSONString(fstream, phases[phases[i].parent].name);
+    else
+      fprintf(fstream, "null");
+    fprintf(fstream, ", \"start_ms\": %.3f, \"ms\": %.3f }",
+            (double) phases[i].start / 1000000, (double) phases[i].time / 1000000);
+  }
+
+  fprintf(fstream, "\n  ]\n}\n");
+  fclose(fstream);
+
+  lprintf(LO_INFO, "dsda_WriteStartupReport: wrote %s\n", report_filename);
+}
+
+static void dsda_FinishStartupProfile(void) {
+  if (!report_filename)
+    return;
+
+  total_time = dsda_StartupProfileNow();
+
+  dsda_PrintStartupTable();
+  dsda_WriteStartupReport();
+
+  report_filename = NULL;
+}
+
+void dsda_InitStartupProfile(const char* filename) {
+  report_filename = filename;
+
+  dsda_StartTimer(dsda_timer_startup_profile);
+
+  // Report whatever was measured if startup never reaches a level
+  I_AtExit(dsda_FinishStartupProfile, true, "dsda_FinishStartupProfile", exit_priority_normal);
+}
+
+// Only the first occurrence of each phase is measured
+void dsda_StartupPhaseBegin(dsda_startup_phase_t phase) {
+  startup_phase_t* entry = &phases[phase];
+
+  if (!report_filename || entry->open || entry->done)
+    return;
+
+  entry->open = true;
+  entry->parent = open_phase_count ? open_phases[open_phase_count - 1] : -1;
+  entry->start = dsda_StartupProfileNow();
+
+  open_phases[open_phase_count++] = phase;
+}
+
+void dsda_StartupPhaseEnd(dsda_startup_phase_t phase) {
+  int i;
+  startup_phase_t* entry = &phases[phase];
+
+  if (!report_filename || !entry->open)
+    return;
+
+  entry->time = dsda_StartupProfileNow() - entry->start;
+  entry->open = false;
+  entry->done = true;
+
+  for (i = open_phase_count - 1; i >= 0; --i)
+    if (open_phases[i] == phase) {
+      memmove(&open_phases[i], &open_phases[i + 1],
+              (open_phase_count - i - 1) * sizeof(*open_phases));
+      --open_phase_count;
+      break;
+    }
+
+  // Startup is over once a level is ready and on screen
+  if (phases[dsda_startup_level].done &&
+      (phases[dsda_startup_first_frame].done || dsda_Flag(dsda_arg_nodraw)))
+    dsda_FinishStartupProfile();
+}
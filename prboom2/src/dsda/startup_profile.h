@@ -0,0 +1,46 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Startup Profile
+//
+
+#ifndef __DSDA_STARTUP_PROFILE__
+#define __DSDA_STARTUP_PROFILE__
+
+typedef enum {
+  dsda_startup_setup,
+  dsda_startup_wad_files,
+  dsda_startup_dehacked,
+  dsda_startup_misc,
+  dsda_startup_sndinfo,
+  dsda_startup_renderer,
+  dsda_startup_mapinfo,
+  dsda_startup_playloop,
+  dsda_startup_system,
+  dsda_startup_sound,
+  dsda_startup_fonts,
+  dsda_startup_graphics,
+  dsda_startup_opengl,
+  dsda_startup_status_bar,
+  dsda_startup_level,
+  dsda_startup_tranmap,
+  dsda_startup_first_frame,
+  DSDA_STARTUP_PHASE_COUNT
+} dsda_startup_phase_t;
+
+void dsda_InitStartupProfile(const char* filename);
+void dsda_StartupPhaseBegin(dsda_startup_phase_t phase);
+void dsda_StartupPhaseEnd(dsda_startup_phase_t phase);
+
+#endif
@@ -0,0 +1,439 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA State Hash
+//
+//  Hashes the game state after every tic, either streaming the hashes
+//  to a file or comparing them against a previously written stream.
+//  On the first mismatch, the objects in the mismatched categories are
+//  dumped next to the reference file and the game exits.
+//
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "doomstat.h"
+#include "i_main.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "m_random.h"
+#include "p_saveg.h"
+#include "p_tick.h"
+#include "r_state.h"
+
+#include "dsda/global.h"
+#include "dsda/mapinfo.h"
+#include "dsda/utility.h"
+
+#include "state_hash.h"
+
+typedef enum {
+  hash_mobjs,
+  hash_sectors,
+  hash_players,
+  hash_rng,
+  HASH_CATEGORY_COUNT
+} hash_category_t;
+
+static const char* category_names[HASH_CATEGORY_COUNT] = {
+  "mobjs", "sectors", "players", "rng"
+};
+
+// Large enough for the longest field list, the rng seeds
+#define MAX_HASH_FIELDS (NUMPRCLASS + 2 > 64 ? NUMPRCLASS + 2 : 64)
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+static FILE* stream_file;
+static FILE* compare_file;
+static dsda_string_t compare_path;
+
+static unsigned int dsda_HashInt(unsigned int hash, int value) {
+  int i;
+
+  // Byte by byte so the result does not depend on endianness
+  for (i = 0; i < 4; ++i) {
+    hash ^= (value >> (i * 8)) & 0xff;
+    hash *= FNV_PRIME;
+  }
+
+  return hash;
+}
+
+static unsigned int dsda_HashFields(const int* fields, int count) {
+  int i;
+  unsigned int hash = FNV_OFFSET;
+
+  for (i = 0; i < count; ++i)
+    hash = dsda_HashInt(hash, fields[i]);
+
+  return hash;
+}
+
+// Only valid between P_ThinkerToIndex and P_IndexToThinker
+static int dsda_MobjIndex(mobj_t* mobj) {
+  if (!mobj || !P_IsMobjThinker(&mobj->thinker))
+    return 0;
+
+  return (int) (intptr_t) mobj->thinker.prev;
+}
+
+static int dsda_StateIndex(state_t* state) {
+  return state ? (int) (state - states) : -1;
+}
+
+static const char* mobj_field_names[] = {
+  "type", "x", "y", "z", "momx", "momy", "momz", "angle", "state", "tics",
+  "health", "flags", "flags2", "movedir", "movecount", "reactiontime",
+  "threshold", "target", "tracer", NULL
+};
+
+static int dsda_MobjFields(mobj_t* mobj, int* fields) {
+  int count = 0;
+
+  fields[count++] = mobj->type;
+  fields[count++] = mobj->x;
+  fields[count++] = mobj->y;
+  fields[count++] = mobj->z;
+  fields[count++] = mobj->momx;
+  fields[count++] = mobj->momy;
+  fields[count++] = mobj->momz;
+  fields[count++] = (int) mobj->angle;
+  fields[count++] = dsda_StateIndex(mobj->state);
+  fields[count++] = mobj->tics;
+  fields[count++] = mobj->health;
+  fields[count++] = (int) (mobj->flags ^ (mobj->flags >> 32));
+  fields[count++] = (int) (mobj->flags2 ^ (mobj->flags2 >> 32));
+  fields[count++] = mobj->movedir;
+  fields[count++] = mobj->movecount;
+  fields[count++] = mobj->reactiontime;
+  fields[count++] = mobj->threshold;
+  fields[count++] = dsda_MobjIndex(mobj->target);
+  fields[count++] = dsda_MobjIndex(mobj->tracer);
+
+  assert(count <= MAX_HASH_FIELDS);
+
+  return count;
+}
+
+static const char* sector_field_names[] = {
+  "floorheight", "ceilingheight", "special", "lightlevel", NULL
+};
+
+static int dsda_SectorFields(sector_t* sector, int* fields) {
+  int count = 0;
+
+  fields[count++] = sector->floorheight;
+  fields[count++] = sector->ceilingheight;
+  fields[count++] = sector->special;
+  fields[count++] = sector->lightlevel;
+
+  assert(count <= MAX_HASH_FIELDS);
+
+  return count;
+}
+
+static const char* player_field_names[] = {
+  "playerstate", "mo", "viewz", "momx", "momy", "health", "armortype",
+  "readyweapon", "pendingweapon", "refire", "killcount", "itemcount",
+  "secretcount", "weapon_state", "weapon_tics", "flash_state", "flash_tics",
+  "armorpoints[]", "powers[]", "ammo[]", NULL
+};
+
+static int dsda_PlayerFields(player_t* player, int* fields) {
+  int i;
+  int count = 0;
+
+  fields[count++] = player->playerstate;
+  fields[count++] = dsda_MobjIndex(player->mo);
+  fields[count++] = player->viewz;
+  fields[count++] = player->momx;
+  fields[count++] = player->momy;
+  fields[count++] = player->health;
+  fields[count++] = player->armortype;
+  fields[count++] = player->readyweapon;
+  fields[count++] = player->pendingweapon;
+  fields[count++] = player->refire;
+  fields[count++] = player->killcount;
+  fields[count++] = player->itemcount;
+  fields[count++] = player->secretcount;
+
+  for (i = 0; i < 2; ++i) {
+    fields[count++] = dsda_StateIndex(player->psprites[i].state);
+    fields[count++] = player->psprites[i].tics;
+  }
+
+  for (i = 0; i < NUMARMOR; ++i)
+    fields[count++] = player->armorpoints[i];
+
+  for (i = 0; i < NUMPOWERS; ++i)
+    fields[count++] = player->powers[i];
+
+  for (i = 0; i < NUMAMMO; ++i)
+    fields[count++] = player->ammo[i];
+
+  assert(count <= MAX_HASH_FIELDS);
+
+  return count;
+}
+
+static const char* rng_field_names[] = {
+  "rndindex", "prndindex", "seed[]", NULL
+};
+
+static int dsda_RNGFields(int* fields) {
+  int i;
+  int count = 0;
+
+  fields[count++] = rng.rndindex;
+  fields[count++] = rng.prndindex;
+
+  for (i = 0; i < NUMPRCLASS; ++i)
+    fields[count++] = rng.seed[i];
+
+  assert(count <= MAX_HASH_FIELDS);
+
+  return count;
+}
+
+static void dsda_HashState(unsigned int* hashes) {
+  int i;
+  int count;
+  thinker_t* th;
+  int fields[MAX_HASH_FIELDS];
+
+  for (i = 0; i < HASH_CATEGORY_COUNT; ++i)
+    hashes[i] = FNV_OFFSET;
+
+  // Same ordering and pointer numbering as the save archive
+  P_ThinkerToIndex();
+
+  for (th = thinkercap.next; th != &thinkercap; th = th->next)
+    if (P_IsMobjThinker(th)) {
+      count = dsda_MobjFields((mobj_t *) th, fields);
+      hashes[hash_mobjs] = dsda_HashInt(hashes[hash_mobjs], dsda_HashFields(fields, count));
+    }
+
+  for (i = 0; i < g_maxplayers; ++i)
+    if (playeringame[i]) {
+      count = dsda_PlayerFields(&players[i], fields);
+      hashes[hash_players] = dsda_HashInt(hashes[hash_players], dsda_HashFields(fields, count));
+    }
+
+  P_IndexToThinker();
+
+  for (i = 0; i < numsectors; ++i) {
+    count = dsda_SectorFields(&sectors[i], fields);
+    hashes[hash_sectors] = dsda_HashInt(hashes[hash_sectors], dsda_HashFields(fields, count));
+  }
+
+  count = dsda_RNGFields(fields);
+  hashes[hash_rng] = dsda_HashFields(fields, count);
+}
+
+static unsigned int dsda_TotalHash(const unsigned int* hashes) {
+  return dsda_HashFields((const int *) hashes, HASH_CATEGORY_COUNT);
+}
+
+static void dsda_DumpFields(FILE* fstream, const char* label, int index,
+                            const char** names, const int* fields, int count) {
+  int i;
+
+  fprintf(fstream, "%s %d: hash %08x\n", label, index, dsda_HashFields(fields, count));
+
+  // Arrays at the end of the list are printed as one trailing row
+  for (i = 0; i < count && names[i] && !strstr(names[i], "[]"); ++i)
+    fprintf(fstream, "  %s %d\n", names[i], fields[i]);
+
+  if (i < count) {
+    fprintf(fstream, " ");
+    for (; i < count; ++i)
+      fprintf(fstream, " %d", fields[i]);
+    fprintf(fstream, "\n");
+  }
+}
+
+static void dsda_DumpState(const char* filename, int tic, const dboolean* mismatch) {
+  int i;
+  int count;
+  thinker_t* th;
+  FILE* fstream;
+  int fields[MAX_HASH_FIELDS];
+
+  fstream = M_OpenFile(filename, "w");
+  if (!fstream) {
+    lprintf(LO_ERROR, "dsda_DumpState: unable to open %s\n", filename);
+    return;
+  }
+
+  fprintf(fstream, "tic %d, map %s\n", tic, dsda_MapLumpName(gameepisode, gamemap));
+
+  P_ThinkerToIndex();
+
+  if (mismatch[hash_mobjs])
+    for (th = thinkercap.next; th != &thinkercap; th = th->next)
+      if (P_IsMobjThinker(th)) {
+        count = dsda_MobjFields((mobj_t *) th, fields);
+        dsda_DumpFields(fstream, "mobj", dsda_MobjIndex((mobj_t *) th),
+                        mobj_field_names, fields, count);
+      }
+
+  if (mismatch[hash_players])
+    for (i = 0; i < g_maxplayers; ++i)
+      if (playeringame[i]) {
+        count = dsda_PlayerFields(&players[i], fields);
+        dsda_DumpFields(fstream, "player", i, player_field_names, fields, count);
+      }
+
+  P_IndexToThinker();
+
+  if (mismatch[hash_sectors])
+    for (i = 0; i < numsectors; ++i) {
+      count = dsda_SectorFields(&sectors[i], fields);
+      dsda_DumpFields(fstream, "sector", i, sector_field_names, fields, count);
+    }
+
+  if (mismatch[hash_rng]) {
+    count = dsda_RNGFields(fields);
+    dsda_DumpFields(fstream, "rng", 0, rng_field_names, fields, count);
+  }
+
+  fclose(fstream);
+}
+
+static dboolean dsda_ReadReferenceHash(int* tic, unsigned int* hashes) {
+  char line[128];
+
+  while (fgets(line, sizeof(line), compare_file)) {
+    if (line[0] == '#')
+      continue;
+
+    if (sscanf(line, "%d %*x %x %x %x %x", tic,
+               &hashes[hash_mobjs], &hashes[hash_sectors],
+               &hashes[hash_players], &hashes[hash_rng]) == 5)
+      return true;
+  }
+
+  return false;
+}
+
+static void dsda_CompareStateHash(const unsigned int* hashes) {
+  int i;
+  int ref_tic;
+  dboolean diverged;
+  unsigned int ref_hashes[HASH_CATEGORY_COUNT];
+  dboolean mismatch[HASH_CATEGORY_COUNT];
+
+  if (!dsda_ReadReferenceHash(&ref_tic, ref_hashes)) {
+    lprintf(LO_INFO, "dsda_CompareStateHash: reference ends at tic %d\n", gametic);
+    fclose(compare_file);
+    compare_file = NULL;
+    return;
+  }
+
+  diverged = (ref_tic != gametic);
+  for (i = 0; i < HASH_CATEGORY_COUNT; ++i) {
+    mismatch[i] = (ref_hashes[i] != hashes[i]);
+    diverged |= mismatch[i];
+  }
+
+  if (!diverged)
+    return;
+
+  lprintf(LO_WARN, "State diverges from %s at tic %d (reference tic %d):",
+          compare_path.string, gametic, ref_tic);
+  for (i = 0; i < HASH_CATEGORY_COUNT; ++i)
+    if (mismatch[i])
+      lprintf(LO_WARN, " %s", category_names[i]);
+  lprintf(LO_WARN, "\n");
+
+  // A tic offset means the streams no longer line up, so dump everything
+  if (ref_tic != gametic)
+    for (i = 0; i < HASH_CATEGORY_COUNT; ++i)
+      mismatch[i] = true;
+
+  {
+    dsda_string_t dump_path;
+
+    dsda_InitString(&dump_path, compare_path.string);
+    dsda_CutExtension(dump_path.string);
+    dsda_StringCat(&dump_path, "_divergence.txt");
+
+    dsda_DumpState(dump_path.string, gametic, mismatch);
+    lprintf(LO_WARN, "Wrote %s\n", dump_path.string);
+
+    dsda_FreeString(&dump_path);
+  }
+
+  I_SafeExit(1);
+}
+
+void dsda_StateHashTic(void) {
+  unsigned int hashes[HASH_CATEGORY_COUNT];
+
+  if (!stream_file && !compare_file)
+    return;
+
+  dsda_HashState(hashes);
+
+  if (stream_file)
+    fprintf(stream_file, "%d %08x %08x %08x %08x %08x\n", gametic, dsda_TotalHash(hashes),
+            hashes[hash_mobjs], hashes[hash_sectors], hashes[hash_players], hashes[hash_rng]);
+
+  if (compare_file)
+    dsda_CompareStateHash(hashes);
+}
+
+static void dsda_CloseStateHashFiles(void) {
+  if (stream_file) {
+    fclose(stream_file);
+    stream_file = NULL;
+  }
+
+  if (compare_file) {
+    fclose(compare_file);
+    compare_file = NULL;
+  }
+}
+
+static void dsda_AtExitStateHash(void) {
+  static dboolean registered;
+
+  if (!registered) {
+    registered = true;
+    I_AtExit(dsda_CloseStateHashFiles, true, "dsda_CloseStateHashFiles", exit_priority_normal);
+  }
+}
+
+void dsda_InitStateHashStream(const char* filename) {
+  stream_file = M_OpenFile(filename, "w");
+  if (!stream_file)
+    I_Error("dsda_InitStateHashStream: unable to open %s", filename);
+
+  fprintf(stream_file, "# tic total mobjs sectors players rng\n");
+
+  dsda_AtExitStateHash();
+}
+
+void dsda_InitStateHashCompare(const char* filename) {
+  compare_file = M_OpenFile(filename, "r");
+  if (!compare_file)
+    I_Error("dsda_InitStateHashCompare: unable to open %s", filename);
+
+  dsda_InitString(&compare_path, filename);
+
+  dsda_AtExitStateHash();
+}
@@ -24,6 +24,9 @@ typedef enum {
   dsda_timer_key_frame,
   dsda_timer_brute_force,
   dsda_timer_render_stats,
+  dsda_timer_profiler,
+  dsda_timer_benchmark,
+  dsda_timer_startup_profile,
   dsda_timer_temp,
   DSDA_TIMER_COUNT
 } dsda_timer_t;
@@ -33,6 +36,7 @@ extern unsigned long long (*dsda_TickElapsedTime)(void);
 
 void dsda_StartTimer(int timer);
 unsigned long long dsda_ElapsedTime(int timer);
+unsigned long long dsda_ElapsedTimeNS(int timer);
 unsigned long long dsda_ElapsedTimeMS(int timer);
 void dsda_PrintElapsedTime(int timer, const char* message);
 void dsda_LimitFPS(void);
@@ -14,29 +14,52 @@
 // DESCRIPTION:
 //	DSDA TRANMAP
 //
+//  Translucency maps are generated per palette and alpha, in bands of rows
+//  spread over worker threads, and kept in one packed cache file per
+//  palette under the data root.
+//
 
+#include <limits.h>
+#include <stdio.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANMAP_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "md5.h"
+#include "i_system.h"
 #include "lprintf.h"
 #include "m_file.h"
 #include "w_wad.h"
 #include "z_zone.h"
 
 #include "dsda/data_organizer.h"
+#include "dsda/parallel.h"
+#include "dsda/startup_jobs.h"
 #include "dsda/utility.h"
 
 #include "tranmap.h"
 
-static char* tranmap_base_dir;
-static char* tranmap_palette_dir;
-static dsda_cksum_t playpal_cksum;
+#define TRANMAP_CACHE_MAGIC "DSDATRAN"
+#define TRANMAP_CACHE_FORMAT 1
+#define TRANMAP_ALPHAS 100
+#define TRANMAP_BANDS 16
+
+static char* tranmap_cache_path;
+static byte* tranmap_cache_buffer;
+static dboolean tranmap_cache_loaded;
 static const int default_tranmap_alpha = 66;
 static const int tranmap_length = 256 * 256;
-static const byte* tranmap_data[100];
+static const byte* tranmap_data[TRANMAP_ALPHAS];
+static dboolean tranmap_pending[TRANMAP_ALPHAS];
+static int tranmap_batch_depth;
 
-static void dsda_CalculatePlaypalCksum(void) {
+static void dsda_InitTranMapCachePath(void) {
   struct MD5Context md5;
+  dsda_cksum_t playpal_cksum;
+  dsda_string_t path;
   int lump;
 
   lump = W_GetNumForName("PLAYPAL");
@@ -45,35 +68,97 @@ static void dsda_CalculatePlaypalCksum(void) {
   MD5Update(&md5, W_LumpByNum(lump), W_LumpLength(lump));
   MD5Final(playpal_cksum.bytes, &md5);
   dsda_TranslateCheckSum(&playpal_cksum);
+
+  dsda_StringPrintF(&path, "%s/tranmaps", dsda_DataRoot());
+  M_MakeDir(path.string, true);
+  dsda_StringCatF(&path, "/%s.dat", playpal_cksum.string);
+
+  tranmap_cache_path = path.string;
 }
 
-static void dsda_InitTranMapBaseDir(void) {
+// The packed cache holds a presence byte per alpha, then each present map
+static void dsda_LoadTranMapCache(void) {
+  int i;
   int length;
-  const char* data_root;
+  int format;
+  int count;
+  const byte* present;
+  const byte* p;
+
+  if (tranmap_cache_loaded)
+    return;
+
+  tranmap_cache_loaded = true;
+
+  if (!tranmap_cache_path)
+    dsda_InitTranMapCachePath();
+
+  length = M_ReadFile(tranmap_cache_path, &tranmap_cache_buffer);
+  if (length < 0) {
+    tranmap_cache_buffer = NULL;
+    return;
+  }
+
+  if (length < 8 + sizeof(format) + TRANMAP_ALPHAS ||
+      memcmp(tranmap_cache_buffer, TRANMAP_CACHE_MAGIC, 8))
+    goto invalid;
+
+  memcpy(&format, tranmap_cache_buffer + 8, sizeof(format));
+  if (format != TRANMAP_CACHE_FORMAT)
+    goto invalid;
 
-  data_root = dsda_DataRoot();
+  present = tranmap_cache_buffer + 8 + sizeof(format);
 
-  length = strlen(data_root) + 10; // "/tranmaps\0"
-  tranmap_base_dir = Z_Malloc(length);
-  snprintf(tranmap_base_dir, length, "%s/tranmaps", data_root);
+  for (count = 0, i = 0; i < TRANMAP_ALPHAS; ++i)
+    if (present[i])
+      ++count;
 
-  M_MakeDir(tranmap_base_dir, true);
+  if (length != 8 + sizeof(format) + TRANMAP_ALPHAS + count * tranmap_length)
+    goto invalid;
+
+  p = present + TRANMAP_ALPHAS;
+  for (i = 0; i < TRANMAP_ALPHAS; ++i)
+    if (present[i]) {
+      if (!tranmap_data[i])
+        tranmap_data[i] = p;
+
+      p += tranmap_length;
+    }
+
+  return;
+
+invalid:
+  lprintf(LO_WARN, "dsda_LoadTranMapCache: ignoring invalid cache %s\n", tranmap_cache_path);
+  Z_Free(tranmap_cache_buffer);
+  tranmap_cache_buffer = NULL;
 }
 
-static void dsda_InitTranMapPaletteDir(void) {
-  int length;
+static void dsda_WriteTranMapCache(void) {
+  int i;
+  int format;
+  FILE* fstream;
+  byte present[TRANMAP_ALPHAS];
 
-  if (!tranmap_base_dir)
-    dsda_InitTranMapBaseDir();
+  fstream = M_OpenFile(tranmap_cache_path, "wb");
+  if (!fstream) {
+    lprintf(LO_WARN, "dsda_WriteTranMapCache: unable to open %s\n", tranmap_cache_path);
+    return;
+  }
+
+  format = TRANMAP_CACHE_FORMAT;
+
+  for (i = 0; i < TRANMAP_ALPHAS; ++i)
+    present[i] = tranmap_data[i] && !tranmap_pending[i];
 
-  if (!playpal_cksum.string[0])
-    dsda_CalculatePlaypalCksum();
+  fwrite(TRANMAP_CACHE_MAGIC, 8, 1, fstream);
+  fwrite(&format, sizeof(format), 1, fstream);
+  fwrite(present, sizeof(present), 1, fstream);
 
-  length = strlen(tranmap_base_dir) + 34; // "/<cksum (32)>\0"
-  tranmap_palette_dir = Z_Malloc(length);
-  snprintf(tranmap_palette_dir, length, "%s/%s", tranmap_base_dir, playpal_cksum.string);
+  for (i = 0; i < TRANMAP_ALPHAS; ++i)
+    if (present[i])
+      fwrite(tranmap_data[i], tranmap_length, 1, fstream);
 
-  M_MakeDir(tranmap_palette_dir, true);
+  fclose(fstream);
 }
 
 //
@@ -86,104 +171,266 @@ static void dsda_InitTranMapPaletteDir(void) {
 
 #define TSC 12 /* number of fixed point digits in filter percent */
 
-static byte* dsda_GenerateTranMap(unsigned int alpha) {
-  byte* buffer;
-  const byte* playpal;
+// The palette in the forms used by the nearest color search
+typedef struct {
   int pal[3][256];
   int tot[256];
-  int pal_w1[3][256];
-  int w1, w2;
+  int rg[256]; // red in the low half, green in the high half
+  int b[256];
+} tranmap_palette_t;
 
-  playpal = W_LumpByName("PLAYPAL");
+static tranmap_palette_t tranmap_palette;
+static const byte* tranmap_playpal;
 
-  w1 = (alpha << TSC) / 100;
-  w2 = (1l << TSC) - w1;
+static void dsda_InitTranMapPalette(void) {
+  int i;
+  const byte* p;
+
+  if (tranmap_playpal)
+    return;
 
-  buffer = Z_Malloc(tranmap_length);
+  tranmap_playpal = W_LumpByName("PLAYPAL");
 
   // First, convert playpal into long int type, and transpose array,
   // for fast inner-loop calculations. Precompute tot array.
-  {
-    register int i = 255;
-    register const unsigned char *p = playpal + 255 * 3;
-
-    do {
-      register int t, d;
-      pal_w1[0][i] = (pal[0][i] = t = p[0]) * w1;
-      d = t * t;
-      pal_w1[1][i] = (pal[1][i] = t = p[1]) * w1;
-      d += t * t;
-      pal_w1[2][i] = (pal[2][i] = t = p[2]) * w1;
-      d += t * t;
-      p -= 3;
-      tot[i] = d << (TSC - 1);
+  for (i = 0, p = tranmap_playpal; i < 256; ++i, p += 3) {
+    tranmap_palette.pal[0][i] = p[0];
+    tranmap_palette.pal[1][i] = p[1];
+    tranmap_palette.pal[2][i] = p[2];
+    tranmap_palette.tot[i] = (p[0] * p[0] + p[1] * p[1] + p[2] * p[2]) << (TSC - 1);
+    tranmap_palette.rg[i] = p[0] | (p[1] << 16);
+    tranmap_palette.b[i] = p[2];
+  }
+}
+
+// Returns the color minimizing tot - pal . (r, g, b), preferring the
+// highest index on ties like the original search from 255 down.
+// The mix is below 2^20 per channel, so it is split at bit 11 into halves
+// that fit the 16 bit multiply, and the products are recombined exactly.
+#ifdef TRANMAP_SSE2
+static byte dsda_NearestColor(int r, int g, int b) {
+  int c;
+  int best_err[4];
+  int best_color[4];
+  __m128i hi_rg, hi_b, lo_rg, lo_b;
+  __m128i best, best_index, index, step;
+
+  hi_rg = _mm_set1_epi32((r >> 11) | ((g >> 11) << 16));
+  hi_b = _mm_set1_epi32(b >> 11);
+  lo_rg = _mm_set1_epi32((r & 2047) | ((g & 2047) << 16));
+  lo_b = _mm_set1_epi32(b & 2047);
+
+  best = _mm_set1_epi32(INT_MAX);
+  best_index = _mm_setzero_si128();
+  index = _mm_setr_epi32(252, 253, 254, 255);
+  step = _mm_set1_epi32(4);
+
+  for (c = 252; c >= 0; c -= 4) {
+    __m128i rg, pb, tot, dot_hi, dot_lo, err, better;
+
+    rg = _mm_loadu_si128((const __m128i*) &tranmap_palette.rg[c]);
+    pb = _mm_loadu_si128((const __m128i*) &tranmap_palette.b[c]);
+    tot = _mm_loadu_si128((const __m128i*) &tranmap_palette.tot[c]);
+
+    dot_hi = _mm_add_epi32(_mm_madd_epi16(rg, hi_rg), _mm_madd_epi16(pb, hi_b));
+    dot_lo = _mm_add_epi32(_mm_madd_epi16(rg, lo_rg), _mm_madd_epi16(pb, lo_b));
+    err = _mm_sub_epi32(tot, _mm_add_epi32(_mm_slli_epi32(dot_hi, 11), dot_lo));
+
+    better = _mm_cmplt_epi32(err, best);
+    best = _mm_or_si128(_mm_and_si128(better, err), _mm_andnot_si128(better, best));
+    best_index = _mm_or_si128(_mm_and_si128(better, index), _mm_andnot_si128(better, best_index));
+
+    index = _mm_sub_epi32(index, step);
+  }
+
+  _mm_storeu_si128((__m128i*) best_err, best);
+  _mm_storeu_si128((__m128i*) best_color, best_index);
+
+  for (c = 1; c < 4; ++c)
+    if (best_err[c] < best_err[0] ||
+        (best_err[c] == best_err[0] && best_color[c] > best_color[0])) {
+      best_err[0] = best_err[c];
+      best_color[0] = best_color[c];
+    }
+
+  return best_color[0];
+}
+#else
+static byte dsda_NearestColor(int r, int g, int b) {
+  register int color = 255;
+  register int err;
+  int best = INT_MAX;
+  byte result = 0;
+
+  do {
+    err = tranmap_palette.tot[color] -
+          tranmap_palette.pal[0][color] * r -
+          tranmap_palette.pal[1][color] * g -
+          tranmap_palette.pal[2][color] * b;
+    if (err < best) {
+      best = err;
+      result = color;
     }
-    while (--i >= 0);
   }
+  while (--color >= 0);
+
+  return result;
+}
+#endif
+
+// Fills in rows [first_row, last_row) of the map
+static void dsda_GenerateTranMapRows(byte* buffer, unsigned int alpha,
+                                     int first_row, int last_row) {
+  int i, j;
+  int w1, w2;
+  byte* tp;
+
+  w1 = (alpha << TSC) / 100;
+  w2 = (1l << TSC) - w1;
+
+  tp = buffer + first_row * 256;
 
   // Next, compute all entries using minimum arithmetic.
-  {
-    int i, j;
-    byte *tp = buffer;
-
-    for (i = 0; i < 256; i++) {
-      int r1 = pal[0][i] * w2;
-      int g1 = pal[1][i] * w2;
-      int b1 = pal[2][i] * w2;
-
-      for (j = 0; j < 256; j++, tp++) {
-        register int color = 255;
-        register int err;
-        int r = pal_w1[0][j] + r1;
-        int g = pal_w1[1][j] + g1;
-        int b = pal_w1[2][j] + b1;
-        int best = INT_MAX;
-
-        do {
-          err = tot[color] - pal[0][color] * r - pal[1][color] * g - pal[2][color] * b;
-          if (err < best) {
-            best = err;
-            *tp = color;
-          }
-        }
-        while (--color >= 0);
-      }
-    }
+  for (i = first_row; i < last_row; i++) {
+    int r1 = tranmap_palette.pal[0][i] * w2;
+    int g1 = tranmap_palette.pal[1][i] * w2;
+    int b1 = tranmap_palette.pal[2][i] * w2;
+
+    for (j = 0; j < 256; j++, tp++)
+      *tp = dsda_NearestColor(tranmap_palette.pal[0][j] * w1 + r1,
+                              tranmap_palette.pal[1][j] * w1 + g1,
+                              tranmap_palette.pal[2][j] * w1 + b1);
   }
+}
+
+typedef struct {
+  byte* buffer;
+  unsigned int alpha;
+  int first_row;
+  int last_row;
+} tranmap_band_t;
 
-  return buffer;
+static void dsda_GenerateTranMapBand(tranmap_band_t* band) {
+  dsda_GenerateTranMapRows(band->buffer, band->alpha, band->first_row, band->last_row);
 }
 
-const byte* dsda_TranMap(unsigned int alpha) {
-  int length;
-  byte *buffer = NULL;
+static void dsda_InitTranMapBands(tranmap_band_t* bands, byte* buffer, unsigned int alpha) {
+  int i;
 
-  if (alpha > 99)
-    return NULL;
+  for (i = 0; i < TRANMAP_BANDS; ++i) {
+    bands[i].buffer = buffer;
+    bands[i].alpha = alpha;
+    bands[i].first_row = 256 * i / TRANMAP_BANDS;
+    bands[i].last_row = 256 * (i + 1) / TRANMAP_BANDS;
+  }
+}
 
-  if (!tranmap_data[alpha]) {
-    char* filename;
+// Pending maps are generated together, the bands shared out over threads
 
-    if (!tranmap_palette_dir)
-      dsda_InitTranMapPaletteDir();
+static void dsda_GeneratePendingBand(int index, void* data) {
+  dsda_GenerateTranMapBand((tranmap_band_t*) data + index);
+}
 
-    length = strlen(tranmap_palette_dir) + 16; // "/tranmap_99.dat\0"
-    filename = Z_Malloc(length);
-    snprintf(filename, length, "%s/tranmap_%02d.dat", tranmap_palette_dir, alpha);
+static void dsda_GeneratePendingTranMaps(void) {
+  int i;
+  int count;
+  tranmap_band_t* bands;
 
-    length = M_ReadFile(filename, &buffer);
-    if (buffer && length != tranmap_length) {
-      Z_Free(buffer);
-      buffer = NULL;
-    }
+  count = 0;
+  for (i = 0; i < TRANMAP_ALPHAS; ++i)
+    if (tranmap_pending[i])
+      ++count;
 
-    if (!buffer) {
-      buffer = dsda_GenerateTranMap(alpha);
+  if (!count)
+    return;
 
-      M_WriteFile(filename, buffer, tranmap_length);
-    }
+  bands = Z_Malloc(count * TRANMAP_BANDS * sizeof(*bands));
+
+  for (count = 0, i = 0; i < TRANMAP_ALPHAS; ++i)
+    if (tranmap_pending[i])
+      dsda_InitTranMapBands(&bands[TRANMAP_BANDS * count++], (byte*) tranmap_data[i], i);
+
+  dsda_ParallelFor(count * TRANMAP_BANDS, dsda_GeneratePendingBand, bands);
+
+  Z_Free(bands);
+
+  memset(tranmap_pending, 0, sizeof(tranmap_pending));
+
+  dsda_WriteTranMapCache();
+}
+
+// The default map is generated on the startup workers
+
+static tranmap_band_t default_bands[TRANMAP_BANDS];
+static byte* default_job_buffer;
+static int default_job_id = -1;
+
+static void dsda_TranMapJobWork(void* data) {
+  dsda_GenerateTranMapBand(data);
+}
+
+static void dsda_TranMapJobFinish(void* data) {
+  if (data != &default_bands[TRANMAP_BANDS - 1])
+    return;
+
+  tranmap_data[default_tranmap_alpha] = default_job_buffer;
+  default_job_buffer = NULL;
+  default_job_id = -1;
+
+  dsda_WriteTranMapCache();
+}
+
+void dsda_QueueTranMapJobs(void) {
+  int i;
+
+  if (W_CheckNumForName("TRANMAP") != LUMP_NOT_FOUND || default_job_buffer)
+    return;
+
+  dsda_LoadTranMapCache();
+
+  if (tranmap_data[default_tranmap_alpha])
+    return;
+
+  dsda_InitTranMapPalette();
+
+  default_job_buffer = Z_Malloc(tranmap_length);
+  dsda_InitTranMapBands(default_bands, default_job_buffer, default_tranmap_alpha);
+
+  for (i = 0; i < TRANMAP_BANDS; ++i)
+    default_job_id = dsda_QueueStartupJob(dsda_TranMapJobWork, dsda_TranMapJobFinish, &default_bands[i]);
+}
+
+// Maps requested during a batch are generated together when it ends
+void dsda_BeginTranMapBatch(void) {
+  ++tranmap_batch_depth;
+}
+
+void dsda_EndTranMapBatch(void) {
+  if (--tranmap_batch_depth)
+    return;
+
+  dsda_GeneratePendingTranMaps();
+}
+
+const byte* dsda_TranMap(unsigned int alpha) {
+  if (alpha >= TRANMAP_ALPHAS)
+    return NULL;
+
+  if (default_job_buffer && alpha == default_tranmap_alpha)
+    dsda_WaitStartupJob(default_job_id);
+
+  if (!tranmap_data[alpha]) {
+    dsda_LoadTranMapCache();
+  }
+
+  if (!tranmap_data[alpha]) {
+    dsda_InitTranMapPalette();
+
+    tranmap_data[alpha] = Z_Malloc(tranmap_length);
+    tranmap_pending[alpha] = true;
 
-    tranmap_data[alpha] = buffer;
+    if (!tranmap_batch_depth)
+      dsda_GeneratePendingTranMaps();
   }
 
   return tranmap_data[alpha];
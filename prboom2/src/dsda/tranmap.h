@@ -22,5 +22,8 @@
 
 const byte* dsda_TranMap(unsigned int alpha);
 const byte* dsda_DefaultTranMap(void);
+void dsda_QueueTranMapJobs(void);
+void dsda_BeginTranMapBatch(void);
+void dsda_EndTranMapBatch(void);
 
 #endif
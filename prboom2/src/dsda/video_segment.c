@@ -0,0 +1,372 @@
+//
+// Copyright(C) 2023 by Ryan Krafnick
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	DSDA Video Segment
+//
+//  Splits -viddump across processes. A fast pass over the demo stores
+//  key frames at the segment boundaries, then one capture process per
+//  segment restores its key frame and renders up to the next boundary.
+//  The segments are joined with the ffmpeg concat demuxer.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "d_event.h"
+#include "doomstat.h"
+#include "i_main.h"
+#include "i_system.h"
+#include "lprintf.h"
+#include "m_file.h"
+#include "z_zone.h"
+
+#include "dsda/args.h"
+#include "dsda/batch.h"
+#include "dsda/key_frame.h"
+#include "dsda/playback.h"
+#include "dsda/utility.h"
+
+#include "video_segment.h"
+
+#define MAX_SEGMENTS 256
+
+typedef struct {
+  int start_tic;
+  dsda_string_t key_frame_path;
+  dsda_string_t video_path;
+  dsda_string_t command;
+
+  // Written by the worker thread
+  int exit_status;
+} video_segment_t;
+
+static video_segment_t segments[MAX_SEGMENTS];
+static int segment_count;
+static int next_segment;
+static SDL_mutex* segment_mutex;
+
+// Key frame pass
+static const char* key_frame_prefix;
+static int key_frame_tics[MAX_SEGMENTS];
+static int key_frame_target;
+static int key_frame_count;
+
+// Segment capture
+static int end_tic;
+
+dboolean dsda_VideoSegmentMode(void) {
+  dsda_arg_t* arg;
+
+  arg = dsda_Arg(dsda_arg_viddump_jobs);
+
+  return dsda_Arg(dsda_arg_viddump)->found && arg->found && arg->value.v_int > 1;
+}
+
+static void dsda_KeyFrameListPath(dsda_string_t* path) {
+  dsda_StringPrintF(path, "%s.txt", key_frame_prefix);
+}
+
+static void dsda_StoreSegmentKeyFrame(void) {
+  FILE* fstream;
+  dsda_string_t path;
+
+  ++key_frame_count;
+
+  dsda_StringPrintF(&path, "%s-%d.kf", key_frame_prefix, key_frame_count);
+  dsda_StoreKeyFrameFile(path.string);
+  dsda_FreeString(&path);
+
+  // Appended as we go, so an early end of the demo leaves a valid list
+  dsda_KeyFrameListPath(&path);
+  fstream = M_OpenFile(path.string, "a");
+  if (!fstream)
+    I_Error("dsda_StoreSegmentKeyFrame: unable to open %s", path.string);
+  fprintf(fstream, "%d\n", true_logictic);
+  fclose(fstream);
+  dsda_FreeString(&path);
+}
+
+void dsda_UpdateVideoSegments(void) {
+  if (end_tic && true_logictic >= end_tic)
+    I_SafeExit(0);
+
+  if (!key_frame_prefix || !demoplayback || gamestate != GS_LEVEL || gameaction != ga_nothing)
+    return;
+
+  if (!key_frame_tics[0]) {
+    int i;
+    int total_tics;
+
+    total_tics = true_logictic + dsda_PlaybackTicsRemaining();
+
+    for (i = 0; i < key_frame_target; ++i)
+      key_frame_tics[i] = MAX(1, total_tics * (i + 1) / (key_frame_target + 1));
+  }
+
+  // Key frames can only be stored in a level, so boundaries inside
+  // an intermission move to the first tic of the next map
+  if (true_logictic >= key_frame_tics[key_frame_count]) {
+    dsda_StoreSegmentKeyFrame();
+
+    if (key_frame_count == key_frame_target)
+      I_SafeExit(0);
+  }
+}
+
+void dsda_InitVideoSegments(void) {
+  dsda_arg_t* arg;
+
+  arg = dsda_Arg(dsda_arg_viddump_key_frames);
+  if (arg->found) {
+    key_frame_prefix = arg->value.v_string;
+    key_frame_target = MIN(dsda_Arg(dsda_arg_viddump_jobs)->value.v_int, MAX_SEGMENTS) - 1;
+
+    if (key_frame_target < 1)
+      I_Error("dsda_InitVideoSegments: -viddump_key_frames requires -viddump_jobs");
+  }
+
+  arg = dsda_Arg(dsda_arg_viddump_end_tic);
+  if (arg->found)
+    end_tic = arg->value.v_int;
+}
+
+static void dsda_AppendArgs(dsda_string_t* command, dboolean fast) {
+  int i;
+  extern int dsda_argc;
+  extern char** dsda_argv;
+
+  dsda_StringPrintF(command, "\"%s\"", dsda_argv[0]);
+
+  for (i = 1; i < dsda_argc; ++i) {
+    const char* token = dsda_argv[i];
+
+    if (!strcasecmp(token, "-viddump") || !strcasecmp(token, "-viddump_jobs")) {
+      ++i;
+      continue;
+    }
+
+    if (fast && (!strcasecmp(token, "-timedemo") || !strcasecmp(token, "-playdemo")))
+      token = "-fastdemo";
+
+    dsda_StringCatF(command, " \"%s\"", token);
+  }
+}
+
+static int dsda_VideoSegmentWorker(void* data) {
+  while (1) {
+    video_segment_t* segment;
+
+    SDL_LockMutex(segment_mutex);
+    if (next_segment >= segment_count) {
+      SDL_UnlockMutex(segment_mutex);
+      break;
+    }
+    segment = &segments[next_segment++];
+    SDL_UnlockMutex(segment_mutex);
+
+    segment->exit_status = dsda_SystemCommand(segment->command.string);
+
+    SDL_LockMutex(segment_mutex);
+    lprintf(LO_INFO, "Segment %s: exit %d\n", segment->video_path.string, segment->exit_status);
+    SDL_UnlockMutex(segment_mutex);
+  }
+
+  return 0;
+}
+
+static void dsda_ReadKeyFrameList(void) {
+  FILE* fstream;
+  dsda_string_t path;
+  char line[64];
+
+  segment_count = 1;
+
+  dsda_KeyFrameListPath(&path);
+  fstream = M_OpenFile(path.string, "r");
+  if (fstream) {
+    while (segment_count < MAX_SEGMENTS && fgets(line, sizeof(line), fstream)) {
+      video_segment_t* segment = &segments[segment_count];
+
+      segment->start_tic = atoi(line);
+      dsda_StringPrintF(&segment->key_frame_path, "%s-%d.kf", key_frame_prefix, segment_count);
+      ++segment_count;
+    }
+
+    fclose(fstream);
+  }
+
+  M_remove(path.string);
+  dsda_FreeString(&path);
+}
+
+static void dsda_PrepareSegments(const char* output) {
+  int i;
+  dsda_string_t base;
+  const char* extension;
+
+  extension = strrchr(output, '.');
+  if (!extension || strpbrk(extension, "/\\"))
+    extension = "";
+
+  dsda_InitString(&base, output);
+  dsda_CutExtension(base.string);
+
+  for (i = 0; i < segment_count; ++i) {
+    video_segment_t* segment = &segments[i];
+
+    dsda_StringPrintF(&segment->video_path, "%s-%d%s", base.string, i, extension);
+
+    dsda_AppendArgs(&segment->command, false);
+    dsda_StringCatF(&segment->command, " -no_message_box -viddump \"%s\" -viddump_temp \"dsda-viddump-%d-\"",
+                    segment->video_path.string, i);
+
+    if (segment->key_frame_path.string)
+      dsda_StringCatF(&segment->command, " -from_key_frame \"%s\"", segment->key_frame_path.string);
+
+    if (i < segment_count - 1)
+      dsda_StringCatF(&segment->command, " -viddump_end_tic %d", segments[i + 1].start_tic);
+  }
+
+  dsda_FreeString(&base);
+}
+
+static const char* dsda_FileNamePart(const char* path) {
+  const char* p;
+
+  for (p = path; *p; ++p)
+    if (*p == '/' || *p == '\\')
+      path = p + 1;
+
+  return path;
+}
+
+static int dsda_ConcatSegments(const char* output) {
+  int i;
+  int result;
+  FILE* fstream;
+  dsda_string_t list_path;
+  dsda_string_t command;
+
+  // Entries are relative to the list, which sits next to the segments
+  dsda_InitString(&list_path, output);
+  dsda_CutExtension(list_path.string);
+  dsda_StringCat(&list_path, "-segments.txt");
+
+  fstream = M_OpenFile(list_path.string, "w");
+  if (!fstream)
+    I_Error("dsda_ConcatSegments: unable to open %s", list_path.string);
+
+  for (i = 0; i < segment_count; ++i)
+    fprintf(fstream, "file '%s'\n", dsda_FileNamePart(segments[i].video_path.string));
+
+  fclose(fstream);
+
+  dsda_StringPrintF(&command, "ffmpeg -y -f concat -safe 0 -i \"%s\" -c copy \"%s\"",
+                    list_path.string, output);
+
+  lprintf(LO_INFO, "dsda_ConcatSegments: %s\n", command.string);
+  result = dsda_SystemCommand(command.string);
+
+  if (!result) {
+    M_remove(list_path.string);
+
+    for (i = 0; i < segment_count; ++i)
+      M_remove(segments[i].video_path.string);
+  }
+
+  dsda_FreeString(&command);
+  dsda_FreeString(&list_path);
+
+  return result;
+}
+
+int dsda_RunVideoSegments(void) {
+  int i;
+  int jobs;
+  int failures;
+  const char* output;
+  dsda_string_t prefix;
+  dsda_string_t command;
+  SDL_Thread* workers[MAX_SEGMENTS];
+  unsigned long long start;
+
+  start = SDL_GetPerformanceCounter();
+
+  output = dsda_Arg(dsda_arg_viddump)->value.v_string;
+  jobs = MIN(dsda_Arg(dsda_arg_viddump_jobs)->value.v_int, MAX_SEGMENTS);
+
+  dsda_StringPrintF(&prefix, "%s/dsda-viddump-%u", I_GetTempDir(),
+                    (unsigned int) SDL_GetPerformanceCounter());
+  key_frame_prefix = prefix.string;
+
+  dsda_AppendArgs(&command, true);
+  dsda_StringCatF(&command, " -nodraw -nosound -nomusic -quiet -no_message_box "
+                  "-viddump_jobs %d -viddump_key_frames \"%s\"", jobs, key_frame_prefix);
+
+  lprintf(LO_INFO, "dsda_RunVideoSegments: storing %d key frames\n", jobs - 1);
+
+  if (dsda_SystemCommand(command.string)) {
+    lprintf(LO_ERROR, "dsda_RunVideoSegments: key frame pass failed\n");
+    return 1;
+  }
+
+  dsda_FreeString(&command);
+
+  dsda_ReadKeyFrameList();
+  dsda_PrepareSegments(output);
+
+  lprintf(LO_INFO, "dsda_RunVideoSegments: rendering %d segments\n", segment_count);
+
+  segment_mutex = SDL_CreateMutex();
+
+  for (i = 0; i < segment_count; ++i) {
+    workers[i] = SDL_CreateThread(dsda_VideoSegmentWorker, "dsda_VideoSegmentWorker", NULL);
+    if (!workers[i])
+      I_Error("dsda_RunVideoSegments: unable to create worker thread: %s", SDL_GetError());
+  }
+
+  for (i = 0; i < segment_count; ++i)
+    SDL_WaitThread(workers[i], NULL);
+
+  SDL_DestroyMutex(segment_mutex);
+
+  failures = 0;
+  for (i = 0; i < segment_count; ++i) {
+    if (segments[i].exit_status)
+      ++failures;
+
+    if (segments[i].key_frame_path.string)
+      M_remove(segments[i].key_frame_path.string);
+  }
+
+  if (failures) {
+    lprintf(LO_ERROR, "dsda_RunVideoSegments: %d segments failed, keeping the partial output\n",
+            failures);
+    return 1;
+  }
+
+  if (dsda_ConcatSegments(output)) {
+    lprintf(LO_ERROR, "dsda_RunVideoSegments: unable to join the segments\n");
+    return 1;
+  }
+
+  lprintf(LO_INFO, "dsda_RunVideoSegments: wrote %s in %.3f s\n", output,
+          (double) (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency());
+
+  return 0;
+}
@@ -14,9 +14,28 @@
 // DESCRIPTION:
 //	DSDA zipfile support using libzip
 //
+//  Archives are normally mounted in place: the central directory is read
+//  directly, stored members are served from the archive mapping and
+//  deflated members are inflated into memory the first time they are
+//  needed. Archives that can't be read this way (zip64, encryption,
+//  other compression methods) are extracted with libzip instead.
+//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef _MSC_VER
+#include <io.h>
+#endif
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <zip.h>
+#include <zlib.h>
 
 #include "i_system.h"
 #include "lprintf.h"
@@ -25,6 +44,8 @@
 
 #include "dsda/utility.h"
 
+#include "zipfile.h"
+
 static char **temp_dirs;
 
 /* Allow a maximum of 1GB to be uncompressed to prevent zip-bombs */
@@ -110,7 +131,7 @@ static void dsda_UnzipFileToDestination(const char *zipped_file_name, const char
   zip_close(archive_handle);
 }
 
-const char* dsda_UnzipFile(const char *zipped_file_name) {
+static const char* dsda_MakeZipTempDir(const char *zipped_file_name) {
   dsda_string_t temporary_directory;
   static unsigned int file_counter = 0;
 
@@ -120,8 +141,6 @@ const char* dsda_UnzipFile(const char *zipped_file_name) {
       I_Error("dsda_UnzipFile: unable to clear tempdir %s\n", temporary_directory.string);
   M_MakeDir(temporary_directory.string, true);
 
-  dsda_UnzipFileToDestination(zipped_file_name, temporary_directory.string);
-
   temp_dirs = Z_Realloc(temp_dirs, (file_counter + 2) * sizeof(*temp_dirs));
   temp_dirs[file_counter] = temporary_directory.string;
   temp_dirs[file_counter + 1] = NULL;
@@ -130,6 +149,400 @@ const char* dsda_UnzipFile(const char *zipped_file_name) {
   return temporary_directory.string;
 }
 
+const char* dsda_UnzipFile(const char *zipped_file_name) {
+  const char* temporary_directory;
+
+  temporary_directory = dsda_MakeZipTempDir(zipped_file_name);
+
+  dsda_UnzipFileToDestination(zipped_file_name, temporary_directory);
+
+  return temporary_directory;
+}
+
+#define ZIP_EOCD_SIGNATURE 0x06054b50
+#define ZIP_CENTRAL_SIGNATURE 0x02014b50
+#define ZIP_LOCAL_SIGNATURE 0x04034b50
+#define ZIP_EOCD_SIZE 22
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_MAX_COMMENT 0xffff
+
+#define ZIP_STORED 0
+#define ZIP_DEFLATED 8
+
+typedef struct {
+  char* path;
+  const char* temp_dir;
+  int handle;
+  int first_member;
+  int member_count;
+  zip_uint64_t bytes_read;
+} zip_archive_t;
+
+typedef struct {
+  int archive;
+  char* path; // archive path and member base name
+  const char* name;
+  int method;
+  unsigned int compressed_size;
+  unsigned int size;
+  unsigned int offset; // local header offset, then data offset
+  byte* data;
+  dboolean counted; // size already added to the archive's bytes_read
+} zip_member_t;
+
+static zip_archive_t* archives;
+static int archive_count;
+
+// Member ids are 1-based, so 0 can mean "not in an archive"
+static zip_member_t* members;
+static int member_count;
+
+static unsigned int dsda_ZipShort(const byte* p) {
+  return p[0] | (p[1] << 8);
+}
+
+static unsigned int dsda_ZipLong(const byte* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static zip_member_t* dsda_GetZipMember(int member) {
+  if (member < 1 || member > member_count)
+    I_Error("dsda_GetZipMember: invalid member %d", member);
+
+  return &members[member - 1];
+}
+
+static int dsda_CompareZipMembers(const void* a, const void* b) {
+  return strcasecmp(((const zip_member_t*) a)->name, ((const zip_member_t*) b)->name);
+}
+
+// Returns false if the entry is valid but can't be served in place
+static dboolean dsda_AddZipMember(int archive, const byte* entry, int name_length) {
+  int i;
+  zip_member_t member = { 0 };
+  dsda_string_t path;
+  char* full_name;
+
+  full_name = Z_Malloc(name_length + 1);
+  memcpy(full_name, entry + ZIP_CENTRAL_SIZE, name_length);
+  full_name[name_length] = '\0';
+
+  // Intermediate directories have a trailing '/', so their base name is empty
+  if (!*dsda_BaseName(full_name)) {
+    Z_Free(full_name);
+    return true;
+  }
+
+  member.archive = archive;
+  member.method = dsda_ZipShort(entry + 10);
+  member.compressed_size = dsda_ZipLong(entry + 20);
+  member.size = dsda_ZipLong(entry + 24);
+  member.offset = dsda_ZipLong(entry + 42);
+
+  if (
+    (dsda_ZipShort(entry + 8) & 1) || // encrypted
+    (member.method != ZIP_STORED && member.method != ZIP_DEFLATED) ||
+    member.compressed_size == 0xffffffff ||
+    member.size == 0xffffffff ||
+    member.offset == 0xffffffff
+  ) {
+    Z_Free(full_name);
+    return false;
+  }
+
+  dsda_StringPrintF(&path, "%s/%s", archives[archive].path, dsda_BaseName(full_name));
+  member.path = path.string;
+  member.name = dsda_BaseName(member.path);
+  Z_Free(full_name);
+
+  // Later entries with the same base name replace earlier ones
+  for (i = archives[archive].first_member; i < member_count; ++i)
+    if (!strcmp(members[i].name, member.name)) {
+      Z_Free(members[i].path);
+      members[i] = member;
+      return true;
+    }
+
+  members = Z_Realloc(members, (member_count + 1) * sizeof(*members));
+  members[member_count++] = member;
+  ++archives[archive].member_count;
+
+  return true;
+}
+
+static dboolean dsda_ResolveZipMembers(int archive, int length) {
+  int i;
+  byte header[ZIP_LOCAL_SIZE];
+  zip_archive_t* zip = &archives[archive];
+
+  for (i = zip->first_member; i < member_count; ++i) {
+    zip_member_t* member = &members[i];
+
+    if ((unsigned int) length < ZIP_LOCAL_SIZE || member->offset > (unsigned int) length - ZIP_LOCAL_SIZE)
+      return false;
+
+    lseek(zip->handle, member->offset, SEEK_SET);
+    I_Read(zip->handle, header, ZIP_LOCAL_SIZE);
+
+    if (dsda_ZipLong(header) != ZIP_LOCAL_SIGNATURE)
+      return false;
+
+    member->offset += ZIP_LOCAL_SIZE + dsda_ZipShort(header + 26) + dsda_ZipShort(header + 28);
+
+    if (
+      member->offset > (unsigned int) length ||
+      member->compressed_size > (unsigned int) length - member->offset ||
+      (member->method == ZIP_STORED && member->compressed_size != member->size)
+    ) return false;
+  }
+
+  return true;
+}
+
+static dboolean dsda_ReadZipDirectory(int archive) {
+  int i;
+  int length;
+  int tail_length;
+  int entry_count;
+  unsigned int directory_size;
+  unsigned int directory_offset;
+  byte* tail;
+  byte* directory;
+  const byte* eocd = NULL;
+  const byte* p;
+  const byte* end;
+  dboolean result = false;
+  zip_archive_t* zip = &archives[archive];
+
+  length = I_Filelength(zip->handle);
+  if (length < ZIP_EOCD_SIZE)
+    return false;
+
+  tail_length = MIN(length, ZIP_EOCD_SIZE + ZIP_MAX_COMMENT);
+  tail = Z_Malloc(tail_length);
+  lseek(zip->handle, length - tail_length, SEEK_SET);
+  I_Read(zip->handle, tail, tail_length);
+
+  for (i = tail_length - ZIP_EOCD_SIZE; i >= 0; --i)
+    if (dsda_ZipLong(tail + i) == ZIP_EOCD_SIGNATURE) {
+      eocd = tail + i;
+      break;
+    }
+
+  if (!eocd) {
+    Z_Free(tail);
+    return false;
+  }
+
+  entry_count = dsda_ZipShort(eocd + 10);
+  directory_size = dsda_ZipLong(eocd + 12);
+  directory_offset = dsda_ZipLong(eocd + 16);
+  Z_Free(tail);
+
+  // Multi-disk and zip64 archives are left to libzip
+  if (
+    entry_count == 0xffff ||
+    directory_offset > (unsigned int) length ||
+    directory_size > (unsigned int) length - directory_offset
+  ) return false;
+
+  directory = Z_Malloc(directory_size);
+  lseek(zip->handle, directory_offset, SEEK_SET);
+  I_Read(zip->handle, directory, directory_size);
+
+  p = directory;
+  end = directory + directory_size;
+
+  for (i = 0; i < entry_count; ++i) {
+    int name_length;
+
+    if (end - p < ZIP_CENTRAL_SIZE || dsda_ZipLong(p) != ZIP_CENTRAL_SIGNATURE)
+      goto done;
+
+    name_length = dsda_ZipShort(p + 28);
+    if (end - p < ZIP_CENTRAL_SIZE + name_length)
+      goto done;
+
+    if (!dsda_AddZipMember(archive, p, name_length))
+      goto done;
+
+    p += ZIP_CENTRAL_SIZE + name_length + dsda_ZipShort(p + 30) + dsda_ZipShort(p + 32);
+  }
+
+  result = dsda_ResolveZipMembers(archive, length);
+
+done:
+  Z_Free(directory);
+
+  return result;
+}
+
+int dsda_MountZip(const char *zipped_file_name) {
+  int archive;
+  int handle;
+  zip_archive_t* zip;
+
+  handle = M_OpenRB(zipped_file_name);
+  if (handle == -1)
+    I_Error("dsda_MountZip: unable to open %s", zipped_file_name);
+
+  archive = archive_count;
+  archives = Z_Realloc(archives, (archive_count + 1) * sizeof(*archives));
+  zip = &archives[archive_count++];
+  zip->path = Z_Strdup(zipped_file_name);
+  zip->temp_dir = NULL;
+  zip->handle = handle;
+  zip->first_member = member_count;
+  zip->member_count = 0;
+  zip->bytes_read = 0;
+
+  if (!dsda_ReadZipDirectory(archive)) {
+    int i;
+
+    lprintf(LO_INFO, "dsda_MountZip: extracting %s\n", zipped_file_name);
+
+    for (i = zip->first_member; i < member_count; ++i)
+      Z_Free(members[i].path);
+    member_count = zip->first_member;
+
+    close(handle);
+    Z_Free(zip->path);
+    --archive_count;
+
+    return -1;
+  }
+
+  qsort(&members[zip->first_member], zip->member_count, sizeof(*members), dsda_CompareZipMembers);
+
+  return archive;
+}
+
+int dsda_ZipMemberCount(int archive) {
+  return archives[archive].member_count;
+}
+
+int dsda_ZipMember(int archive, int index) {
+  return archives[archive].first_member + index + 1;
+}
+
+int dsda_FindZipMember(int archive, const char* name) {
+  int i;
+
+  for (i = 0; i < archives[archive].member_count; ++i) {
+    int member = dsda_ZipMember(archive, i);
+
+    if (!strcasecmp(dsda_GetZipMember(member)->name, name))
+      return member;
+  }
+
+  return 0;
+}
+
+const char* dsda_ZipMemberPath(int member) {
+  return dsda_GetZipMember(member)->path;
+}
+
+const char* dsda_ZipMemberArchivePath(int member) {
+  return archives[dsda_GetZipMember(member)->archive].path;
+}
+
+int dsda_ZipMemberLength(int member) {
+  return dsda_GetZipMember(member)->size;
+}
+
+// Stored members are read through the archive handle
+int dsda_ZipMemberHandle(int member) {
+  zip_member_t* zip_member = dsda_GetZipMember(member);
+
+  return zip_member->method == ZIP_STORED ? archives[zip_member->archive].handle : 0;
+}
+
+int dsda_ZipMemberOffset(int member) {
+  return dsda_GetZipMember(member)->offset;
+}
+
+const byte* dsda_ZipMemberData(int member) {
+  byte* compressed;
+  zip_member_t* zip_member;
+  zip_archive_t* zip;
+
+  zip_member = dsda_GetZipMember(member);
+  if (zip_member->data)
+    return zip_member->data;
+
+  zip = &archives[zip_member->archive];
+
+  // Members freed after extraction may be inflated again
+  if (!zip_member->counted) {
+    zip_member->counted = true;
+    zip->bytes_read += zip_member->size;
+    if (zip->bytes_read >= UNZIPPED_BYTES_LIMIT)
+      I_Error("dsda_ZipMemberData: Too much data to decompress.");
+  }
+
+  zip_member->data = Z_Malloc(MAX(zip_member->size, 1));
+  compressed = zip_member->method == ZIP_STORED ? zip_member->data :
+                                                  Z_Malloc(MAX(zip_member->compressed_size, 1));
+
+  lseek(zip->handle, zip_member->offset, SEEK_SET);
+  I_Read(zip->handle, compressed, zip_member->compressed_size);
+
+  if (zip_member->method == ZIP_DEFLATED) {
+    int result;
+    z_stream stream = { 0 };
+
+    stream.next_in = compressed;
+    stream.avail_in = zip_member->compressed_size;
+    stream.next_out = zip_member->data;
+    stream.avail_out = zip_member->size;
+
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+      I_Error("dsda_ZipMemberData: Unable to initialize inflate.");
+
+    result = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+
+    if (result != Z_STREAM_END || stream.total_out != zip_member->size)
+      I_Error("dsda_ZipMemberData: Unable to decompress %s.", zip_member->path);
+
+    Z_Free(compressed);
+  }
+
+  return zip_member->data;
+}
+
+// Files that are loaded by name, like dehacked patches, still go to disk
+const char* dsda_ExtractZipMember(int member) {
+  FILE* dest_file;
+  dsda_string_t full_path;
+  zip_member_t* zip_member;
+  zip_archive_t* zip;
+
+  zip_member = dsda_GetZipMember(member);
+  zip = &archives[zip_member->archive];
+
+  if (!zip->temp_dir)
+    zip->temp_dir = dsda_MakeZipTempDir(zip->path);
+
+  dsda_StringPrintF(&full_path, "%s/%s", zip->temp_dir, zip_member->name);
+
+  dest_file = M_OpenFile(full_path.string, "wb");
+  if (dest_file == NULL)
+    I_Error("dsda_ExtractZipMember: Failed to open destination file %s.", full_path.string);
+
+  if (fwrite(dsda_ZipMemberData(member), 1, zip_member->size, dest_file) != zip_member->size)
+    I_Error("dsda_ExtractZipMember: Failed to write data to file.");
+
+  fclose(dest_file);
+
+  // Patches are small and read once
+  Z_Free(zip_member->data);
+  zip_member->data = NULL;
+
+  return full_path.string;
+}
+
 void dsda_CleanZipTempDirs(void) {
   int i;
 
@@ -18,8 +18,22 @@
 #ifndef __DSDA_ZIPFILE__
 #define __DSDA_ZIPFILE__
 
+#include "doomtype.h"
+
 const char* dsda_UnzipFile(const char *zipped_file_name);
 
+int dsda_MountZip(const char *zipped_file_name);
+int dsda_ZipMemberCount(int archive);
+int dsda_ZipMember(int archive, int index);
+int dsda_FindZipMember(int archive, const char* name);
+const char* dsda_ZipMemberPath(int member);
+const char* dsda_ZipMemberArchivePath(int member);
+int dsda_ZipMemberLength(int member);
+int dsda_ZipMemberHandle(int member);
+int dsda_ZipMemberOffset(int member);
+const byte* dsda_ZipMemberData(int member);
+const char* dsda_ExtractZipMember(int member);
+
 void dsda_CleanZipTempDirs(void);
 
 #endif /* __DSDA_ZIPFILE__ */
@@ -87,6 +87,7 @@
 
 #include "dsda.h"
 #include "dsda/args.h"
+#include "dsda/benchmark.h"
 #include "dsda/brute_force.h"
 #include "dsda/build.h"
 #include "dsda/configuration.h"
@@ -107,12 +108,15 @@
 #include "dsda/options.h"
 #include "dsda/pause.h"
 #include "dsda/playback.h"
+#include "dsda/profiler.h"
 #include "dsda/skill_info.h"
+#include "dsda/seek_index.h"
 #include "dsda/skip.h"
 #include "dsda/time.h"
 #include "dsda/tracker.h"
 #include "dsda/split_tracker.h"
 #include "dsda/utility.h"
+#include "dsda/video_segment.h"
 
 struct
 {
@@ -1530,6 +1534,8 @@ void G_Ticker (void)
     int buf = gametic % BACKUPTICS;
 
     dsda_UpdateAutoKeyFrames();
+    dsda_UpdateSeekIndex();
+    dsda_UpdateVideoSegments();
 
     if (dsda_BruteForce())
     {
@@ -1648,7 +1654,11 @@ void G_Ticker (void)
   switch (gamestate)
   {
     case GS_LEVEL:
+      dsda_BenchmarkTicStart();
+      DSDA_PROFILE_BEGIN(dsda_profile_ticker);
       P_Ticker();
+      DSDA_PROFILE_END(dsda_profile_ticker);
+      dsda_BenchmarkTicEnd();
       P_WalkTicker();
       mlooky = 0;
       AM_Ticker();
@@ -3939,6 +3949,9 @@ void G_DoPlayDemo(void)
   if (LoadDemo(defdemoname, &demobuffer, &demolength))
   {
     G_StartDemoPlayback(demobuffer, demolength, PLAYBACK_NORMAL);
+    dsda_ContinueKeyFrame();
+    dsda_InitSeekIndex(demobuffer, demolength);
+    dsda_EvaluateSkipModeSeekIndex();
 
     if (dsda_Flag(dsda_arg_track_playback))
       dsda_ResetSplits();
@@ -179,7 +179,7 @@ dboolean EV_RotateZDoomPoly(line_t * line, int polyNum, int speed,
     {
         I_Error("EV_RotatePoly:  Invalid polyobj num: %d\n", polyNum);
     }
-    pe = Z_MallocLevel(sizeof(polyevent_t));
+    pe = P_MallocThinker(sizeof(polyevent_t));
     P_AddThinker(&pe->thinker);
     pe->thinker.function = T_RotatePoly;
     pe->polyobj = polyNum;
@@ -209,7 +209,7 @@ dboolean EV_RotateZDoomPoly(line_t * line, int polyNum, int speed,
         {                       // mirroring poly is already in motion
             break;
         }
-        pe = Z_MallocLevel(sizeof(polyevent_t));
+        pe = P_MallocThinker(sizeof(polyevent_t));
         P_AddThinker(&pe->thinker);
         pe->thinker.function = T_RotatePoly;
         poly->specialdata = pe;
@@ -278,7 +278,7 @@ static void EV_SpawnMovePolyEvent(int polyNum, polyobj_t *poly, fixed_t speed,
     int mirror;
     polyevent_t *pe;
 
-    pe = Z_MallocLevel(sizeof(polyevent_t));
+    pe = P_MallocThinker(sizeof(polyevent_t));
     P_AddThinker(&pe->thinker);
     pe->thinker.function = T_MovePoly;
     pe->polyobj = polyNum;
@@ -297,7 +297,7 @@ static void EV_SpawnMovePolyEvent(int polyNum, polyobj_t *poly, fixed_t speed,
         {                       // mirroring poly is already in motion
             break;
         }
-        pe = Z_MallocLevel(sizeof(polyevent_t));
+        pe = P_MallocThinker(sizeof(polyevent_t));
         P_AddThinker(&pe->thinker);
         pe->thinker.function = T_MovePoly;
         pe->polyobj = mirror;
@@ -522,7 +522,7 @@ dboolean EV_OpenZDoomPolyDoor(line_t * line, int polyNum, int speed,
     {
         I_Error("EV_OpenPolyDoor:  Invalid polyobj num: %d\n", polyNum);
     }
-    pd = Z_MallocLevel(sizeof(polydoor_t));
+    pd = P_MallocThinker(sizeof(polydoor_t));
     memset(pd, 0, sizeof(polydoor_t));
     P_AddThinker(&pd->thinker);
     pd->thinker.function = T_PolyDoor;
@@ -559,7 +559,7 @@ dboolean EV_OpenZDoomPolyDoor(line_t * line, int polyNum, int speed,
         {                       // mirroring poly is already in motion
             break;
         }
-        pd = Z_MallocLevel(sizeof(polydoor_t));
+        pd = P_MallocThinker(sizeof(polydoor_t));
         memset(pd, 0, sizeof(polydoor_t));
         P_AddThinker(&pd->thinker);
         pd->thinker.function = T_PolyDoor;
@@ -972,6 +972,9 @@ void UnLinkPolyobj(polyobj_t * po)
     int i, j;
     int index;
 
+    // polyobj segs block sight
+    P_InvalidateSightCache();
+
     // remove the polyobj from each blockmap section
     for (j = po->bbox[BOXBOTTOM]; j <= po->bbox[BOXTOP]; j++)
     {
@@ -1004,6 +1007,8 @@ void LinkPolyobj(polyobj_t * po)
     polyblock_t *tempLink;
     int i, j;
 
+    P_InvalidateSightCache();
+
     // calculate the polyobj bbox
     tempSeg = po->segs;
     rightX = leftX = (*tempSeg)->v1->x;
@@ -33,14 +33,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "i_sound.h"
 #include "i_video.h"
 #include "lprintf.h"
 #include "m_file.h"
 #include "i_system.h"
 #include "i_capture.h"
+#include "z_zone.h"
 
+#include "dsda/args.h"
 #include "dsda/configuration.h"
+#include "dsda/utility.h"
 
 int capturing_video = 0;
 static const char *vid_fname;
@@ -52,9 +56,9 @@ typedef struct
   FILE *f_stdout;
   FILE *f_stderr;
   SDL_Thread *outthread;
-  const char *stdoutdumpname;
+  dsda_string_t stdoutdumpname;
   SDL_Thread *errthread;
-  const char *stderrdumpname;
+  dsda_string_t stderrdumpname;
   void *user;
 } pipeinfo_t;
 
@@ -66,6 +70,67 @@ int cap_fps;
 int cap_frac;
 int cap_wipescreen;
 
+// -viddump_temp prefixes the temp and log files,
+// so that several captures can run in the same directory
+static const char *cap_temp_prefix;
+
+// Both fill dest, which the caller frees with dsda_FreeString
+static void I_CaptureTempName (dsda_string_t *dest, const char *name)
+{
+  dsda_InitString(dest, "");
+  dsda_StringCat(dest, cap_temp_prefix);
+  dsda_StringCat(dest, name);
+}
+
+static void I_CaptureTempCommand (dsda_string_t *dest, const char *command)
+{
+  int i;
+  size_t length;
+  dboolean replaced;
+  const char *tempfiles[2];
+
+  dsda_InitString(dest, "");
+
+  if (!cap_temp_prefix)
+  {
+    dsda_StringCat(dest, command);
+    return;
+  }
+
+  tempfiles[0] = dsda_StringConfig(dsda_config_cap_tempfile1);
+  tempfiles[1] = dsda_StringConfig(dsda_config_cap_tempfile2);
+
+  while (*command)
+  {
+    replaced = false;
+
+    for (i = 0; i < 2; i++)
+    {
+      length = strlen(tempfiles[i]);
+
+      if (length && !strncmp(command, tempfiles[i], length))
+      {
+        dsda_StringCatF(dest, "%s%s", cap_temp_prefix, tempfiles[i]);
+        command += length;
+        replaced = true;
+        break;
+      }
+    }
+
+    if (!replaced)
+      dsda_StringCatF(dest, "%c", *command++);
+  }
+}
+
+static void I_CaptureRemoveTempFile (const char *name)
+{
+  dsda_string_t path;
+
+  I_CaptureTempName(&path, name);
+  M_remove(path.string);
+  dsda_FreeString(&path);
+}
+
 // parses a command with simple printf-style replacements.
 
 // %w video width (px)
@@ -126,6 +191,22 @@ static int parsecommand (char *out, const char *in, int len)
   return 1;
 }
 
+static int I_CaptureParseCommand (char *out, dsda_config_identifier_t id, int len)
+{
+  int result;
+  dsda_string_t command;
+
+  I_CaptureTempCommand(&command, dsda_StringConfig(id));
+
+  result = parsecommand(out, command.string, len);
+  if (!result)
+    lprintf (LO_ERROR, "I_CapturePrep: malformed command %s\n", command.string);
+
+  dsda_FreeString(&command);
+
+  return result;
+}
+
 
 
 
@@ -454,7 +535,7 @@ static int threadstdoutproc (void *data)
 
   pipeinfo_t *p = (pipeinfo_t *) data;
 
-  FILE *f = M_OpenFile(p->stdoutdumpname, "w");
+  FILE *f = M_OpenFile(p->stdoutdumpname.string, "w");
 
   if (!f || !p->f_stdout)
     return 0;
@@ -474,7 +555,7 @@ static int threadstderrproc (void *data)
 
   pipeinfo_t *p = (pipeinfo_t *) data;
 
-  FILE *f = M_OpenFile(p->stderrdumpname, "w");
+  FILE *f = M_OpenFile(p->stderrdumpname.string, "w");
 
   if (!f || !p->f_stderr)
     return 0;
@@ -488,37 +569,173 @@ static int threadstderrproc (void *data)
 }
 
 
+// Frames are queued in a ring and written to the encoder pipes by
+// dedicated threads, so an encoder stall doesn't stall the game loop
+// until the ring fills up. The main thread still does the screen
+// readback (it owns the renderer), then only copies into a free slot.
+// Slot memory is only allocated on the main thread.
+
+#define CAPTURE_RING_SIZE 8
+
+typedef struct
+{
+  const char *name;
+  FILE *f;
+  SDL_Thread *thread;
+  SDL_mutex *mutex;
+  SDL_cond *not_empty;
+  SDL_cond *not_full;
+
+  unsigned char *data[CAPTURE_RING_SIZE];
+  size_t size[CAPTURE_RING_SIZE];
+  size_t capacity[CAPTURE_RING_SIZE];
+  int head;
+  int count;
+  int closing;
+
+  // statistics
+  int frames;
+  int stalls;
+  int errors;
+  Uint64 stall_time;
+} capture_ring_t;
+
+static capture_ring_t soundring;
+static capture_ring_t videoring;
+
+static int threadringproc (void *data)
+{ // drains the ring into the pipe
+  capture_ring_t *ring = (capture_ring_t *) data;
+  int tail = 0;
+  int error;
+
+  while (1)
+  {
+    SDL_LockMutex (ring->mutex);
+    while (!ring->count && !ring->closing)
+      SDL_CondWait (ring->not_empty, ring->mutex);
+    if (!ring->count)
+    {
+      SDL_UnlockMutex (ring->mutex);
+      break;
+    }
+    SDL_UnlockMutex (ring->mutex);
+
+    // the main thread doesn't touch queued slots
+    error = fwrite (ring->data[tail], ring->size[tail], 1, ring->f) != 1;
+
+    SDL_LockMutex (ring->mutex);
+    ring->errors += error;
+    ring->count--;
+    SDL_CondSignal (ring->not_full);
+    SDL_UnlockMutex (ring->mutex);
+
+    tail = (tail + 1) % CAPTURE_RING_SIZE;
+  }
+
+  return 0;
+}
+
+static void I_StartCaptureRing (capture_ring_t *ring, const char *name, FILE *f)
+{
+  memset (ring, 0, sizeof(*ring));
+  ring->name = name;
+  ring->f = f;
+  ring->mutex = SDL_CreateMutex ();
+  ring->not_empty = SDL_CreateCond ();
+  ring->not_full = SDL_CreateCond ();
+  ring->thread = SDL_CreateThread (threadringproc, name, ring);
+}
+
+static void I_QueueCapture (capture_ring_t *ring, const unsigned char *data, size_t size)
+{
+  int slot;
+
+  SDL_LockMutex (ring->mutex);
+  if (ring->count == CAPTURE_RING_SIZE)
+  {
+    Uint64 start = SDL_GetPerformanceCounter ();
+
+    ring->stalls++;
+    while (ring->count == CAPTURE_RING_SIZE)
+      SDL_CondWait (ring->not_full, ring->mutex);
+    ring->stall_time += SDL_GetPerformanceCounter () - start;
+  }
+  slot = ring->head;
+  SDL_UnlockMutex (ring->mutex);
+
+  // the slot is free, so the writer won't look at it until it is queued
+  if (size > ring->capacity[slot])
+  {
+    ring->capacity[slot] = size;
+    ring->data[slot] = Z_Realloc (ring->data[slot], size);
+  }
+  memcpy (ring->data[slot], data, size);
+  ring->size[slot] = size;
+
+  SDL_LockMutex (ring->mutex);
+  ring->head = (ring->head + 1) % CAPTURE_RING_SIZE;
+  ring->count++;
+  ring->frames++;
+  SDL_CondSignal (ring->not_empty);
+  SDL_UnlockMutex (ring->mutex);
+}
+
+static void I_StopCaptureRing (capture_ring_t *ring)
+{
+  int i;
+
+  if (!ring->thread)
+    return;
+
+  SDL_LockMutex (ring->mutex);
+  ring->closing = 1;
+  SDL_CondSignal (ring->not_empty);
+  SDL_UnlockMutex (ring->mutex);
+
+  SDL_WaitThread (ring->thread, NULL);
+  ring->thread = NULL;
+
+  lprintf (LO_INFO, "I_CaptureFinish: %s: %d frames, %d stalls (%.3f s), %d write errors\n",
+           ring->name, ring->frames, ring->stalls,
+           (double) ring->stall_time / SDL_GetPerformanceFrequency (), ring->errors);
+
+  SDL_DestroyCond (ring->not_full);
+  SDL_DestroyCond (ring->not_empty);
+  SDL_DestroyMutex (ring->mutex);
+
+  for (i = 0; i < CAPTURE_RING_SIZE; i++)
+    Z_Free (ring->data[i]);
+}
+
+
 // init and open sound, video pipes
 // fn is filename passed from command line, typically final output file
 void I_CapturePrep (const char *fn)
 {
-  const char* cap_soundcommand;
-  const char* cap_videocommand;
-  const char* cap_muxcommand;
+  dsda_arg_t* arg;
+
+  arg = dsda_Arg(dsda_arg_viddump_temp);
+  if (arg->found)
+    cap_temp_prefix = arg->value.v_string;
 
-  cap_soundcommand = dsda_StringConfig(dsda_config_cap_soundcommand);
-  cap_videocommand = dsda_StringConfig(dsda_config_cap_videocommand);
-  cap_muxcommand = dsda_StringConfig(dsda_config_cap_muxcommand);
   cap_wipescreen = dsda_IntConfig(dsda_config_cap_wipescreen);
   cap_fps = dsda_IntConfig(dsda_config_cap_fps);
 
   vid_fname = fn;
 
-  if (!parsecommand (soundpipe.command, cap_soundcommand, sizeof(soundpipe.command)))
+  if (!I_CaptureParseCommand (soundpipe.command, dsda_config_cap_soundcommand, sizeof(soundpipe.command)))
   {
-    lprintf (LO_ERROR, "I_CapturePrep: malformed command %s\n", cap_soundcommand);
     capturing_video = 0;
     return;
   }
-  if (!parsecommand (videopipe.command, cap_videocommand, sizeof(videopipe.command)))
+  if (!I_CaptureParseCommand (videopipe.command, dsda_config_cap_videocommand, sizeof(videopipe.command)))
   {
-    lprintf (LO_ERROR, "I_CapturePrep: malformed command %s\n", cap_videocommand);
     capturing_video = 0;
     return;
   }
-  if (!parsecommand (muxpipe.command, cap_muxcommand, sizeof(muxpipe.command)))
+  if (!I_CaptureParseCommand (muxpipe.command, dsda_config_cap_muxcommand, sizeof(muxpipe.command)))
   {
-    lprintf (LO_ERROR, "I_CapturePrep: malformed command %s\n", cap_muxcommand);
     capturing_video = 0;
     return;
   }
@@ -542,13 +759,16 @@ void I_CapturePrep (const char *fn)
   lprintf (LO_INFO, "I_CapturePrep: video capture started\n");
   capturing_video = 1;
 
+  I_StartCaptureRing (&soundring, "soundring", soundpipe.f_stdin);
+  I_StartCaptureRing (&videoring, "videoring", videopipe.f_stdin);
+
   // start reader threads
-  soundpipe.stdoutdumpname = "sound_stdout.txt";
-  soundpipe.stderrdumpname = "sound_stderr.txt";
+  I_CaptureTempName(&soundpipe.stdoutdumpname, "sound_stdout.txt");
+  I_CaptureTempName(&soundpipe.stderrdumpname, "sound_stderr.txt");
   soundpipe.outthread = SDL_CreateThread (threadstdoutproc, "soundpipe.outthread", &soundpipe);
   soundpipe.errthread = SDL_CreateThread (threadstderrproc, "soundpipe.errthread", &soundpipe);
-  videopipe.stdoutdumpname = "video_stdout.txt";
-  videopipe.stderrdumpname = "video_stderr.txt";
+  I_CaptureTempName(&videopipe.stdoutdumpname, "video_stdout.txt");
+  I_CaptureTempName(&videopipe.stderrdumpname, "video_stderr.txt");
   videopipe.outthread = SDL_CreateThread (threadstdoutproc, "videopipe.outthread", &videopipe);
   videopipe.errthread = SDL_CreateThread (threadstderrproc, "videopipe.errthread", &videopipe);
 
@@ -580,18 +800,11 @@ void I_CaptureFrame (void)
 
   snd = I_GrabSound (nsampreq);
   if (snd)
-  {
-    if (fwrite (snd, nsampreq * 4, 1, soundpipe.f_stdin) != 1)
-      lprintf(LO_WARN, "I_CaptureFrame: error writing soundpipe.\n");
-    //Z_Free (snd); // static buffer
-  }
+    I_QueueCapture (&soundring, snd, nsampreq * 4);
+
   vid = I_GrabScreen ();
   if (vid)
-  {
-    if (fwrite (vid, renderW * renderH * 3, 1, videopipe.f_stdin) != 1)
-      lprintf(LO_WARN, "I_CaptureFrame: error writing videopipe.\n");
-    //Z_Free (vid); // static buffer
-  }
+    I_QueueCapture (&videoring, vid, renderW * renderH * 3);
 
 }
 
@@ -605,6 +818,10 @@ void I_CaptureFinish (void)
     return;
   capturing_video = 0;
 
+  // flush everything still queued before the pipes are closed
+  I_StopCaptureRing (&videoring);
+  I_StopCaptureRing (&soundring);
+
   // on linux, we have to close videopipe first, because it has a copy of the write
   // end of soundpipe_stdin (so that stream will never see EOF).
   // is there a better way to do this?
@@ -613,10 +830,14 @@ void I_CaptureFinish (void)
   my_pclose3 (&videopipe);
   SDL_WaitThread (videopipe.outthread, &s);
   SDL_WaitThread (videopipe.errthread, &s);
+  dsda_FreeString (&videopipe.stdoutdumpname);
+  dsda_FreeString (&videopipe.stderrdumpname);
 
   my_pclose3 (&soundpipe);
   SDL_WaitThread (soundpipe.outthread, &s);
   SDL_WaitThread (soundpipe.errthread, &s);
+  dsda_FreeString (&soundpipe.stdoutdumpname);
+  dsda_FreeString (&soundpipe.stderrdumpname);
 
   // muxing and temp file cleanup
 
@@ -628,26 +849,22 @@ void I_CaptureFinish (void)
     return;
   }
 
-  muxpipe.stdoutdumpname = "mux_stdout.txt";
-  muxpipe.stderrdumpname = "mux_stderr.txt";
+  I_CaptureTempName(&muxpipe.stdoutdumpname, "mux_stdout.txt");
+  I_CaptureTempName(&muxpipe.stderrdumpname, "mux_stderr.txt");
   muxpipe.outthread = SDL_CreateThread (threadstdoutproc, "muxpipe.outthread", &muxpipe);
   muxpipe.errthread = SDL_CreateThread (threadstderrproc, "muxpipe.errthread", &muxpipe);
 
   my_pclose3 (&muxpipe);
   SDL_WaitThread (muxpipe.outthread, &s);
   SDL_WaitThread (muxpipe.errthread, &s);
+  dsda_FreeString (&muxpipe.stdoutdumpname);
+  dsda_FreeString (&muxpipe.stderrdumpname);
 
 
   // unlink any files user wants gone
   if (dsda_IntConfig(dsda_config_cap_remove_tempfiles))
   {
-    const char* cap_tempfile1;
-    const char* cap_tempfile2;
-
-    cap_tempfile1 = dsda_StringConfig(dsda_config_cap_tempfile1);
-    cap_tempfile2 = dsda_StringConfig(dsda_config_cap_tempfile2);
-
-    M_remove (cap_tempfile1);
-    M_remove (cap_tempfile2);
+    I_CaptureRemoveTempFile (dsda_StringConfig(dsda_config_cap_tempfile1));
+    I_CaptureRemoveTempFile (dsda_StringConfig(dsda_config_cap_tempfile2));
   }
 }
@@ -115,4 +115,7 @@ typedef void (*atexit_func_t)(void);
 void I_AtExit(atexit_func_t func, dboolean run_if_error,
               const char* name, exit_priority_t priority);
 
+// For forked worker processes, which share the parent's window and files
+void I_SkipExitHandlers(void);
+
 #endif
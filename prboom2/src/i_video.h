@@ -76,6 +76,12 @@ unsigned char *I_GrabScreen (void);
  */
 void I_StartTic (void);
 
+/* I_PumpEvents
+ * Keeps the window responsive during long blocking work,
+ * without posting any events to the game.
+ */
+void I_PumpEvents (void);
+
 /* I_StartFrame
  * Called by D_DoomLoop,
  * called before processing any tics in a frame
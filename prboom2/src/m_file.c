@@ -266,6 +266,7 @@ static int M_stat(const char *path, struct stat *buf)
   // field.
   buf->st_mode = wbuf.st_mode;
   buf->st_mtime = wbuf.st_mtime;
+  buf->st_size = wbuf.st_size;
 
   Z_Free(wpath);
 
@@ -296,6 +297,48 @@ int M_remove(const char *path)
 #endif
 }
 
+// Replaces newpath if it exists
+int M_rename(const char *oldpath, const char *newpath)
+{
+#ifdef _WIN32
+  wchar_t *wold;
+  wchar_t *wnew;
+  int ret;
+
+  wold = ConvertUtf8ToWide(oldpath);
+  wnew = ConvertUtf8ToWide(newpath);
+
+  if (!wold || !wnew)
+  {
+    Z_Free(wold);
+    Z_Free(wnew);
+    return -1;
+  }
+
+  ret = MoveFileExW(wold, wnew, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+
+  Z_Free(wold);
+  Z_Free(wnew);
+
+  return ret;
+#else
+  return rename(oldpath, newpath);
+#endif
+}
+
+dboolean M_FileInfo(const char *name, int64_t *size, int64_t *mtime)
+{
+  struct stat sbuf;
+
+  if (M_stat(name, &sbuf))
+    return false;
+
+  *size = sbuf.st_size;
+  *mtime = sbuf.st_mtime;
+
+  return true;
+}
+
 int M_MakeDir(const char *path, int require) {
   int error;
 
@@ -52,6 +52,8 @@ int M_ReadFileToString(char const *name, char **buffer);
 dboolean M_RemoveFilesAtPath(const char *path);
 
 int M_remove(const char *path);
+int M_rename(const char *oldpath, const char *newpath);
+dboolean M_FileInfo(const char *name, int64_t *size, int64_t *mtime);
 char *M_getcwd(char *buffer, int len);
 char *M_getenv(const char *name);
 
@@ -53,6 +53,7 @@
 #include "e6y.h"//e6y
 
 #include "dsda.h"
+#include "dsda/args.h"
 #include "dsda/configuration.h"
 #include "dsda/id_list.h"
 #include "dsda/map_format.h"
@@ -87,14 +88,153 @@ void P_ZBumpCheck(mobj_t *);                                        // phares
 // but some can be made preaware
 //
 
+//
+// Sector adjacency for sound propagation
+//
+// Each sector lists its lines in the order of sec->lines, with the
+// sector on the far side, or NULL for lines without a back side.
+// Line flags can change during play, so they are still read from the line.
+//
+
+typedef struct
+{
+  line_t *line;
+  sector_t *other;
+} sound_edge_t;
+
+typedef struct
+{
+  sector_t *sec;
+  int soundblocks;
+  int edge;           // next edge to follow
+} sound_frame_t;
+
+static sound_edge_t *sound_edges;
+static int *sound_edge_start;     // first edge of each sector, plus an end marker
+static sound_frame_t *sound_stack;
+
+void P_InitSoundGraph(void)
+{
+  int i, j;
+  int count;
+
+  for (count = 0, i = 0; i < numsectors; i++)
+    count += sectors[i].linecount;
+
+  sound_edges = Z_MallocLevel(count * sizeof(*sound_edges));
+  sound_edge_start = Z_MallocLevel((numsectors + 1) * sizeof(*sound_edge_start));
+
+  // a sector is entered at most twice, once per soundblocks value
+  sound_stack = Z_MallocLevel((2 * numsectors + 1) * sizeof(*sound_stack));
+
+  for (count = 0, i = 0; i < numsectors; i++)
+  {
+    sector_t *sec = &sectors[i];
+
+    sound_edge_start[i] = count;
+
+    for (j = 0; j < sec->linecount; j++)
+    {
+      line_t *check = sec->lines[j];
+
+      sound_edges[count].line = check;
+      sound_edges[count].other = check->sidenum[1] == NO_INDEX ? NULL :
+        sides[check->sidenum[sides[check->sidenum[0]].sector==sec]].sector;
+      count++;
+    }
+  }
+
+  sound_edge_start[numsectors] = count;
+}
+
 //
 // Called by P_NoiseAlert.
-// Recursively traverse adjacent sectors,
+// Traverse adjacent sectors depth first,
 // sound blocking lines cut off traversal.
 //
 // killough 5/5/98: reformatted, cleaned up
+//
+// The stack visits sectors and lines in the order of the original
+// recursion, and line_opening is left as the last line examined left it.
+
+static int P_EnterSoundSector(int depth, sector_t *sec, int soundblocks, mobj_t *soundtarget)
+{
+  // wake up all monsters in this sector
+  if (sec->validcount == validcount && sec->soundtraversed <= soundblocks+1)
+    return depth;       // already flooded
+
+  sec->validcount = validcount;
+  sec->soundtraversed = soundblocks+1;
+  P_SetTarget(&sec->soundtarget, soundtarget);
+
+  sound_stack[depth].sec = sec;
+  sound_stack[depth].soundblocks = soundblocks;
+  sound_stack[depth].edge = sound_edge_start[sec->iSectorID];
+
+  return depth + 1;
+}
 
 static void P_RecursiveSound(sector_t *sec, int soundblocks, mobj_t *soundtarget)
+{
+  int depth;
+  const line_t *last_line = NULL;
+  const line_t *last_opening = NULL;  // last line with a back side
+
+  depth = P_EnterSoundSector(0, sec, soundblocks, soundtarget);
+
+  while (depth)
+  {
+    sound_frame_t *frame = &sound_stack[depth - 1];
+    line_t *check;
+    fixed_t top, bottom;
+
+    if (frame->edge == sound_edge_start[frame->sec->iSectorID + 1])
+    {
+      depth--;
+      continue;
+    }
+
+    check = sound_edges[frame->edge].line;
+    sec = sound_edges[frame->edge].other;
+    frame->edge++;
+
+    if (!(check->flags & ML_TWOSIDED))
+      continue;
+
+    last_line = check;
+
+    if (!sec)
+      continue;       // single sided after all
+
+    last_opening = check;
+
+    top = MIN(check->frontsector->ceilingheight, check->backsector->ceilingheight);
+    bottom = MAX(check->frontsector->floorheight, check->backsector->floorheight);
+
+    if (top - bottom <= 0)
+      continue;       // closed door
+
+    if (!(check->flags & ML_SOUNDBLOCK))
+      depth = P_EnterSoundSector(depth, sec, frame->soundblocks, soundtarget);
+    else
+      if (!frame->soundblocks)
+        depth = P_EnterSoundSector(depth, sec, 1, soundtarget);
+  }
+
+  // a single sided line only resets the range
+  if (last_opening)
+    P_LineOpening(last_opening, NULL);
+  if (last_line && last_line != last_opening)
+    P_LineOpening(last_line, NULL);
+}
+
+//
+// The original recursion, kept so -no_sound_graph can check the graph
+// walk against it through state hashes.
+//
+// killough 5/5/98: reformatted, cleaned up
+
+static void P_RecursiveSoundReference(sector_t *sec, int soundblocks, mobj_t *soundtarget)
 {
   int i;
 
@@ -122,10 +262,10 @@ static void P_RecursiveSound(sector_t *sec, int soundblocks, mobj_t *soundtarget
     other=sides[check->sidenum[sides[check->sidenum[0]].sector==sec]].sector;
 
     if (!(check->flags & ML_SOUNDBLOCK))
-      P_RecursiveSound(other, soundblocks, soundtarget);
+      P_RecursiveSoundReference(other, soundblocks, soundtarget);
     else
       if (!soundblocks)
-        P_RecursiveSound(other, 1, soundtarget);
+        P_RecursiveSoundReference(other, 1, soundtarget);
   }
 }
 
@@ -140,7 +280,11 @@ void P_NoiseAlert(mobj_t *target, mobj_t *emitter)
     return;
 
   validcount++;
-  P_RecursiveSound(emitter->subsector->sector, 0, target);
+
+  if (dsda_Flag(dsda_arg_no_sound_graph))
+    P_RecursiveSoundReference(emitter->subsector->sector, 0, target);
+  else
+    P_RecursiveSound(emitter->subsector->sector, 0, target);
 }
 
 //
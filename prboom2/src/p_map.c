@@ -51,6 +51,7 @@
 #include "e6y.h"//e6y
 
 #include "dsda.h"
+#include "dsda/args.h"
 #include "dsda/destructible.h"
 #include "dsda/map_format.h"
 #include "dsda/mapinfo.h"
@@ -2921,6 +2922,9 @@ dboolean P_ChangeSector(sector_t* sector, int crunch)
   int   x;
   int   y;
 
+  // called after every plane move
+  P_InvalidateSightCache();
+
   nofit = false;
   crushchange = crunch;
 
@@ -2940,8 +2944,15 @@ dboolean P_ChangeSector(sector_t* sector, int crunch)
   return nofit;
 }
 
+// Bumped whenever a sector's touching_thinglist is relinked or its visited
+// marks are touched outside P_CheckSector, so P_CheckSector can tell when
+// it is safe to carry on from where it was instead of rescanning.
+static unsigned int secnode_generation;
+
 void P_InitSectorSearch(mobj_in_sector_t *data, sector_t *sector)
 {
+  secnode_generation++;
+
   data->sector = sector;
 
   for (data->node = data->sector->touching_thinglist;
@@ -2961,6 +2972,7 @@ mobj_t *P_FindMobjInSector(mobj_in_sector_t *data)
     return NULL;
 
   data->node->visited = true;
+  secnode_generation++;
 
   return data->node->m_thing;
 }
@@ -2975,6 +2987,9 @@ mobj_t *P_FindMobjInSector(mobj_in_sector_t *data)
 dboolean P_CheckSector(sector_t* sector, int crunch)
 {
   msecnode_t *n;
+  dboolean resume;
+
+  P_InvalidateSightCache();
 
   if (comp[comp_floors]) /* use the old routine for old demos though */
     return P_ChangeSector(sector,crunch);
@@ -2993,21 +3008,46 @@ dboolean P_CheckSector(sector_t* sector, int crunch)
   //
   // killough 4/7/98: simplified to avoid using complicated counter
 
+  // Nothing touches the sector, nothing to clip or crush
+  if (!sector->touching_thinglist)
+    return nofit;
+
   // Mark all things invalid
 
   for (n=sector->touching_thinglist; n; n=n->m_snext)
     n->visited = false;
 
-  do
-    for (n=sector->touching_thinglist; n; n=n->m_snext)  // go through list
-      if (!n->visited)               // unprocessed thing found
-        {
-        n->visited  = true;          // mark thing as processed
-        if (!(n->m_thing->flags & MF_NOBLOCKMAP)) //jff 4/7/98 don't do these
-          PIT_ChangeSector(n->m_thing);    // process it
-        break;                 // exit and start over
-        }
-  while (n);  // repeat from scratch until all things left are marked valid
+  // Every node before the one just processed is already marked, so as long
+  // as processing it left the sector lists alone, restarting from the head
+  // would skip straight back to its successor. Only rescan when something
+  // was actually inserted, removed or unmarked; this keeps the order of
+  // the original restart loop without its quadratic cost on crowded sectors.
+
+  // -no_sector_scan_resume always restarts, as the original loop did
+  resume = !dsda_Flag(dsda_arg_no_sector_scan_resume);
+
+  n = sector->touching_thinglist;
+  while (n)
+  {
+    unsigned int generation;
+
+    if (n->visited)
+    {
+      n = n->m_snext;
+      continue;
+    }
+
+    n->visited = true;               // mark thing as processed
+    generation = secnode_generation;
+
+    if (!(n->m_thing->flags & MF_NOBLOCKMAP)) //jff 4/7/98 don't do these
+      PIT_ChangeSector(n->m_thing);    // process it
+
+    if (resume && generation == secnode_generation)
+      n = n->m_snext;
+    else
+      n = sector->touching_thinglist;  // lists changed, start over
+  }
 
   return nofit;
 }
@@ -3112,6 +3152,7 @@ msecnode_t* P_AddSecnode(sector_t* s, mobj_t* thing, msecnode_t* nextnode)
   // of the list.
 
   node = P_GetSecnode();
+  secnode_generation++;
 
   // killough 4/4/98, 4/7/98: mark new nodes unvisited.
   node->visited = 0;
@@ -3173,6 +3214,7 @@ msecnode_t* P_DelSecnode(msecnode_t* node)
     // Return this node to the freelist
 
     P_PutSecnode(node);
+    secnode_generation++;
     return(tn);
     }
   return(NULL);
@@ -3332,6 +3374,7 @@ void P_CreateSecNodeList(mobj_t* thing,fixed_t x,fixed_t y)
  * Must clear tmthing at tic end, as it might contain a pointer to a removed thinker, or the level might have ended/been ended and we clear the objects it was pointing too. Hopefully we don't need to carry this between tics for sync. */
 void P_MapStart(void) {
 	if (tmthing) I_Error("P_MapStart: tmthing set!");
+	P_InvalidateSightCache();
 }
 void P_MapEnd(void) {
 	tmthing = NULL;
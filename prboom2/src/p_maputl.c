@@ -47,6 +47,7 @@
 #include "e6y.h"//e6y
 
 #include "dsda/map_format.h"
+#include "dsda/profiler.h"
 
 //
 // P_AproxDistance
@@ -782,8 +783,8 @@ dboolean P_TraverseIntercepts(traverser_t func, fixed_t maxfrac)
 //
 // killough 5/3/98: reformatted, cleaned up
 
-dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
-                       int flags, dboolean trav(intercept_t *))
+static dboolean P_PathTraverseInternal(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                                       int flags, dboolean trav(intercept_t *))
 {
   fixed_t xt1, yt1;
   fixed_t xt2, yt2;
@@ -928,6 +929,21 @@ dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
   return P_TraverseIntercepts(trav, FRACUNIT);
 }
 
+dboolean P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
+                       int flags, dboolean trav(intercept_t *))
+{
+  dboolean result;
+
+  if (!dsda_profiling)
+    return P_PathTraverseInternal(x1, y1, x2, y2, flags, trav);
+
+  dsda_ProfileBegin(dsda_profile_path_traverse);
+  result = P_PathTraverseInternal(x1, y1, x2, y2, flags, trav);
+  dsda_ProfileEnd(dsda_profile_path_traverse);
+
+  return result;
+}
+
 //
 // RoughBlockCheck
 // [XA] adapted from Hexen -- used by P_RoughTargetSearch
@@ -371,7 +371,7 @@ int EV_DoZDoomPlat(int tag, line_t *line, plattype_e type, fixed_t height,
 
     rtn = 1;
 
-    plat = Z_MallocLevel(sizeof(*plat));
+    plat = P_MallocThinker(sizeof(*plat));
     memset(plat, 0, sizeof(*plat));
     P_AddThinker(&plat->thinker);
 
@@ -510,7 +510,7 @@ int EV_DoPlat
 
     // Create a thinker
     rtn = 1;
-    plat = Z_MallocLevel( sizeof(*plat));
+    plat = P_MallocThinker(sizeof(*plat));
     memset(plat, 0, sizeof(*plat));
     P_AddThinker(&plat->thinker);
 
@@ -833,7 +833,7 @@ int EV_DoHexenPlat(line_t * line, byte * args, plattype_e type, int amount)
         // Find lowest & highest floors around sector
         //
         rtn = 1;
-        plat = Z_MallocLevel(sizeof(*plat));
+        plat = P_MallocThinker(sizeof(*plat));
         memset(plat, 0, sizeof(*plat));
         P_AddThinker(&plat->thinker);
 
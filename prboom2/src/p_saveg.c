@@ -104,6 +104,36 @@ void P_FreeSaveBuffer(void)
   P_ForgetSaveBuffer();
 }
 
+save_mask_t *save_mask;
+int save_mask_count;
+static int save_mask_max;
+static dboolean save_mask_enabled;
+
+void P_RecordSaveMask(dboolean record)
+{
+  save_mask_enabled = record;
+  save_mask_count = 0;
+}
+
+// p points into the save buffer, which may move later, so keep offsets
+void P_MaskSave(const void *p, size_t length)
+{
+  if (!save_mask_enabled)
+    return;
+
+  if (save_mask_count == save_mask_max)
+  {
+    save_mask_max = save_mask_max ? save_mask_max * 2 : 1024;
+    save_mask = Z_Realloc(save_mask, save_mask_max * sizeof(*save_mask));
+  }
+
+  save_mask[save_mask_count].offset = (const byte *) p - savebuffer;
+  save_mask[save_mask_count].length = length;
+  ++save_mask_count;
+}
+
+#define P_MASK_FIELD(ref, field) P_MaskSave(&(ref)->field, sizeof((ref)->field))
+
 //
 // P_ArchivePlayers
 //
@@ -118,6 +148,12 @@ void P_ArchivePlayers (void)
         player_t *dest;
 
         P_SAVE_TYPE_REF(&players[i], dest, player_t);
+        P_MASK_FIELD(dest, mo);
+        P_MASK_FIELD(dest, cmd);
+        P_MASK_FIELD(dest, attacker);
+        P_MASK_FIELD(dest, rain1);
+        P_MASK_FIELD(dest, rain2);
+        P_MASK_FIELD(dest, poisoner);
         for (j=0; j<NUMPSPRITES; j++)
           if (dest->psprites[j].state)
             dest->psprites[j].state =
@@ -359,7 +395,7 @@ void P_UnArchiveWorld (void)
 
 static int number_of_thinkers;
 
-static dboolean P_IsMobjThinker(thinker_t* thinker)
+dboolean P_IsMobjThinker(thinker_t* thinker)
 {
   return thinker->function == P_MobjThinker ||
          thinker->function == P_BlasterMobjThinker ||
@@ -746,13 +782,25 @@ typedef enum {
 
 // dsda - fix save / load synchronization
 // merges P_ArchiveThinkers & P_ArchiveSpecials
+// Every thinker record is a class byte followed by a struct that starts
+// with its thinker_t, whose links are addresses
+static void P_MaskThinkerRecord(size_t record)
+{
+  if ((size_t) (save_p - savebuffer) > record)
+    P_MaskSave(savebuffer + record + 1, sizeof(thinker_t));
+}
+
 void P_ArchiveThinkers(void) {
   thinker_t *th;
+  size_t record = 0;
 
   P_SAVE_X(brain);
 
   // save off the current thinkers
-  for (th = thinkercap.next ; th != &thinkercap ; th=th->next) {
+  for (th = thinkercap.next ; th != &thinkercap ;
+       P_MaskThinkerRecord(record), th=th->next) {
+    record = save_p - savebuffer;
+
     if (!th->function)
     {
       platlist_t *pl;
@@ -1110,6 +1158,12 @@ void P_ArchiveThinkers(void) {
 
       if (mobj->player)
         mobj->player = (player_t *)((mobj->player-players) + 1);
+
+      P_MASK_FIELD(mobj, snext);
+      P_MASK_FIELD(mobj, sprev);
+      P_MASK_FIELD(mobj, bnext);
+      P_MASK_FIELD(mobj, bprev);
+      P_MASK_FIELD(mobj, touching_sectorlist);
     }
   }
 
@@ -1160,7 +1214,7 @@ void P_UnArchiveThinkers(void) {
       P_RemoveThinkerDelayed(th); // fix mobj leak
     }
     else
-      Z_Free (th);
+      P_FreeThinker(th);
     th = next;
   }
   P_InitThinkers ();
@@ -1238,7 +1292,7 @@ void P_UnArchiveThinkers(void) {
     switch (tc) {
       case tc_ceiling:
         {
-          ceiling_t *ceiling = Z_MallocLevel (sizeof(*ceiling));
+          ceiling_t *ceiling = P_MallocThinker(sizeof(*ceiling));
           P_LOAD_P(ceiling);
           ceiling->sector = &sectors[(size_t)ceiling->sector];
           ceiling->sector->ceilingdata = ceiling; //jff 2/22/98
@@ -1253,7 +1307,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_door:
         {
-          vldoor_t *door = Z_MallocLevel (sizeof(*door));
+          vldoor_t *door = P_MallocThinker(sizeof(*door));
           P_LOAD_P(door);
           door->sector = &sectors[(size_t)door->sector];
 
@@ -1268,7 +1322,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_floor:
         {
-          floormove_t *floor = Z_MallocLevel (sizeof(*floor));
+          floormove_t *floor = P_MallocThinker(sizeof(*floor));
           P_LOAD_P(floor);
           floor->sector = &sectors[(size_t)floor->sector];
           floor->sector->floordata = floor; //jff 2/22/98
@@ -1279,7 +1333,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_plat:
         {
-          plat_t *plat = Z_MallocLevel (sizeof(*plat));
+          plat_t *plat = P_MallocThinker(sizeof(*plat));
           P_LOAD_P(plat);
           plat->sector = &sectors[(size_t)plat->sector];
           plat->sector->floordata = plat; //jff 2/22/98
@@ -1294,7 +1348,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_flash:
         {
-          lightflash_t *flash = Z_MallocLevel (sizeof(*flash));
+          lightflash_t *flash = P_MallocThinker(sizeof(*flash));
           P_LOAD_P(flash);
           flash->sector = &sectors[(size_t)flash->sector];
           flash->sector->lightingdata = flash;
@@ -1305,7 +1359,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_strobe:
         {
-          strobe_t *strobe = Z_MallocLevel (sizeof(*strobe));
+          strobe_t *strobe = P_MallocThinker(sizeof(*strobe));
           P_LOAD_P(strobe);
           strobe->sector = &sectors[(size_t)strobe->sector];
           strobe->sector->lightingdata = strobe;
@@ -1316,7 +1370,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_glow:
         {
-          glow_t *glow = Z_MallocLevel (sizeof(*glow));
+          glow_t *glow = P_MallocThinker(sizeof(*glow));
           P_LOAD_P(glow);
           glow->sector = &sectors[(size_t)glow->sector];
           glow->sector->lightingdata = glow;
@@ -1327,7 +1381,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_zdoom_glow:
         {
-          zdoom_glow_t *glow = Z_MallocLevel (sizeof(*glow));
+          zdoom_glow_t *glow = P_MallocThinker(sizeof(*glow));
           P_LOAD_P(glow);
           glow->sector = &sectors[(size_t)glow->sector];
           glow->sector->lightingdata = glow;
@@ -1338,7 +1392,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_flicker:           // killough 10/4/98
         {
-          fireflicker_t *flicker = Z_MallocLevel (sizeof(*flicker));
+          fireflicker_t *flicker = P_MallocThinker(sizeof(*flicker));
           P_LOAD_P(flicker);
           flicker->sector = &sectors[(size_t)flicker->sector];
           flicker->sector->lightingdata = flicker;
@@ -1349,7 +1403,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_zdoom_flicker:
         {
-          zdoom_flicker_t *flicker = Z_MallocLevel (sizeof(*flicker));
+          zdoom_flicker_t *flicker = P_MallocThinker(sizeof(*flicker));
           P_LOAD_P(flicker);
           flicker->sector = &sectors[(size_t)flicker->sector];
           flicker->sector->lightingdata = flicker;
@@ -1361,7 +1415,7 @@ void P_UnArchiveThinkers(void) {
         //jff 2/22/98 new case for elevators
       case tc_elevator:
         {
-          elevator_t *elevator = Z_MallocLevel (sizeof(*elevator));
+          elevator_t *elevator = P_MallocThinker(sizeof(*elevator));
           P_LOAD_P(elevator);
           elevator->sector = &sectors[(size_t)elevator->sector];
           elevator->sector->floordata = elevator; //jff 2/22/98
@@ -1373,7 +1427,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_scroll_side:
         {
-          scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->thinker.function = dsda_UpdateSideScroller;
           P_AddThinker(&scroll->thinker);
@@ -1382,7 +1436,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_scroll_floor:
         {
-          scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->thinker.function = dsda_UpdateFloorScroller;
           P_AddThinker(&scroll->thinker);
@@ -1391,7 +1445,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_scroll_ceiling:
         {
-          scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->thinker.function = dsda_UpdateCeilingScroller;
           P_AddThinker(&scroll->thinker);
@@ -1400,7 +1454,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_scroll_floor_carry:
         {
-          scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->thinker.function = dsda_UpdateFloorCarryScroller;
           P_AddThinker(&scroll->thinker);
@@ -1409,7 +1463,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_zdoom_scroll_floor:
         {
-          scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->thinker.function = dsda_UpdateZDoomFloorScroller;
           P_AddThinker(&scroll->thinker);
@@ -1418,7 +1472,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_zdoom_scroll_ceiling:
         {
-          scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->thinker.function = dsda_UpdateZDoomCeilingScroller;
           P_AddThinker(&scroll->thinker);
@@ -1427,7 +1481,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_thrust:
         {
-          scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->thinker.function = dsda_UpdateThruster;
           P_AddThinker(&scroll->thinker);
@@ -1436,7 +1490,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_scroll_side_control:
         {
-          control_scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          control_scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->scroll.thinker.function = dsda_UpdateControlSideScroller;
           P_AddThinker(&scroll->scroll.thinker);
@@ -1445,7 +1499,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_scroll_floor_control:
         {
-          control_scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          control_scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->scroll.thinker.function = dsda_UpdateControlFloorScroller;
           P_AddThinker(&scroll->scroll.thinker);
@@ -1454,7 +1508,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_scroll_ceiling_control:
         {
-          control_scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          control_scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->scroll.thinker.function = dsda_UpdateControlCeilingScroller;
           P_AddThinker(&scroll->scroll.thinker);
@@ -1463,7 +1517,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_scroll_floor_carry_control:
         {
-          control_scroll_t *scroll = Z_MallocLevel (sizeof(*scroll));
+          control_scroll_t *scroll = P_MallocThinker(sizeof(*scroll));
           P_LOAD_P(scroll);
           scroll->scroll.thinker.function = dsda_UpdateControlFloorCarryScroller;
           P_AddThinker(&scroll->scroll.thinker);
@@ -1472,7 +1526,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_pusher:   // phares 3/22/98: new Push/Pull effect thinkers
         {
-          pusher_t *pusher = Z_MallocLevel (sizeof(pusher_t));
+          pusher_t *pusher = P_MallocThinker(sizeof(pusher_t));
           P_LOAD_P(pusher);
           pusher->thinker.function = T_Pusher;
           pusher->source = P_GetPushThing(pusher->affectee);
@@ -1482,7 +1536,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_friction:
         {
-          friction_t *friction = Z_MallocLevel (sizeof(friction_t));
+          friction_t *friction = P_MallocThinker(sizeof(friction_t));
           P_LOAD_P(friction);
           friction->thinker.function = T_Friction;
           P_AddThinker(&friction->thinker);
@@ -1491,7 +1545,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_light:
         {
-          light_t *light = Z_MallocLevel(sizeof(*light));
+          light_t *light = P_MallocThinker(sizeof(*light));
           P_LOAD_P(light);
           light->sector = &sectors[(size_t)light->sector];
           light->thinker.function = T_Light;
@@ -1501,7 +1555,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_phase:
         {
-          phase_t *phase = Z_MallocLevel(sizeof(*phase));
+          phase_t *phase = P_MallocThinker(sizeof(*phase));
           P_LOAD_P(phase);
           phase->sector = &sectors[(size_t)phase->sector];
           phase->sector->lightingdata = phase;
@@ -1512,7 +1566,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_acs:
         {
-          acs_t *acs = Z_MallocLevel(sizeof(*acs));
+          acs_t *acs = P_MallocThinker(sizeof(*acs));
           P_LOAD_P(acs);
           acs->line = (intptr_t) acs->line != -1 ? &lines[(size_t) acs->line] : NULL;
           acs->thinker.function = T_InterpretACS;
@@ -1522,7 +1576,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_pillar:
         {
-          pillar_t *pillar = Z_MallocLevel(sizeof(*pillar));
+          pillar_t *pillar = P_MallocThinker(sizeof(*pillar));
           P_LOAD_P(pillar);
           pillar->sector = &sectors[(size_t)pillar->sector];
           pillar->sector->floordata = pillar;
@@ -1533,7 +1587,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_floor_waggle:
         {
-          planeWaggle_t *waggle = Z_MallocLevel(sizeof(*waggle));
+          planeWaggle_t *waggle = P_MallocThinker(sizeof(*waggle));
           P_LOAD_P(waggle);
           waggle->sector = &sectors[(size_t)waggle->sector];
           waggle->sector->floordata = waggle;
@@ -1544,7 +1598,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_ceiling_waggle:
         {
-          planeWaggle_t *waggle = Z_MallocLevel(sizeof(*waggle));
+          planeWaggle_t *waggle = P_MallocThinker(sizeof(*waggle));
           P_LOAD_P(waggle);
           waggle->sector = &sectors[(size_t)waggle->sector];
           waggle->sector->floordata = waggle;
@@ -1555,7 +1609,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_poly_rotate:
         {
-          polyevent_t *poly = Z_MallocLevel(sizeof(*poly));
+          polyevent_t *poly = P_MallocThinker(sizeof(*poly));
           P_LOAD_P(poly);
           poly->thinker.function = T_RotatePoly;
           P_AddThinker(&poly->thinker);
@@ -1564,7 +1618,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_poly_move:
         {
-          polyevent_t *poly = Z_MallocLevel(sizeof(*poly));
+          polyevent_t *poly = P_MallocThinker(sizeof(*poly));
           P_LOAD_P(poly);
           poly->thinker.function = T_MovePoly;
           P_AddThinker(&poly->thinker);
@@ -1573,7 +1627,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_poly_door:
         {
-          polydoor_t *poly = Z_MallocLevel(sizeof(*poly));
+          polydoor_t *poly = P_MallocThinker(sizeof(*poly));
           P_LOAD_P(poly);
           poly->thinker.function = T_PolyDoor;
           P_AddThinker(&poly->thinker);
@@ -1582,7 +1636,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_quake:
         {
-          quake_t *quake = Z_MallocLevel(sizeof(*quake));
+          quake_t *quake = P_MallocThinker(sizeof(*quake));
           P_LOAD_P(quake);
           quake->thinker.function = dsda_UpdateQuake;
           P_AddThinker(&quake->thinker);
@@ -1591,7 +1645,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_ambient_source:
         {
-          ambient_source_t *ambient_source = Z_MallocLevel(sizeof(*ambient_source));
+          ambient_source_t *ambient_source = P_MallocThinker(sizeof(*ambient_source));
           P_LOAD_P(ambient_source);
           ambient_source->thinker.function = dsda_UpdateAmbientSource;
           P_AddThinker(&ambient_source->thinker);
@@ -1600,7 +1654,7 @@ void P_UnArchiveThinkers(void) {
 
       case tc_mobj:
         {
-          mobj_t *mobj = Z_MallocLevel(sizeof(mobj_t));
+          mobj_t *mobj = P_MallocThinker(sizeof(mobj_t));
 
           // killough 2/14/98 -- insert pointers to thinkers into table, in order:
           mobj_count++;
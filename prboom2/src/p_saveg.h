@@ -34,6 +34,7 @@
 #ifndef __P_SAVEG__
 #define __P_SAVEG__
 
+#include "d_think.h"
 #include "doomtype.h"
 
 #define SAVEVERSION 5
@@ -46,6 +47,7 @@ void P_ArchiveWorld(void);
 void P_UnArchiveWorld(void);
 void P_ThinkerToIndex(void); /* phares 9/13/98: save soundtarget in savegame */
 void P_IndexToThinker(void); /* phares 9/13/98: save soundtarget in savegame */
+dboolean P_IsMobjThinker(thinker_t* thinker);
 
 /* 1/18/98 killough: add RNG info to savegame */
 void P_ArchiveRNG(void);
@@ -67,6 +69,20 @@ void P_InitSaveBuffer(void);
 void P_ForgetSaveBuffer(void);
 void P_FreeSaveBuffer(void);
 
+// Byte ranges of the save buffer holding addresses or player input
+// instead of game state, recorded while P_RecordSaveMask is on
+typedef struct
+{
+  size_t offset;
+  size_t length;
+} save_mask_t;
+
+extern save_mask_t *save_mask;
+extern int save_mask_count;
+
+void P_RecordSaveMask(dboolean record);
+void P_MaskSave(const void *p, size_t length);
+
 #define P_SAVE_X(x) { CheckSaveGame(sizeof(x)); \
                       memcpy(save_p, &x, sizeof(x)); \
                       save_p += sizeof(x); }
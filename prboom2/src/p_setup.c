@@ -60,16 +60,19 @@
 
 #include "dsda.h"
 #include "dsda/args.h"
+#include "dsda/benchmark.h"
 #include "dsda/compatibility.h"
 #include "dsda/destructible.h"
 #include "dsda/id_list.h"
 #include "dsda/line_special.h"
 #include "dsda/map_format.h"
 #include "dsda/mapinfo.h"
+#include "dsda/parallel.h"
 #include "dsda/preferences.h"
 #include "dsda/scroll.h"
 #include "dsda/settings.h"
 #include "dsda/skip.h"
+#include "dsda/startup_profile.h"
 #include "dsda/tranmap.h"
 #include "dsda/udmf.h"
 #include "dsda/utility.h"
@@ -2680,11 +2683,26 @@ static void P_LoadUDMFSideDefs(int lump)
                                  // jff 10/8/98 use guardband>0
                                  // jff 10/12/98 0 ok with + 1 in rows,cols
 
-typedef struct linelist_t        // type used to list lines in each block
+// Lines are split into ranges built in parallel, each range keeping
+// its own block and line pairs, which are merged once all are done.
+
+typedef struct
 {
-  long num;
-  struct linelist_t *next;
-} linelist_t;
+  int first_line;                // range of lines handled
+  int last_line;
+  int *done;                     // last line added to each block
+  int *entries;                  // block and line pairs, in line order
+  int count;
+  int size;
+  dboolean overflow;             // out of memory, checked on the main thread
+} blockmap_part_t;
+
+typedef struct
+{
+  int xorg,yorg;                 // blockmap origin (lower left)
+  int nrows,ncols;               // blockmap dimensions
+  blockmap_part_t *parts;
+} blockmap_build_t;
 
 //
 // Subroutine to add a line number to a block list
@@ -2693,24 +2711,35 @@ typedef struct linelist_t        // type used to list lines in each block
 
 static void AddBlockLine
 (
-  linelist_t **lists,
-  int *count,
-  int *done,
+  blockmap_part_t *part,
   int blockno,
-  long lineno
+  int lineno
 )
 {
-  linelist_t *l;
-
-  if (done[blockno])
+  if (part->done[blockno] == lineno || part->overflow)
     return;
 
-  l = Z_Malloc(sizeof(linelist_t));
-  l->num = lineno;
-  l->next = lists[blockno];
-  lists[blockno] = l;
-  count[blockno]++;
-  done[blockno] = 1;
+  // runs on worker threads, so no zone memory
+  if (part->count == part->size)
+  {
+    int *entries;
+    int size = part->size ? part->size * 2 : 1024;
+
+    entries = realloc(part->entries, size * 2 * sizeof(*entries));
+    if (!entries)
+    {
+      part->overflow = true;
+      return;
+    }
+
+    part->entries = entries;
+    part->size = size;
+  }
+
+  part->entries[2 * part->count] = blockno;
+  part->entries[2 * part->count + 1] = lineno;
+  part->count++;
+  part->done[blockno] = lineno;
 }
 
 blockmap_t original_blockmap;
@@ -2732,88 +2761,27 @@ void P_RestoreOriginalBlockMap(void)
 }
 
 //
-// Actually construct the blockmap lump from the level data
+// Find the blocks touched by a range of lines
 //
 // This finds the intersection of each linedef with the column and
 // row lines at the left and bottom of each blockmap cell. It then
 // adds the line to all block lists touching the intersection.
 //
 
-static void P_CreateBlockMap(void)
+static void P_BuildBlockMapPart(int index, void *data)
 {
-  int xorg,yorg;                 // blockmap origin (lower left)
-  int nrows,ncols;               // blockmap dimensions
-  linelist_t **blocklists=NULL;  // array of pointers to lists of lines
-  int *blockcount=NULL;          // array of counters of line lists
-  int *blockdone=NULL;           // array keeping track of blocks/line
-  int NBlocks;                   // number of cells = nrows*ncols
-  long linetotal=0;              // total length of all blocklists
+  blockmap_build_t *build = data;
+  blockmap_part_t *part = &build->parts[index];
+  int xorg = build->xorg;
+  int yorg = build->yorg;
+  int ncols = build->ncols;
+  int nrows = build->nrows;
   int i,j;
-  int map_minx=INT_MAX;          // init for map limits search
-  int map_miny=INT_MAX;
-  int map_maxx=INT_MIN;
-  int map_maxy=INT_MIN;
-
-  // scan for map limits, which the blockmap must enclose
-
-  // This fixes MBF's code, which has a bug where maxx/maxy
-  // are wrong if the 0th node has the largest x or y
-  if (numvertexes)
-  {
-    map_minx = map_maxx = vertexes[0].x;
-    map_miny = map_maxy = vertexes[0].y;
-  }
-
-  for (i=0;i<numvertexes;i++)
-  {
-    fixed_t t;
-
-    if ((t=vertexes[i].x) < map_minx)
-      map_minx = t;
-    else if (t > map_maxx)
-      map_maxx = t;
-    if ((t=vertexes[i].y) < map_miny)
-      map_miny = t;
-    else if (t > map_maxy)
-      map_maxy = t;
-  }
-  map_minx >>= FRACBITS;    // work in map coords, not fixed_t
-  map_maxx >>= FRACBITS;
-  map_miny >>= FRACBITS;
-  map_maxy >>= FRACBITS;
-
-  // set up blockmap area to enclose level plus margin
-
-  xorg = map_minx-blkmargin;
-  yorg = map_miny-blkmargin;
-  ncols = (map_maxx+blkmargin-xorg+1+blkmask)>>blkshift;  //jff 10/12/98
-  nrows = (map_maxy+blkmargin-yorg+1+blkmask)>>blkshift;  //+1 needed for
-  NBlocks = ncols*nrows;                                  //map exactly 1 cell
-
-  // create the array of pointers on NBlocks to blocklists
-  // also create an array of linelist counts on NBlocks
-  // finally make an array in which we can mark blocks done per line
-
-  // CPhipps - calloc's
-  blocklists = Z_Calloc(NBlocks,sizeof(linelist_t *));
-  blockcount = Z_Calloc(NBlocks,sizeof(int));
-  blockdone = Z_Malloc(NBlocks*sizeof(int));
-
-  // initialize each blocklist, and enter the trailing -1 in all blocklists
-  // note the linked list of lines grows backwards
-
-  for (i=0;i<NBlocks;i++)
-  {
-    blocklists[i] = Z_Malloc(sizeof(linelist_t));
-    blocklists[i]->num = -1;
-    blocklists[i]->next = NULL;
-    blockcount[i]++;
-  }
 
   // For each linedef in the wad, determine all blockmap blocks it touches,
   // and add the linedef number to the blocklists for those blocks
 
-  for (i=0;i<numlines;i++)
+  for (i=part->first_line;i<part->last_line;i++)
   {
     int x1 = lines[i].v1->x>>FRACBITS;         // lines[i] map coords
     int y1 = lines[i].v1->y>>FRACBITS;
@@ -2831,18 +2799,14 @@ static void P_CreateBlockMap(void)
     int miny = y1>y2? y2 : y1;
     int maxy = y1>y2? y1 : y2;
 
-    // no blocks done for this linedef yet
-
-    memset(blockdone,0,NBlocks*sizeof(int));
-
     // The line always belongs to the blocks containing its endpoints
 
     bx = (x1-xorg)>>blkshift;
     by = (y1-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
+    AddBlockLine(part,by*ncols+bx,i);
     bx = (x2-xorg)>>blkshift;
     by = (y2-yorg)>>blkshift;
-    AddBlockLine(blocklists,blockcount,blockdone,by*ncols+bx,i);
+    AddBlockLine(part,by*ncols+bx,i);
 
 
     // For each column, see where the line along its left edge, which
@@ -2870,7 +2834,7 @@ static void P_CreateBlockMap(void)
 
         // The cell that contains the intersection point is always added
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j,i);
+        AddBlockLine(part,ncols*yb+j,i);
 
         // if the intersection is at a corner it depends on the slope
         // (and whether the line extends past the intersection) which
@@ -2881,23 +2845,23 @@ static void P_CreateBlockMap(void)
           if (sneg)       //   \ - blocks x,y-, x-,y
           {
             if (yb>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j,i);
+              AddBlockLine(part,ncols*(yb-1)+j,i);
             if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+              AddBlockLine(part,ncols*yb+j-1,i);
           }
           else if (spos)  //   / - block x-,y-
           {
             if (yb>0 && j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(yb-1)+j-1,i);
+              AddBlockLine(part,ncols*(yb-1)+j-1,i);
           }
           else if (horiz) //   - - block x-,y
           {
             if (j>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+              AddBlockLine(part,ncols*yb+j-1,i);
           }
         }
         else if (j>0 && minx<x) // else not at corner: x-,y
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*yb+j-1,i);
+          AddBlockLine(part,ncols*yb+j-1,i);
       }
     }
 
@@ -2926,7 +2890,7 @@ static void P_CreateBlockMap(void)
 
         // The cell that contains the intersection point is always added
 
-        AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb,i);
+        AddBlockLine(part,ncols*j+xb,i);
 
         // if the intersection is at a corner it depends on the slope
         // (and whether the line extends past the intersection) which
@@ -2937,72 +2901,160 @@ static void P_CreateBlockMap(void)
           if (sneg)       //   \ - blocks x,y-, x-,y
           {
             if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+              AddBlockLine(part,ncols*(j-1)+xb,i);
             if (xb>0 && minx<x)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*j+xb-1,i);
+              AddBlockLine(part,ncols*j+xb-1,i);
           }
           else if (vert)  //   | - block x,y-
           {
             if (j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+              AddBlockLine(part,ncols*(j-1)+xb,i);
           }
           else if (spos)  //   / - block x-,y-
           {
             if (xb>0 && j>0 && miny<y)
-              AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb-1,i);
+              AddBlockLine(part,ncols*(j-1)+xb-1,i);
           }
         }
         else if (j>0 && miny<y) // else not on a corner: x,y-
-          AddBlockLine(blocklists,blockcount,blockdone,ncols*(j-1)+xb,i);
+          AddBlockLine(part,ncols*(j-1)+xb,i);
       }
     }
   }
+}
+
+//
+// Actually construct the blockmap lump from the level data
+//
+
+static void P_CreateBlockMap(void)
+{
+  blockmap_build_t build;
+  int *blockpos=NULL;            // array of write positions in block lists
+  int NBlocks;                   // number of cells = nrows*ncols
+  int part_count;
+  long linetotal=0;              // total length of all blocklists
+  long offs;
+  int i,j;
+  int map_minx=INT_MAX;          // init for map limits search
+  int map_miny=INT_MAX;
+  int map_maxx=INT_MIN;
+  int map_maxy=INT_MIN;
+
+  // scan for map limits, which the blockmap must enclose
+
+  // This fixes MBF's code, which has a bug where maxx/maxy
+  // are wrong if the 0th node has the largest x or y
+  if (numvertexes)
+  {
+    map_minx = map_maxx = vertexes[0].x;
+    map_miny = map_maxy = vertexes[0].y;
+  }
+
+  for (i=0;i<numvertexes;i++)
+  {
+    fixed_t t;
+
+    if ((t=vertexes[i].x) < map_minx)
+      map_minx = t;
+    else if (t > map_maxx)
+      map_maxx = t;
+    if ((t=vertexes[i].y) < map_miny)
+      map_miny = t;
+    else if (t > map_maxy)
+      map_maxy = t;
+  }
+  map_minx >>= FRACBITS;    // work in map coords, not fixed_t
+  map_maxx >>= FRACBITS;
+  map_miny >>= FRACBITS;
+  map_maxy >>= FRACBITS;
+
+  // set up blockmap area to enclose level plus margin
+
+  build.xorg = map_minx-blkmargin;
+  build.yorg = map_miny-blkmargin;
+  build.ncols = (map_maxx+blkmargin-build.xorg+1+blkmask)>>blkshift;  //jff 10/12/98
+  build.nrows = (map_maxy+blkmargin-build.yorg+1+blkmask)>>blkshift;  //+1 needed for
+  NBlocks = build.ncols*build.nrows;                                  //map exactly 1 cell
+
+  // one range of lines per thread, within a budget for the done arrays
+  part_count = MIN(dsda_ParallelThreadCount(), numlines);
+  part_count = MIN(part_count, MAX(1, (64 << 20) / (NBlocks * (int) sizeof(int))));
+
+  build.parts = Z_Calloc(part_count, sizeof(*build.parts));
+
+  for (i=0;i<part_count;i++)
+  {
+    blockmap_part_t *part = &build.parts[i];
+
+    part->first_line = (long long) numlines * i / part_count;
+    part->last_line = (long long) numlines * (i + 1) / part_count;
+    part->done = Z_Malloc(NBlocks*sizeof(int));
+    memset(part->done,-1,NBlocks*sizeof(int));
+  }
 
-  // Add initial 0 to all blocklists
-  // count the total number of lines (and 0's and -1's)
+  dsda_ParallelFor(part_count, P_BuildBlockMapPart, &build);
 
-  memset(blockdone,0,NBlocks*sizeof(int));
-  for (i=0,linetotal=0;i<NBlocks;i++)
+  // count the lines in each block, plus the initial 0 and trailing -1
+
+  blockpos = Z_Calloc(NBlocks,sizeof(int));
+
+  for (i=0;i<part_count;i++)
   {
-    AddBlockLine(blocklists,blockcount,blockdone,i,0);
-    linetotal += blockcount[i];
+    blockmap_part_t *part = &build.parts[i];
+
+    if (part->overflow)
+      I_Error("P_CreateBlockMap: out of memory");
+
+    for (j=0;j<part->count;j++)
+      blockpos[part->entries[2*j]]++;
   }
 
+  for (i=0;i<NBlocks;i++)
+    linetotal += blockpos[i] + 2;
+
   // Create the blockmap lump
 
   blockmaplump = malloc_IfSameLevel(blockmaplump, sizeof(*blockmaplump) * (4 + NBlocks + linetotal));
   // blockmap header
 
-  blockmaplump[0] = bmaporgx = xorg << FRACBITS;
-  blockmaplump[1] = bmaporgy = yorg << FRACBITS;
-  blockmaplump[2] = bmapwidth  = ncols;
-  blockmaplump[3] = bmapheight = nrows;
+  blockmaplump[0] = bmaporgx = build.xorg << FRACBITS;
+  blockmaplump[1] = bmaporgy = build.yorg << FRACBITS;
+  blockmaplump[2] = bmapwidth  = build.ncols;
+  blockmaplump[3] = bmapheight = build.nrows;
 
-  // offsets to lists and block lists
+  // offsets to lists, and the 0 and -1 framing each list
 
+  offs = 4+NBlocks;
   for (i=0;i<NBlocks;i++)
   {
-    linelist_t *bl = blocklists[i];
-    long offs = blockmaplump[4+i] =   // set offset to block's list
-      (i? blockmaplump[4+i-1] : 4+NBlocks) + (i? blockcount[i-1] : 0);
+    blockmaplump[4+i] = offs;         // set offset to block's list
+    blockmaplump[offs] = 0;
+    blockmaplump[offs+1+blockpos[i]] = -1;
 
-    // add the lines in each block's list to the blockmaplump
-    // delete each list node as we go
+    j = blockpos[i];
+    blockpos[i] = offs+1;
+    offs += j + 2;
+  }
 
-    while (bl)
-    {
-      linelist_t *tmp = bl->next;
-      blockmaplump[offs++] = bl->num;
-      Z_Free(bl);
-      bl = tmp;
-    }
+  // fill in the lists, each in descending line order as the original
+  // linked lists were built
+
+  for (i=part_count-1;i>=0;i--)
+  {
+    blockmap_part_t *part = &build.parts[i];
+
+    for (j=part->count-1;j>=0;j--)
+      blockmaplump[blockpos[part->entries[2*j]]++] = part->entries[2*j+1];
+
+    Z_Free(part->done);
+    free(part->entries);
   }
 
   // free all temporary storage
 
-  Z_Free (blocklists);
-  Z_Free (blockcount);
-  Z_Free (blockdone);
+  Z_Free (build.parts);
+  Z_Free (blockpos);
 }
 
 // jff 10/6/98
@@ -3283,6 +3335,8 @@ static int P_GroupLines (void)
     sector->blockbox[BOXLEFT]=block;
   }
 
+  P_InitSoundGraph();
+
   return total; // this value is needed by the reject overrun emulation code
 }
 
@@ -3290,11 +3344,165 @@ static int P_GroupLines (void)
 // P_LoadReject - load the reject table
 //
 
+// A reject table built at load time can only say that sectors no chain
+// of two-sided lines connects will never see each other. That matches the
+// BSP sight check only while every sector is closed; on maps with unclosed
+// or broken sectors it rejects pairs the full check would accept, which
+// changes game behaviour. It is therefore only built when asked for with
+// -reject, and never while a demo is recorded or played back.
+
+typedef struct
+{
+  const int *group;              // connected group of each sector
+  byte *reject;
+  unsigned int length;
+  int part_count;
+} reject_build_t;
+
+static int P_RejectGroup(int *group, int sector)
+{
+  while (group[sector] != sector)
+    sector = group[sector] = group[group[sector]];
+
+  return sector;
+}
+
+static void P_JoinRejectGroups(int *group, const sector_t *s1, const sector_t *s2)
+{
+  int g1, g2;
+
+  if (!s1 || !s2)
+    return;
+
+  g1 = P_RejectGroup(group, s1->iSectorID);
+  g2 = P_RejectGroup(group, s2->iSectorID);
+
+  if (g1 < g2)
+    group[g2] = g1;
+  else
+    group[g1] = g2;
+}
+
+// Parts cover whole bytes, as rows needn't start on one
+static void P_BuildRejectPart(int index, void *data)
+{
+  reject_build_t *build = data;
+  unsigned int first = (unsigned long long) build->length * index / build->part_count;
+  unsigned int last = (unsigned long long) build->length * (index + 1) / build->part_count;
+  unsigned int i;
+  int bit;
+  int s1, s2;
+
+  s1 = (int) ((unsigned long long) first * 8 / numsectors);
+  s2 = (int) ((unsigned long long) first * 8 % numsectors);
+
+  for (i = first; i < last; i++)
+  {
+    byte value = 0;
+
+    for (bit = 0; bit < 8 && s1 < numsectors; bit++)
+    {
+      if (build->group[s1] != build->group[s2])
+        value |= 1 << bit;
+
+      if (++s2 == numsectors)
+      {
+        s2 = 0;
+        s1++;
+      }
+    }
+
+    build->reject[i] = value;
+  }
+}
+
+static const byte *P_BuildReject(void)
+{
+  reject_build_t build;
+  int *group;
+  int i, count;
+
+  group = Z_Malloc(numsectors * sizeof(*group));
+
+  for (i = 0; i < numsectors; i++)
+    group[i] = i;
+
+  for (i = 0; i < numlines; i++)
+    P_JoinRejectGroups(group, lines[i].frontsector, lines[i].backsector);
+
+  // the sight check goes by the segs
+  for (i = 0; i < numsegs; i++)
+    if (segs[i].linedef && segs[i].linedef->flags & ML_TWOSIDED)
+      P_JoinRejectGroups(group, segs[i].frontsector, segs[i].backsector);
+
+  for (count = 0, i = 0; i < numsectors; i++)
+    if (P_RejectGroup(group, i) == i)
+      count++;
+
+  build.group = group;
+  build.length = (numsectors * numsectors + 7) / 8;
+  build.reject = Z_MallocLevel(build.length);
+
+  if (count == 1)
+    memset(build.reject, 0, build.length);
+  else
+  {
+    build.part_count = MIN(dsda_ParallelThreadCount() * 4, build.length);
+    dsda_ParallelFor(build.part_count, P_BuildRejectPart, &build);
+  }
+
+  lprintf(LO_DEBUG, "P_BuildReject: %d sectors in %d groups\n", numsectors, count);
+
+  Z_Free(group);
+
+  return build.reject;
+}
+
+static dboolean P_ShouldBuildReject(int lump, unsigned int length)
+{
+  unsigned int i;
+  unsigned int required;
+  const byte *data;
+
+  required = (numsectors * numsectors + 7) / 8;
+
+  if (!required || !dsda_Flag(dsda_arg_reject))
+    return false;
+
+  // Sight results are part of demo sync
+  if (!allow_incompatibility)
+    return false;
+
+  // A missing lump has nothing to lose
+  if (!length)
+    return true;
+
+  // A short lump still holds real reject bits; keep it and its padding
+  if (length < required)
+    return false;
+
+  // Node builders often write a table of zeroes
+  data = W_LumpByNum(lump);
+  for (i = 0; i < required; i++)
+    if (data[i])
+      return false;
+
+  return true;
+}
+
 static void P_LoadReject(int lump)
 {
   unsigned int length;
 
   length = W_SafeLumpLength(lump);
+
+  if (P_ShouldBuildReject(lump, length))
+  {
+    rejectmatrix = P_BuildReject();
+    P_GroupLines();
+    return;
+  }
+
   rejectmatrix = W_SafeLumpByNum(lump);
 
   //e6y: check for overflow
@@ -3798,10 +4006,17 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   char  gl_lumpname[9];
   int   gl_lumpnum;
 
+  dsda_StartupPhaseBegin(dsda_startup_level);
+
   //e6y
   totallive = 0;
 
+  dsda_StartupPhaseBegin(dsda_startup_tranmap);
   main_tranmap = dsda_DefaultTranMap();
+  dsda_StartupPhaseEnd(dsda_startup_tranmap);
+
+  // Line translucency maps are generated together once the level is loaded
+  dsda_BeginTranMapBatch();
 
   dsda_WatchBeforeLevelSetup();
 
@@ -3822,6 +4037,9 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   S_Start();
 
   Z_FreeLevel();
+  P_FreeThinkerSlabs();
+
+  dsda_BenchmarkLevelUnloaded();
 
   P_InitThinkers();
 
@@ -4077,6 +4295,8 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
 
   dsda_ApplyFadeTable();
 
+  dsda_EndTranMapBatch();
+
   // preload graphics
   R_PrecacheLevel();
 
@@ -4108,6 +4328,8 @@ void P_SetupLevel(int episode, int map, int playermask, int skill)
   {
     AM_Start(false);
   }
+
+  dsda_StartupPhaseEnd(dsda_startup_level);
 }
 
 //
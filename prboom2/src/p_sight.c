@@ -42,7 +42,9 @@
 #include "g_overflow.h"
 #include "e6y.h" //e6y
 
+#include "dsda/args.h"
 #include "dsda/map_format.h"
+#include "dsda/profiler.h"
 
 /*
 ==============================================================================
@@ -901,7 +903,7 @@ static dboolean P_CrossBSPNode(int bspnum)
 //
 // killough 4/20/98: cleaned up, made to use new LOS struct
 
-dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
+static dboolean P_CheckSightInternal(mobj_t *t1, mobj_t *t2)
 {
   const sector_t *s1, *s2;
   int pnum;
@@ -988,6 +990,104 @@ dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
   return P_CrossBSPNode(numnodes-1);
 }
 
+//
+// Sight check cache
+//
+// A sight check depends only on the positions and heights of the two
+// mobjs and on the map geometry, so results are reused until anything
+// that can block sight changes, and never past the end of the tic.
+// The validcount bump of a full check is replayed on a hit so that
+// later traversals see the same sequence.
+//
+
+#define SIGHT_CACHE_SIZE 4096
+
+typedef struct
+{
+  unsigned int generation;
+  fixed_t x1, y1, z1, height1;
+  fixed_t x2, y2, z2, height2;
+  subsector_t *subsector1, *subsector2;
+  dboolean result;
+  dboolean traversed;   // the full check bumped validcount
+} sight_cache_entry_t;
+
+static sight_cache_entry_t sight_cache[SIGHT_CACHE_SIZE];
+static unsigned int sight_cache_generation = 1;
+
+void P_InvalidateSightCache(void)
+{
+  if (!++sight_cache_generation)
+  {
+    memset(sight_cache, 0, sizeof(sight_cache));
+    sight_cache_generation = 1;
+  }
+}
+
+static dboolean P_CheckSightCached(mobj_t *t1, mobj_t *t2)
+{
+  sight_cache_entry_t *entry;
+  unsigned int hash;
+  int old_validcount;
+
+  // the blockmap traversal keeps its own state
+  if (compatibility_level == doom_12_compatibility || dsda_Flag(dsda_arg_no_sight_cache))
+    return P_CheckSightInternal(t1, t2);
+
+  hash = (unsigned int) t1->x * 0x9e3779b1u ^ (unsigned int) t1->y * 0x85ebca77u ^
+         (unsigned int) t2->x * 0xc2b2ae3du ^ (unsigned int) t2->y * 0x27d4eb2fu ^
+         (unsigned int) t1->z * 0x165667b1u ^ (unsigned int) t2->z;
+  entry = &sight_cache[(hash ^ (hash >> 16)) & (SIGHT_CACHE_SIZE - 1)];
+
+  if (entry->generation == sight_cache_generation &&
+      entry->x1 == t1->x && entry->y1 == t1->y &&
+      entry->z1 == t1->z && entry->height1 == t1->height &&
+      entry->x2 == t2->x && entry->y2 == t2->y &&
+      entry->z2 == t2->z && entry->height2 == t2->height &&
+      entry->subsector1 == t1->subsector && entry->subsector2 == t2->subsector)
+  {
+    if (entry->traversed)
+      validcount++;
+
+    return entry->result;
+  }
+
+  old_validcount = validcount;
+
+  DSDA_PROFILE_BEGIN(dsda_profile_sight_uncached);
+  entry->result = P_CheckSightInternal(t1, t2);
+  DSDA_PROFILE_END(dsda_profile_sight_uncached);
+
+  entry->generation = sight_cache_generation;
+  entry->x1 = t1->x;
+  entry->y1 = t1->y;
+  entry->z1 = t1->z;
+  entry->height1 = t1->height;
+  entry->x2 = t2->x;
+  entry->y2 = t2->y;
+  entry->z2 = t2->z;
+  entry->height2 = t2->height;
+  entry->subsector1 = t1->subsector;
+  entry->subsector2 = t2->subsector;
+  entry->traversed = validcount != old_validcount;
+
+  return entry->result;
+}
+
+dboolean P_CheckSight(mobj_t *t1, mobj_t *t2)
+{
+  dboolean result;
+
+  if (!dsda_profiling)
+    return P_CheckSightCached(t1, t2);
+
+  dsda_ProfileBegin(dsda_profile_sight);
+  result = P_CheckSightCached(t1, t2);
+  dsda_ProfileEnd(dsda_profile_sight);
+
+  return result;
+}
+
 //
 // P_CheckFov
 // Returns true if t2 is within t1's field of view.
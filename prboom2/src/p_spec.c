@@ -4002,7 +4002,7 @@ static void P_SpawnScrollers(void)
 
 static void Add_Friction(int friction, int movefactor, int affectee)
 {
-    friction_t *f = Z_MallocLevel(sizeof *f);
+    friction_t *f = P_MallocThinker(sizeof *f);
 
     f->thinker.function/*.acp1*/ = /*(actionf_p1) */T_Friction;
     f->friction = friction;
@@ -4280,7 +4280,7 @@ static void P_SpawnFriction(void)
 
 static void Add_Pusher(int type, int x_mag, int y_mag, mobj_t* source, int affectee)
 {
-    pusher_t *p = Z_MallocLevel(sizeof *p);
+    pusher_t *p = P_MallocThinker(sizeof *p);
 
     p->thinker.function = T_Pusher;
     p->source = source;
@@ -6487,6 +6487,10 @@ dboolean P_ExecuteZDoomLineSpecial(int special, int * args, line_t * line, int s
           lines[*id_p].flags = (lines[*id_p].flags & ~clearflags) | setflags;
         }
 
+        // P_CrossSubsector reads these
+        if ((setflags | clearflags) & (ML_BLOCKSIGHT | ML_BLOCKEVERYTHING | ML_TWOSIDED))
+          P_InvalidateSightCache();
+
         buttonSuccess = 1;
       }
       break;
@@ -7009,6 +7013,7 @@ dboolean P_ExecuteZDoomLineSpecial(int special, int * args, line_t * line, int s
             if (line->backsector && line->special == zl_force_field)
             {
               line->flags &= ~(ML_BLOCKING | ML_BLOCKEVERYTHING);
+              P_InvalidateSightCache();
               line->special = 0;
               sides[line->sidenum[0]].midtexture = NO_TEXTURE;
               sides[line->sidenum[1]].midtexture = NO_TEXTURE;
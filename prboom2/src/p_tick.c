@@ -38,12 +38,15 @@
 #include "p_map.h"
 #include "r_fps.h"
 #include "e6y.h"
+#include "z_bmalloc.h"
 #include "s_advsound.h"
 
 #include "hexen/p_anim.h"
 
 #include "dsda.h"
+#include "dsda/args.h"
 #include "dsda/pause.h"
+#include "dsda/profiler.h"
 
 int leveltime;
 
@@ -51,7 +54,7 @@ static dboolean newthinkerpresent;
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated by P_MallocThinker
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
@@ -62,6 +65,131 @@ static dboolean newthinkerpresent;
 thinker_t thinkerclasscap[th_all+1];
 int init_thinkers_count = 0;
 
+//
+// Thinker slabs
+//
+// Mobjs and sector specials come from block pools segregated by size,
+// so each class of thinker sits together in memory and freed slots are
+// reused. Only the addresses change; the thinker list order does not.
+//
+// Every pool's address range is kept in a sorted table, so freeing a
+// thinker is a binary search instead of a walk over every pool of every
+// slab. Pools live until the level is freed.
+//
+
+#define THINKER_SLAB_COUNT 64
+#define THINKER_SLAB_BLOCKS 256
+
+typedef struct
+{
+  const byte *first;
+  const byte *end;
+  int slab;
+} thinker_pool_t;
+
+static struct block_memory_alloc_s thinker_slabs[THINKER_SLAB_COUNT];
+static int thinker_slab_count;
+
+static thinker_pool_t *thinker_pools;
+static int thinker_pool_count;
+static int thinker_pool_max;
+
+// Returns the index of the first pool that starts after p
+static int P_ThinkerPoolUpperBound(const byte *p)
+{
+  int low = 0;
+  int high = thinker_pool_count;
+
+  while (low < high)
+  {
+    int mid = (low + high) / 2;
+
+    if (thinker_pools[mid].first <= p)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+static void* P_MallocFromSlab(int slab)
+{
+  struct block_memory_alloc_s *zone = &thinker_slabs[slab];
+  byte *p = Z_BMalloc(zone);
+  int i = P_ThinkerPoolUpperBound(p);
+
+  // Unknown addresses are element 0 of a pool Z_BMalloc just created
+  if (i == 0 || p >= thinker_pools[i - 1].end)
+  {
+    if (thinker_pool_count == thinker_pool_max)
+    {
+      thinker_pool_max = thinker_pool_max ? thinker_pool_max * 2 : 64;
+      thinker_pools = Z_Realloc(thinker_pools, thinker_pool_max * sizeof(*thinker_pools));
+    }
+
+    memmove(&thinker_pools[i + 1], &thinker_pools[i],
+            (thinker_pool_count - i) * sizeof(*thinker_pools));
+    thinker_pools[i].first = p;
+    thinker_pools[i].end = p + zone->size * zone->perpool;
+    thinker_pools[i].slab = slab;
+    ++thinker_pool_count;
+  }
+
+  return p;
+}
+
+void* P_MallocThinker(size_t size)
+{
+  int i;
+
+  if (dsda_Flag(dsda_arg_no_thinker_slabs))
+    return Z_MallocLevel(size);
+
+  for (i = 0; i < thinker_slab_count; ++i)
+    if (thinker_slabs[i].size == size)
+      return P_MallocFromSlab(i);
+
+  if (thinker_slab_count == THINKER_SLAB_COUNT)
+    return Z_MallocLevel(size);
+
+  thinker_slabs[i].firstpool = NULL;
+  thinker_slabs[i].size = size;
+  thinker_slabs[i].perpool = THINKER_SLAB_BLOCKS;
+  thinker_slabs[i].desc = "Thinkers";
+  thinker_slabs[i].freepool = NULL;
+  ++thinker_slab_count;
+
+  return P_MallocFromSlab(i);
+}
+
+void P_FreeThinker(thinker_t *thinker)
+{
+  const byte *p = (const byte *) thinker;
+  int i = P_ThinkerPoolUpperBound(p);
+
+  if (i > 0 && p < thinker_pools[i - 1].end)
+  {
+    thinker_pool_t *pool = &thinker_pools[i - 1];
+
+    Z_BFreeFromPool(&thinker_slabs[pool->slab], (void *) pool->first, thinker);
+    return;
+  }
+
+  Z_Free(thinker);
+}
+
+// The pools are gone by now, cleared by Z_FreeLevel
+void P_FreeThinkerSlabs(void)
+{
+  int i;
+
+  for (i = 0; i < thinker_slab_count; ++i)
+    NULL_BLOCK_MEMORY_ALLOC_ZONE(thinker_slabs[i]);
+
+  thinker_pool_count = 0;
+}
+
 //
 // P_InitThinkers
 //
@@ -169,7 +297,7 @@ void P_RemoveThinkerDelayed(thinker_t *thinker)
         thinker_t *th = thinker->cnext;
         (th->cprev = thinker->cprev)->cnext = th;
       }
-      Z_Free(thinker);
+      P_FreeThinker(thinker);
     }
 }
 
@@ -257,7 +385,12 @@ static void P_RunThinkers (void)
     if (newthinkerpresent)
       R_ActivateThinkerInterpolations(currentthinker);
     if (currentthinker->function)
-      currentthinker->function(currentthinker);
+    {
+      if (dsda_profiling)
+        dsda_ProfileThinker(currentthinker);
+      else
+        currentthinker->function(currentthinker);
+    }
   }
   newthinkerpresent = false;
 
@@ -352,8 +485,14 @@ void P_Ticker (void)
         if (playeringame[i])
           P_PlayerThink(&players[i]);
 
+    DSDA_PROFILE_BEGIN(dsda_profile_thinkers);
     P_RunThinkers();
+    DSDA_PROFILE_END(dsda_profile_thinkers);
+
+    DSDA_PROFILE_BEGIN(dsda_profile_specials);
     P_UpdateSpecials();
+    DSDA_PROFILE_END(dsda_profile_specials);
+
     P_AnimateSurfaces();
     P_RespawnSpecials();
     P_AmbientSound();
@@ -46,6 +46,10 @@ void P_AddThinker(thinker_t *thinker);
 void P_RemoveThinker(thinker_t *thinker);
 void P_RemoveThinkerDelayed(thinker_t *thinker);    // killough 4/25/98
 
+void* P_MallocThinker(size_t size);
+void P_FreeThinker(thinker_t *thinker);
+void P_FreeThinkerSlabs(void);
+
 void P_UpdateThinker(thinker_t *thinker);   // killough 8/29/98
 
 void P_SetTarget(mobj_t **mo, mobj_t *target);   // killough 11/98
@@ -43,10 +43,13 @@
 #include "p_tick.h"
 #include "lprintf.h"  // jff 08/03/98 - declaration of lprintf
 #include "p_tick.h"
+#include "md5.h"
 
 #include "dsda/args.h"
 #include "dsda/configuration.h"
 #include "dsda/map_format.h"
+#include "dsda/startup_cache.h"
+#include "dsda/startup_jobs.h"
 #include "dsda/utility.h"
 
 //
@@ -119,10 +122,130 @@ const byte *R_GetTextureColumn(const rpatch_t *texpatch, int col) {
 //  with the textures from the world map.
 //
 
+static const byte png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+// The format of every patch named in PNAMES is checked on the startup
+// workers, so R_InitTextures doesn't have to load each patch to find out
+
+enum
+{
+  patch_format_unknown,
+  patch_format_queued,
+  patch_format_doom,
+  patch_format_png,
+};
+
+#define PATCH_FORMAT_JOB_SIZE 512
+
+typedef struct
+{
+  const int *lumps;
+  int count;
+} patch_format_job_t;
+
+static byte *patch_formats;
+static int *patch_format_lumps;
+static patch_format_job_t *patch_format_jobs;
+static int patch_format_job_id = -1;
+
+static void R_PatchFormatJobWork(void *data)
+{
+  const patch_format_job_t *job = data;
+  int i;
+
+  for (i = 0; i < job->count; i++)
+  {
+    int lump = job->lumps[i];
+    byte header[8];
+
+    if (W_LumpLength(lump) < 8)
+      patch_formats[lump] = patch_format_doom;
+    else if (W_ReadLumpRange(lump, 0, header, sizeof(header)))
+      patch_formats[lump] = memcmp(header, png_signature, 8) ? patch_format_doom : patch_format_png;
+  }
+}
+
+// Must be called once the lump directory is final
+void R_QueuePatchFormatJobs(void)
+{
+  const char *names;
+  int names_lump;
+  int nummappatches;
+  int count;
+  int i;
+
+  names_lump = W_CheckNumForName("PNAMES");
+  if (names_lump == LUMP_NOT_FOUND)
+    return;
+
+  names = W_LumpByNum(names_lump);
+  nummappatches = LittleLong(*((const int *)names));
+  if (nummappatches <= 0 || 4 + nummappatches * 8 > W_LumpLength(names_lump))
+    return;
+
+  patch_formats = Z_Calloc(numlumps, sizeof(*patch_formats));
+  patch_format_lumps = Z_Malloc(nummappatches * sizeof(*patch_format_lumps));
+
+  // Same lookup as R_InitTextures
+  for (count = 0, i = 0; i < nummappatches; i++)
+  {
+    char name[9];
+    int lump;
+
+    strncpy(name, names + 4 + i * 8, 8);
+    name[8] = 0;
+
+    lump = W_CheckNumForName(name);
+    if (lump == LUMP_NOT_FOUND)
+      lump = W_CheckNumForName2(name, ns_sprites);
+
+    if (lump != LUMP_NOT_FOUND && patch_formats[lump] == patch_format_unknown)
+    {
+      patch_formats[lump] = patch_format_queued;
+      patch_format_lumps[count++] = lump;
+    }
+  }
+
+  patch_format_jobs = Z_Malloc(
+    (count / PATCH_FORMAT_JOB_SIZE + 1) * sizeof(*patch_format_jobs)
+  );
+
+  for (i = 0; i * PATCH_FORMAT_JOB_SIZE < count; i++)
+  {
+    patch_format_job_t *job = &patch_format_jobs[i];
+
+    job->lumps = patch_format_lumps + i * PATCH_FORMAT_JOB_SIZE;
+    job->count = MIN(PATCH_FORMAT_JOB_SIZE, count - i * PATCH_FORMAT_JOB_SIZE);
+
+    patch_format_job_id = dsda_QueueStartupJob(R_PatchFormatJobWork, NULL, job);
+  }
+}
+
+static void R_WaitPatchFormatJobs(void)
+{
+  dsda_WaitStartupJob(patch_format_job_id);
+  patch_format_job_id = -1;
+}
+
+static void R_FreePatchFormats(void)
+{
+  R_WaitPatchFormatJobs();
+
+  Z_Free(patch_formats);
+  Z_Free(patch_format_lumps);
+  Z_Free(patch_format_jobs);
+  patch_formats = NULL;
+  patch_format_lumps = NULL;
+  patch_format_jobs = NULL;
+}
+
 static dboolean R_IsPNGLump(int lump_num)
 {
+  if (patch_formats && patch_formats[lump_num] >= patch_format_doom)
+    return patch_formats[lump_num] == patch_format_png;
+
   return W_LumpLength(lump_num) >= 8 &&
-         !memcmp(W_LumpByNum(lump_num), "\211PNG\r\n\032\n", 8);
+         !memcmp(W_LumpByNum(lump_num), png_signature, 8);
 }
 
 static int R_FilterValidPatch(int lump_num, const char *name)
@@ -139,6 +262,124 @@ static int R_FilterValidPatch(int lump_num, const char *name)
   return lump_num;
 }
 
+// The texture tables depend on the texture lumps and on lump numbering,
+// which is covered by the startup cache key
+
+static void R_TextureCacheValidation(byte *validation)
+{
+  const char *lump_names[] = { "PNAMES", "TEXTURE1", "TEXTURE2" };
+  struct MD5Context md5;
+  int i;
+
+  MD5Init(&md5);
+
+  for (i = 0; i < sizeof(lump_names) / sizeof(*lump_names); i++)
+  {
+    int lump = W_CheckNumForName(lump_names[i]);
+
+    MD5Update(&md5, (const md5byte *) &lump, sizeof(lump));
+    if (lump != LUMP_NOT_FOUND)
+      MD5Update(&md5, W_LumpByNum(lump), W_LumpLength(lump));
+  }
+
+  MD5Final(validation, &md5);
+}
+
+static int R_TextureSize(int patchcount)
+{
+  return sizeof(texture_t) + sizeof(texpatch_t) * (patchcount - 1);
+}
+
+static dboolean R_LoadCachedTextures(const byte *validation)
+{
+  const byte *data, *p, *end;
+  int length;
+  int count;
+  int i;
+
+  data = dsda_StartupCacheSection(startup_cache_textures, validation, &length);
+  if (!data || length < sizeof(count))
+    return false;
+
+  p = data;
+  end = data + length;
+
+  memcpy(&count, p, sizeof(count));
+  p += sizeof(count);
+
+  // Check the whole section before touching the texture tables
+  for (i = 0; i < count; i++)
+  {
+    int size;
+
+    if (p + sizeof(size) > end)
+      return false;
+    memcpy(&size, p, sizeof(size));
+    p += sizeof(size);
+
+    if (size < R_TextureSize(0) || p + size > end)
+      return false;
+    p += size;
+  }
+
+  if (count <= 0 || p != end)
+    return false;
+
+  numtextures = count;
+  textures = Z_Malloc(numtextures*sizeof*textures);
+  textureheight = Z_Malloc(numtextures*sizeof*textureheight);
+  texturetranslation = Z_Malloc((numtextures+1)*sizeof*texturetranslation);
+
+  p = data + sizeof(count);
+
+  for (i = 0; i < numtextures; i++)
+  {
+    int size;
+
+    memcpy(&size, p, sizeof(size));
+    p += sizeof(size);
+
+    textures[i] = Z_Malloc(size);
+    memcpy(textures[i], p, size);
+    p += size;
+
+    textureheight[i] = textures[i]->height<<FRACBITS;
+    texturetranslation[i] = i;
+  }
+
+  return true;
+}
+
+static void R_StoreCachedTextures(const byte *validation)
+{
+  byte *data, *p;
+  int length;
+  int i;
+
+  length = sizeof(numtextures);
+  for (i = 0; i < numtextures; i++)
+    length += sizeof(int) + R_TextureSize(textures[i]->patchcount);
+
+  p = data = Z_Malloc(length);
+
+  memcpy(p, &numtextures, sizeof(numtextures));
+  p += sizeof(numtextures);
+
+  for (i = 0; i < numtextures; i++)
+  {
+    int size = R_TextureSize(textures[i]->patchcount);
+
+    memcpy(p, &size, sizeof(size));
+    p += sizeof(size);
+    memcpy(p, textures[i], size);
+    p += size;
+  }
+
+  dsda_StoreStartupCacheSection(startup_cache_textures, validation, data, length);
+
+  Z_Free(data);
+}
+
 static void R_InitTextures (void)
 {
   const maptexture_t *mtexture;
@@ -160,6 +401,16 @@ static void R_InitTextures (void)
   int  numtextures1, numtextures2;
   const int *directory;
   int  errors = 0;
+  byte validation[STARTUP_CACHE_VALIDATION_SIZE];
+
+  R_TextureCacheValidation(validation);
+  if (R_LoadCachedTextures(validation))
+  {
+    R_FreePatchFormats();
+    return;
+  }
+
+  R_WaitPatchFormatJobs();
 
   // Load the patch names from pnames.lmp.
   name[8] = 0;
@@ -302,6 +553,7 @@ static void R_InitTextures (void)
     }
 
   Z_Free(patchlookup);         // killough
+  R_FreePatchFormats();
 
   if (errors)
   {
@@ -331,6 +583,8 @@ static void R_InitTextures (void)
       textures[i]->next = textures[j]->index;   // Prepend to chain
       textures[j]->index = i;
     }
+
+  R_StoreCachedTextures(validation);
 }
 
 //
@@ -75,6 +75,7 @@ const byte *R_GetTextureColumn(const rpatch_t *texpatch, int col);
 
 // I/O, setting up the stuff.
 void R_InitData (void);
+void R_QueuePatchFormatJobs(void);
 void R_PrecacheLevel (void);
 
 
@@ -42,11 +42,13 @@
 #include "v_video.h"
 #include "p_pspr.h"
 #include "lprintf.h"
+#include "md5.h"
 #include "e6y.h"//e6y
 
 #include "dsda/configuration.h"
 #include "dsda/render_stats.h"
 #include "dsda/settings.h"
+#include "dsda/startup_cache.h"
 
 #define BASEYCENTER 100
 
@@ -231,17 +233,114 @@ static void R_InstallSpriteLump(int lump, unsigned frame,
 
 #define R_SpriteNameHash(s) ((unsigned)((s)[0]-((s)[1]*3-(s)[3]*2-(s)[2])*2))
 
+// The sprite frames depend on the sprite names, which dehacked can change,
+// and on lump numbering, which is covered by the startup cache key
+
+static void R_SpriteCacheValidation(const char * const * namelist, byte *validation)
+{
+  struct MD5Context md5;
+  int i;
+
+  MD5Init(&md5);
+  MD5Update(&md5, (const md5byte *) &num_sprites, sizeof(num_sprites));
+
+  for (i = 0; i < num_sprites; i++)
+    if (namelist[i])
+      MD5Update(&md5, (const md5byte *) namelist[i], strlen(namelist[i]) + 1);
+    else
+      MD5Update(&md5, (const md5byte *) &i, sizeof(i));
+
+  MD5Final(validation, &md5);
+}
+
+static dboolean R_LoadCachedSpriteDefs(const byte *validation)
+{
+  const byte *data, *p, *end;
+  int length;
+  int i;
+
+  data = dsda_StartupCacheSection(startup_cache_sprites, validation, &length);
+  if (!data)
+    return false;
+
+  end = data + length;
+
+  // Check the whole section before touching the sprite tables
+  for (i = 0, p = data; i < num_sprites; i++)
+  {
+    int numframes;
+
+    if (p + sizeof(numframes) > end)
+      return false;
+    memcpy(&numframes, p, sizeof(numframes));
+    p += sizeof(numframes);
+
+    if (numframes < 0 || numframes > MAX_SPRITE_FRAMES ||
+        p + numframes * sizeof(spriteframe_t) > end)
+      return false;
+    p += numframes * sizeof(spriteframe_t);
+  }
+
+  if (p != end)
+    return false;
+
+  for (i = 0, p = data; i < num_sprites; i++)
+  {
+    memcpy(&sprites[i].numframes, p, sizeof(sprites[i].numframes));
+    p += sizeof(sprites[i].numframes);
+
+    if (sprites[i].numframes)
+    {
+      sprites[i].spriteframes = Z_Malloc(sprites[i].numframes * sizeof(spriteframe_t));
+      memcpy(sprites[i].spriteframes, p, sprites[i].numframes * sizeof(spriteframe_t));
+      p += sprites[i].numframes * sizeof(spriteframe_t);
+    }
+  }
+
+  return true;
+}
+
+static void R_StoreCachedSpriteDefs(const byte *validation)
+{
+  byte *data, *p;
+  int length;
+  int i;
+
+  length = 0;
+  for (i = 0; i < num_sprites; i++)
+    length += sizeof(sprites[i].numframes) + sprites[i].numframes * sizeof(spriteframe_t);
+
+  p = data = Z_Malloc(length);
+
+  for (i = 0; i < num_sprites; i++)
+  {
+    memcpy(p, &sprites[i].numframes, sizeof(sprites[i].numframes));
+    p += sizeof(sprites[i].numframes);
+    memcpy(p, sprites[i].spriteframes, sprites[i].numframes * sizeof(spriteframe_t));
+    p += sprites[i].numframes * sizeof(spriteframe_t);
+  }
+
+  dsda_StoreStartupCacheSection(startup_cache_sprites, validation, data, length);
+
+  Z_Free(data);
+}
+
 static void R_InitSpriteDefs(const char * const * namelist)
 {
   size_t numentries = lastspritelump-firstspritelump+1;
   struct { int index, next; } *hash;
   int i;
+  byte validation[STARTUP_CACHE_VALIDATION_SIZE];
 
   if (!numentries || !*namelist)
     return;
 
   sprites = Z_Calloc(num_sprites, sizeof(*sprites));
 
+  R_SpriteCacheValidation(namelist, validation);
+  if (R_LoadCachedSpriteDefs(validation))
+    return;
+
   // Create hash table based on just the first four letters of each sprite
   // killough 1/31/98
 
@@ -385,6 +484,8 @@ static void R_InitSpriteDefs(const char * const * namelist)
         }
     }
   Z_Free(hash);             // free hash table
+
+  R_StoreCachedSpriteDefs(validation);
 }
 
 //
@@ -44,7 +44,7 @@
 #include "z_zone.h"
 #include "lprintf.h"
 
-static void **lump_data;
+#include "dsda/lump_cache.h"
 
 /* W_InitCache
  *
@@ -53,9 +53,7 @@ static void **lump_data;
 void W_InitCache(void)
 {
   // set up caching
-  lump_data = calloc(sizeof *lump_data, numlumps);
-  if (!lump_data)
-    I_Error ("W_Init: Couldn't allocate lump data");
+  dsda_InitLumpCache();
 }
 
 void W_DoneCache(void)
@@ -66,6 +64,8 @@ void W_DoneCache(void)
  * killough 4/25/98: simplified
  * CPhipps - modified for new lump locking scheme
  *           returns a const*
+ *
+ * Callers may hold on to the data, so these lumps are never evicted
  */
 
 const void *W_LumpByNum(int lump)
@@ -75,16 +75,15 @@ const void *W_LumpByNum(int lump)
     I_Error ("W_LumpByNum: %i >= numlumps",lump);
 #endif
 
-  // read the lump in
-  if (!lump_data[lump]) {
-    lump_data[lump] = Z_Malloc(W_LumpLength(lump));
-    W_ReadLump(lump, lump_data[lump]);
-  }
-
-  return lump_data[lump];
+  return dsda_LockCachedLump(lump, true);
 }
 
 const void *W_LockLumpNum(int lump)
 {
-  return W_LumpByNum(lump);
+  return dsda_LockCachedLump(lump, false);
+}
+
+void W_UnlockLumpNum(int lump)
+{
+  dsda_UnlockCachedLump(lump);
 }
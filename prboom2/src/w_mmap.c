@@ -55,7 +55,16 @@
 
 #include "e6y.h"//e6y
 
-static void **lump_data;
+#include "dsda/lump_cache.h"
+#include "dsda/zipfile.h"
+
+// Deflated zip members are inflated on first use
+static const void* W_ZipLumpByNum(int lump)
+{
+  W_CheckZipMemberRange(lumpinfo[lump].wadfile, lumpinfo[lump].position, lumpinfo[lump].size);
+
+  return dsda_ZipMemberData(lumpinfo[lump].wadfile->zip_member) + lumpinfo[lump].position;
+}
 
 #ifdef _WIN32
 typedef struct {
@@ -71,10 +80,7 @@ void W_DoneCache(void)
 {
   size_t i;
 
-  if (lump_data) {
-    Z_Free(lump_data);
-    lump_data = NULL;
-  }
+  dsda_FreeLumpCache();
 
   if (!mapped_wad)
     return;
@@ -106,9 +112,7 @@ void W_InitCache(void)
   W_DoneCache();
 
   // set up caching
-  lump_data = Z_Calloc(numlumps, sizeof *lump_data);
-  if (!lump_data)
-    I_Error ("W_Init: Couldn't allocate lump data");
+  dsda_InitLumpCache();
 
   mapped_wad = Z_Calloc(numwadfiles,sizeof(mmap_info_t));
   memset(mapped_wad,0,sizeof(mmap_info_t)*numwadfiles);
@@ -118,7 +122,7 @@ void W_InitCache(void)
     {
       int wad_index = (int)(lumpinfo[i].wadfile-wadfiles);
 
-      if (!lumpinfo[i].wadfile)
+      if (!lumpinfo[i].wadfile || lumpinfo[i].wadfile->handle <= 0)
         continue;
 #ifdef RANGECHECK
       if ((wad_index<0)||((size_t)wad_index>=numwadfiles))
@@ -126,7 +130,11 @@ void W_InitCache(void)
 #endif
       if (!mapped_wad[wad_index].data)
       {
-        wchar_t *wname = ConvertUtf8ToWide(wadfiles[wad_index].name);
+        wchar_t *wname = ConvertUtf8ToWide(
+          wadfiles[wad_index].zip_member ?
+          dsda_ZipMemberArchivePath(wadfiles[wad_index].zip_member) :
+          wadfiles[wad_index].name
+        );
         mapped_wad[wad_index].hnd = CreateFileW(wname,
           GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
           NULL, OPEN_EXISTING, 0, NULL);
@@ -170,6 +178,8 @@ const void* W_LumpByNum(int lump)
 #endif
   if (!lumpinfo[lump].wadfile)
     return NULL;
+  if (lumpinfo[lump].wadfile->handle <= 0)
+    return W_ZipLumpByNum(lump);
   return (void*)((unsigned char *)mapped_wad[wad_index].data+lumpinfo[lump].position);
 }
 
@@ -181,9 +191,7 @@ void W_InitCache(void)
 {
   int maxfd = 0;
   // set up caching
-  lump_data = Z_Calloc(numlumps, sizeof *lump_data);
-  if (!lump_data)
-    I_Error ("W_Init: Couldn't allocate lump data");
+  dsda_InitLumpCache();
 
   {
     int i;
@@ -195,7 +203,7 @@ void W_InitCache(void)
   {
     int i;
     for (i=0; i<numlumps; i++) {
-      if (lumpinfo[i].wadfile) {
+      if (lumpinfo[i].wadfile && lumpinfo[i].wadfile->handle > 0) {
         int fd = lumpinfo[i].wadfile->handle;
         if (!mapped_wad[fd])
           if ((mapped_wad[fd] = mmap(NULL,I_Filelength(fd),PROT_READ,MAP_SHARED,fd,0)) == MAP_FAILED)
@@ -231,6 +239,8 @@ const void* W_LumpByNum(int lump)
 #endif
   if (!lumpinfo[lump].wadfile)
     return NULL;
+  if (lumpinfo[lump].wadfile->handle <= 0)
+    return W_ZipLumpByNum(lump);
 
   return
     (const void *) (
@@ -246,17 +256,15 @@ const void* W_LumpByNum(int lump)
  * This copies the lump into a malloced memory region and returns its address
  * instead of returning a pointer into the memory mapped area
  *
+ * The copy stays valid until the matching W_UnlockLumpNum
+ *
  */
 const void* W_LockLumpNum(int lump)
 {
-  size_t len = W_LumpLength(lump);
-  const void *data = W_LumpByNum(lump);
-
-  // read the lump in
-  if (!lump_data[lump]) {
-    lump_data[lump] = Z_Malloc(len);
-    memcpy(lump_data[lump], data, len);
-  }
+  return dsda_LockCachedLump(lump, false);
+}
 
-  return lump_data[lump];
+void W_UnlockLumpNum(int lump)
+{
+  dsda_UnlockCachedLump(lump);
 }
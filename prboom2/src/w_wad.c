@@ -55,6 +55,9 @@
 #include "lprintf.h"
 #include "e6y.h"
 
+#include "dsda/startup_cache.h"
+#include "dsda/zipfile.h"
+
 //
 // GLOBALS
 //
@@ -110,6 +113,38 @@ char *AddDefaultExtension(char *path, const char *ext)
 // LUMP BASED ROUTINES.
 //
 
+// Zip members are only a window into the archive (or an inflated buffer),
+// so reading past the member's end wouldn't fail on its own
+void W_CheckZipMemberRange(const wadfile_info_t *wadfile, int offset, int length)
+{
+  int member_offset;
+
+  if (!wadfile->zip_member)
+    return;
+
+  member_offset = offset;
+  if (wadfile->handle > 0)
+    member_offset -= dsda_ZipMemberOffset(wadfile->zip_member);
+
+  if (member_offset < 0 || length < 0 ||
+      length > dsda_ZipMemberLength(wadfile->zip_member) - member_offset)
+    I_Error("W_CheckZipMemberRange: %s is truncated or malformed", wadfile->name);
+}
+
+// Deflated zip members have no handle and are read from memory
+static void W_ReadFile(wadfile_info_t *wadfile, int offset, void *dest, int length)
+{
+  W_CheckZipMemberRange(wadfile, offset, length);
+
+  if (wadfile->handle > 0)
+  {
+    lseek(wadfile->handle, offset, SEEK_SET);
+    I_Read(wadfile->handle, dest, length);
+  }
+  else
+    memcpy(dest, dsda_ZipMemberData(wadfile->zip_member) + offset, length);
+}
+
 //
 // W_AddFile
 // All files are optional, but at least one file must be
@@ -134,22 +169,35 @@ static void W_AddFile(wadfile_info_t *wadfile)
   filelump_t  *fileinfo, *fileinfo2free=NULL; //killough
   filelump_t  singleinfo;
   int         flags = 0;
+  int         base = 0;
 
   if (wadfile->src == source_skip)
   {
     return;
   }
 
-  // Close any existing handle
-  if (wadfile->handle > 0)
+  // Stored zip members are read through the archive handle,
+  // with lump positions relative to the start of the archive
+  if (wadfile->zip_member)
   {
-    close(wadfile->handle);
-    wadfile->handle = 0;
+    wadfile->handle = dsda_ZipMemberHandle(wadfile->zip_member);
+    if (wadfile->handle > 0)
+      base = dsda_ZipMemberOffset(wadfile->zip_member);
   }
+  else
+  {
+    // Close any existing handle
+    if (wadfile->handle > 0)
+    {
+      close(wadfile->handle);
+      wadfile->handle = 0;
+    }
 
-  // open the file and add to directory
+    // open the file and add to directory
+
+    wadfile->handle = M_OpenRB(wadfile->name);
+  }
 
-  wadfile->handle = M_OpenRB(wadfile->name);
   if (wadfile->handle == -1)
     {
       if (  strlen(wadfile->name)<=4 ||      // add error check -- killough
@@ -188,14 +236,18 @@ static void W_AddFile(wadfile_info_t *wadfile)
       // single lump file
       fileinfo = &singleinfo;
       singleinfo.filepos = 0;
-      singleinfo.size = LittleLong(I_Filelength(wadfile->handle));
+      singleinfo.size = LittleLong(wadfile->zip_member ?
+                                   dsda_ZipMemberLength(wadfile->zip_member) :
+                                   I_Filelength(wadfile->handle));
       ExtractFileBase(wadfile->name, singleinfo.name);
       numlumps++;
+
+      dsda_HashStartupCacheInput(&singleinfo, sizeof(singleinfo));
     }
   else
     {
       // WAD file
-      I_Read(wadfile->handle, &header, sizeof(header));
+      W_ReadFile(wadfile, base, &header, sizeof(header));
       if (strncmp(header.identification,"IWAD",4) &&
           strncmp(header.identification,"PWAD",4))
         I_Error("W_AddFile: Wad file %s doesn't have IWAD or PWAD id", wadfile->name);
@@ -203,9 +255,11 @@ static void W_AddFile(wadfile_info_t *wadfile)
       header.infotableofs = LittleLong(header.infotableofs);
       length = header.numlumps*sizeof(filelump_t);
       fileinfo2free = fileinfo = Z_Malloc(length);    // killough
-      lseek(wadfile->handle, header.infotableofs, SEEK_SET),
-      I_Read(wadfile->handle, fileinfo, length);
+      W_ReadFile(wadfile, base + header.infotableofs, fileinfo, length);
       numlumps += header.numlumps;
+
+      dsda_HashStartupCacheInput(&header, sizeof(header));
+      dsda_HashStartupCacheInput(fileinfo, length);
     }
 
     // Fill in lumpinfo
@@ -213,12 +267,24 @@ static void W_AddFile(wadfile_info_t *wadfile)
 
     lump_p = &lumpinfo[startlump];
 
+    dsda_HashStartupCacheInput(&wadfile->src, sizeof(wadfile->src));
+    dsda_HashStartupCacheInput(&flags, sizeof(flags));
+
+    // Lump positions depend on where and how the wad sits in a zip too
+    {
+      int zip_stored = wadfile->zip_member && wadfile->handle > 0;
+
+      dsda_HashStartupCacheInput(&base, sizeof(base));
+      dsda_HashStartupCacheInput(&zip_stored, sizeof(zip_stored));
+    }
+
     for (i=startlump ; (int)i<numlumps ; i++,lump_p++, fileinfo++)
       {
         lump_p->flags = flags;
         lump_p->wadfile = wadfile;                    //  killough 4/25/98
-        lump_p->position = LittleLong(fileinfo->filepos);
+        lump_p->position = base + LittleLong(fileinfo->filepos);
         lump_p->size = LittleLong(fileinfo->size);
+        W_CheckZipMemberRange(wadfile, lump_p->position, lump_p->size);
         if (wadfile->src == source_lmp)
         {
           // Modifications to place command-line-added demo lumps
@@ -470,6 +536,92 @@ int W_ListNumFromName(const char *name, int lump)
   return i;
 }
 
+// The coalesced and hashed directory depends only on the wad directories,
+// which are part of the startup cache key
+
+typedef struct
+{
+  char name[9];
+  int size;
+  int index, next;
+  int li_namespace;
+  int wadfile;
+  int position;
+  int source;
+  int flags;
+} cached_lumpinfo_t;
+
+static dboolean W_LoadCachedLumpDirectory(void)
+{
+  const cached_lumpinfo_t *cached;
+  byte validation[STARTUP_CACHE_VALIDATION_SIZE] = { 0 };
+  int length;
+  int i;
+
+  cached = (const cached_lumpinfo_t *)
+    dsda_StartupCacheSection(startup_cache_lump_directory, validation, &length);
+
+  if (!cached || !length || length % sizeof(*cached) ||
+      length / sizeof(*cached) > (size_t)numlumps)
+    return false;
+
+  numlumps = length / sizeof(*cached);
+
+  for (i = 0; i < numlumps; i++)
+    if (cached[i].wadfile < -1 || cached[i].wadfile >= (int)numwadfiles ||
+        cached[i].index < LUMP_NOT_FOUND || cached[i].index >= numlumps ||
+        cached[i].next < LUMP_NOT_FOUND || cached[i].next >= numlumps)
+      return false;
+
+  for (i = 0; i < numlumps; i++)
+  {
+    lumpinfo_t *lump = &lumpinfo[i];
+
+    memcpy(lump->name, cached[i].name, sizeof(lump->name));
+    lump->size = cached[i].size;
+    lump->index = cached[i].index;
+    lump->next = cached[i].next;
+    lump->li_namespace = cached[i].li_namespace;
+    lump->wadfile = cached[i].wadfile < 0 ? NULL : &wadfiles[cached[i].wadfile];
+    lump->position = cached[i].position;
+    lump->source = cached[i].source;
+    lump->flags = cached[i].flags;
+  }
+
+  lumpinfo = Z_Realloc(lumpinfo, numlumps * sizeof(lumpinfo_t));
+
+  return true;
+}
+
+static void W_StoreCachedLumpDirectory(void)
+{
+  cached_lumpinfo_t *cached;
+  byte validation[STARTUP_CACHE_VALIDATION_SIZE] = { 0 };
+  int i;
+
+  cached = Z_Calloc(numlumps, sizeof(*cached));
+
+  for (i = 0; i < numlumps; i++)
+  {
+    const lumpinfo_t *lump = &lumpinfo[i];
+
+    memcpy(cached[i].name, lump->name, sizeof(cached[i].name));
+    cached[i].size = lump->size;
+    cached[i].index = lump->index;
+    cached[i].next = lump->next;
+    cached[i].li_namespace = lump->li_namespace;
+    cached[i].wadfile = lump->wadfile ? lump->wadfile - wadfiles : -1;
+    cached[i].position = lump->position;
+    cached[i].source = lump->source;
+    cached[i].flags = lump->flags;
+  }
+
+  dsda_StoreStartupCacheSection(startup_cache_lump_directory, validation,
+                                cached, numlumps * sizeof(*cached));
+
+  Z_Free(cached);
+}
+
 // W_Init
 // Loads each of the files in the wadfiles array.
 // All files are optional, but at least one file
@@ -494,6 +646,8 @@ void W_Init(void)
 
   numlumps = 0; lumpinfo = NULL;
 
+  dsda_StartStartupCache();
+
   { // CPhipps - new wadfiles array used
     // open all the files, load headers, and count lumps
     int i;
@@ -504,19 +658,26 @@ void W_Init(void)
   if (!numlumps)
     I_Error ("W_Init: No files found");
 
-  //jff 1/23/98
-  // get all the sprites and flats into one marked block each
-  // killough 1/24/98: change interface to use M_START/M_END explicitly
-  // killough 4/17/98: Add namespace tags to each entry
-  // killough 4/4/98: add colormap markers
-  W_CoalesceMarkedResource("S_START", "S_END", ns_sprites);
-  W_CoalesceMarkedResource("F_START", "F_END", ns_flats);
-  W_CoalesceMarkedResource("C_START", "C_END", ns_colormaps);
-  W_CoalesceMarkedResource("B_START", "B_END", ns_prboom);
-  W_CoalesceMarkedResource("HI_START", "HI_END", ns_hires);
+  dsda_LoadStartupCache();
 
-  // killough 1/31/98: initialize lump hash table
-  W_HashLumps();
+  if (!W_LoadCachedLumpDirectory())
+  {
+    //jff 1/23/98
+    // get all the sprites and flats into one marked block each
+    // killough 1/24/98: change interface to use M_START/M_END explicitly
+    // killough 4/17/98: Add namespace tags to each entry
+    // killough 4/4/98: add colormap markers
+    W_CoalesceMarkedResource("S_START", "S_END", ns_sprites);
+    W_CoalesceMarkedResource("F_START", "F_END", ns_flats);
+    W_CoalesceMarkedResource("C_START", "C_END", ns_colormaps);
+    W_CoalesceMarkedResource("B_START", "B_END", ns_prboom);
+    W_CoalesceMarkedResource("HI_START", "HI_END", ns_hires);
+
+    // killough 1/31/98: initialize lump hash table
+    W_HashLumps();
+
+    W_StoreCachedLumpDirectory();
+  }
 
   /* cph 2001/07/07 - separated cache setup */
   lprintf(LO_DEBUG, "W_InitCache\n");
@@ -563,13 +724,41 @@ void W_ReadLump(int lump, void *dest)
 
     {
       if (l->wadfile)
-      {
-        lseek(l->wadfile->handle, l->position, SEEK_SET);
-        I_Read(l->wadfile->handle, dest, l->size);
-      }
+        W_ReadFile(l->wadfile, l->position, dest, l->size);
     }
 }
 
+// Reads part of a lump without moving the file offset, so it is safe to
+// call from worker threads. Lumps that can't be read this way (deflated
+// zip members, or any lump where pread is unavailable) return false.
+dboolean W_ReadLumpRange(int lump, int offset, void *dest, int length)
+{
+#if defined(HAVE_UNISTD_H) && !defined(_WIN32)
+  const lumpinfo_t *l = lumpinfo + lump;
+
+  if (!l->wadfile || l->wadfile->handle <= 0 ||
+      offset < 0 || length < 0 || offset + length > l->size)
+    return false;
+
+  while (length > 0)
+  {
+    ssize_t count;
+
+    count = pread(l->wadfile->handle, dest, length, l->position + offset);
+    if (count <= 0)
+      return false;
+
+    dest = (byte *) dest + count;
+    offset += count;
+    length -= count;
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
 char* W_ReadLumpToString(int lump)
 {
   char* buffer = NULL;
@@ -578,8 +767,7 @@ char* W_ReadLumpToString(int lump)
   if (lump >= 0 && lump < numlumps && l->wadfile)
   {
     buffer = Z_Malloc(l->size + 1);
-    lseek(l->wadfile->handle, l->position, SEEK_SET);
-    I_Read(l->wadfile->handle, buffer, l->size);
+    W_ReadFile(l->wadfile, l->position, buffer, l->size);
     buffer[l->size] = '\0';
   }
 
@@ -626,7 +814,8 @@ void W_Shutdown(void)
 
   for (i = 0; i < numwadfiles; ++i)
   {
-    if (wadfiles[i].handle > 0)
+    // Archive handles are shared between members
+    if (wadfiles[i].handle > 0 && !wadfiles[i].zip_member)
     {
       close(wadfiles[i].handle);
       wadfiles[i].handle = -1;
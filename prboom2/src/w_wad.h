@@ -86,6 +86,7 @@ typedef struct {
   char* name;
   wad_source_t src;
   int handle;
+  int zip_member; // nonzero for files read in place from a zip archive
 } wadfile_info_t;
 
 extern wadfile_info_t *wadfiles;
@@ -156,11 +157,14 @@ int     W_LumpLength (int lump);
 int     W_SafeLumpLength (int lump);
 const char *W_LumpName(int lump);
 void    W_ReadLump (int lump, void *dest);
+void    W_CheckZipMemberRange(const wadfile_info_t *wadfile, int offset, int length);
+dboolean W_ReadLumpRange(int lump, int offset, void *dest, int length);
 char*   W_ReadLumpToString (int lump);
 // CPhipps - modified for 'new' lump locking
 const void* W_SafeLumpByNum (int lump);
 const void* W_LumpByNum (int lump);
 const void* W_LockLumpNum(int lump);
+void W_UnlockLumpNum(int lump);
 
 int W_LumpNumExists(int lump);
 int W_LumpNameExists(const char *name);
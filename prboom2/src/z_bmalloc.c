@@ -56,13 +56,13 @@ inline static void* getelem(bmalpool_t *p, size_t size, size_t n)
 inline static PUREFUNC int iselem(const bmalpool_t *pool, size_t size, const void* p)
 {
   // CPhipps - need portable # of bytes between pointers
-  int dif = (const char*)p - (const char*)pool;
+  // Compare before subtracting, since p may be from another allocation
+  const char *first = (const char*)getelem((bmalpool_t*)pool, size, 0);
+  size_t dif;
 
-  dif -= sizeof(bmalpool_t);
-  dif -= pool->blocks;
-  if (dif<0) return -1;
-  dif /= size;
-  return (((size_t)dif >= pool->blocks) ? -1 : dif);
+  if ((const char*)p < first) return -1;
+  dif = ((const char*)p - first) / size;
+  return ((dif >= pool->blocks) ? -1 : (int)dif);
 }
 
 enum { unused_block = 0, used_block = 1};
@@ -70,6 +70,18 @@ enum { unused_block = 0, used_block = 1};
 void* Z_BMalloc(struct block_memory_alloc_s *pzone)
 {
   register bmalpool_t **pool = (bmalpool_t **)&(pzone->firstpool);
+  bmalpool_t *freepool = pzone->freepool;
+
+  // Try the pool that last had room before scanning all of them,
+  // so zones with many full pools don't pay a scan per block
+  if (freepool) {
+    byte *p = memchr(freepool->used, unused_block, freepool->blocks);
+    if (p) {
+      *p = used_block;
+      return getelem(freepool, pzone->size, p - freepool->used);
+    }
+  }
+
   while (*pool != NULL) {
     byte *p = memchr((*pool)->used, unused_block, (*pool)->blocks); // Scan for unused marker
     if (p) {
@@ -79,6 +91,7 @@ void* Z_BMalloc(struct block_memory_alloc_s *pzone)
   I_Error("Z_BMalloc: memchr returned pointer outside of array");
 #endif
       (*pool)->used[n] = used_block;
+      pzone->freepool = *pool;
       return getelem(*pool, pzone->size, n);
     } else
       pool = &((*pool)->nextpool);
@@ -96,11 +109,13 @@ void* Z_BMalloc(struct block_memory_alloc_s *pzone)
     // Return element 0 from this pool to satisfy the request
     newpool->used[0] = used_block;
     newpool->blocks = pzone->perpool;
+    pzone->freepool = newpool;
     return getelem(newpool, pzone->size, 0);
   }
 }
 
-void Z_BFree(struct block_memory_alloc_s *pzone, void* p)
+// Returns false if p does not belong to the zone
+dboolean Z_BTryFree(struct block_memory_alloc_s *pzone, void* p)
 {
   register bmalpool_t **pool = (bmalpool_t**)&(pzone->firstpool);
 
@@ -112,14 +127,42 @@ void Z_BFree(struct block_memory_alloc_s *pzone, void* p)
   I_Error("Z_BFree: Refree in zone %s", pzone->desc);
 #endif
       (*pool)->used[n] = unused_block;
-      if (memchr(((*pool)->used), used_block, (*pool)->blocks) == NULL) {
+      // The first pool is kept, so a single object being spawned and
+      // removed over and over does not allocate a new pool every time
+      if (pool != (bmalpool_t**)&(pzone->firstpool) &&
+          memchr(((*pool)->used), used_block, (*pool)->blocks) == NULL) {
   // Block is all unused, can be freed
   bmalpool_t *oldpool = *pool;
   *pool = (*pool)->nextpool;
+  if (pzone->freepool == oldpool)
+    pzone->freepool = NULL;
   Z_Free(oldpool);
-      }
-      return;
+      } else pzone->freepool = *pool;
+      return true;
     } else pool = &((*pool)->nextpool);
   }
-  I_Error("Z_BFree: Free not in zone %s", pzone->desc);
+  return false;
+}
+
+// Frees p given the first element of the pool it came from, for callers
+// that track their own pool ranges. The pool itself is never released.
+void Z_BFreeFromPool(struct block_memory_alloc_s *pzone, void *first, void* p)
+{
+  bmalpool_t *pool = (bmalpool_t*)((byte*)first - sizeof(bmalpool_t) - pzone->perpool);
+  int n = iselem(pool, pzone->size, p);
+
+#ifdef SIMPLECHECKS
+  if (n < 0)
+    I_Error("Z_BFreeFromPool: Free not in pool in zone %s", pzone->desc);
+  if (pool->used[n] == unused_block)
+    I_Error("Z_BFreeFromPool: Refree in zone %s", pzone->desc);
+#endif
+  pool->used[n] = unused_block;
+  pzone->freepool = pool;
+}
+
+void Z_BFree(struct block_memory_alloc_s *pzone, void* p)
+{
+  if (!Z_BTryFree(pzone, p))
+    I_Error("Z_BFree: Free not in zone %s", pzone->desc);
 }
@@ -39,12 +39,13 @@ struct block_memory_alloc_s {
   size_t size;
   size_t perpool;
   const char *desc;
+  void  *freepool; // where Z_BMalloc looks first
 };
 
 #define DECLARE_BLOCK_MEMORY_ALLOC_ZONE(name) extern struct block_memory_alloc_s name
 #define IMPLEMENT_BLOCK_MEMORY_ALLOC_ZONE(name, size, num, desc) \
 struct block_memory_alloc_s name = { NULL, size, num, desc}
-#define NULL_BLOCK_MEMORY_ALLOC_ZONE(name) name.firstpool = NULL
+#define NULL_BLOCK_MEMORY_ALLOC_ZONE(name) name.firstpool = name.freepool = NULL
 
 void* Z_BMalloc(struct block_memory_alloc_s *pzone);
 
@@ -52,5 +53,7 @@ inline static void* Z_BCalloc(struct block_memory_alloc_s *pzone)
 { void *p = Z_BMalloc(pzone); memset(p,0,pzone->size); return p; }
 
 void Z_BFree(struct block_memory_alloc_s *pzone, void* p);
+dboolean Z_BTryFree(struct block_memory_alloc_s *pzone, void* p);
+void Z_BFreeFromPool(struct block_memory_alloc_s *pzone, void *first, void* p);
 
 #endif //__Z_BMALLOC__
@@ -37,6 +37,13 @@
  * memory allocation functions, including malloc() and similar functions.
  * Added line and file numbers, in case of error. Added performance
  * statistics and tunables.
+ *
+ * Small level blocks are carved out of large chunks, so freeing the level
+ * releases them all at once. Blocks freed during the level go on free
+ * lists by size and are reused.
+ *
+ * With -zone_stats, live bytes, blocks, and peaks are tracked per tag and
+ * per allocation site (file and line via the Z_Malloc macros).
  *-----------------------------------------------------------------------------
  */
 
@@ -53,7 +60,9 @@
 #include "doomstat.h"
 #include "v_video.h"
 #include "g_game.h"
+#include "i_system.h"
 #include "lprintf.h"
+#include "m_file.h"
 
 #ifdef DJGPP
 #include <dpmi.h>
@@ -67,17 +76,177 @@ enum {
   ZONE_MAX
 };
 
+static const char *zone_tag_names[ZONE_MAX] = { "static", "level" };
+
+typedef struct zone_site {
+  const char *file;
+  int line;
+  int tag;
+  size_t bytes;
+  size_t peak_bytes;
+  int blocks;
+  unsigned long long allocations;
+  struct zone_site *next;
+} zone_site_t;
+
+typedef struct {
+  size_t bytes;
+  size_t peak_bytes;
+  int blocks;
+} zone_tag_stats_t;
+
 typedef struct memblock {
   unsigned signature;
   struct memblock *next,*prev;
   size_t size;
+  zone_site_t *site;          // NULL unless allocation accounting is on
   unsigned char tag;
+  unsigned char arena;        // part of a level chunk, not on the tag list
 } memblock_t;
 
 static const size_t HEADER_SIZE = sizeof(memblock_t);
 
 static memblock_t *blockbytag[ZONE_MAX];
 
+#define LEVEL_CHUNK_SIZE (1024 * 1024)
+#define LEVEL_BLOCK_ALIGN 16
+#define LEVEL_BLOCK_MAX 2048
+#define LEVEL_BLOCK_CLASSES (LEVEL_BLOCK_MAX / LEVEL_BLOCK_ALIGN)
+
+typedef struct level_chunk {
+  struct level_chunk *next;
+  size_t used;
+} level_chunk_t;
+
+static level_chunk_t *level_chunks;
+static memblock_t *level_free_blocks[LEVEL_BLOCK_CLASSES];
+
+#define ZONE_SITE_HASH_SIZE 1024
+
+static const char *zone_stats_filename;
+static zone_site_t *zone_site_hash[ZONE_SITE_HASH_SIZE];
+static int zone_site_count;
+static zone_tag_stats_t zone_tag_stats[ZONE_MAX];
+
+static zone_site_t *Z_FindSite(const char *file, int line, int tag)
+{
+  zone_site_t *site;
+  unsigned int hash;
+
+  hash = ((unsigned int) (size_t) file ^ (unsigned int) line * 31 ^ tag) % ZONE_SITE_HASH_SIZE;
+
+  for (site = zone_site_hash[hash]; site; site = site->next)
+    if (site->file == file && site->line == line && site->tag == tag)
+      return site;
+
+  // Sites live outside the zone so they can't recurse into the accounting
+  if (!(site = calloc(1, sizeof(*site))))
+    I_Error ("Z_FindSite: Failure trying to allocate %lu bytes", (unsigned long) sizeof(*site));
+
+  site->file = file;
+  site->line = line;
+  site->tag = tag;
+  site->next = zone_site_hash[hash];
+  zone_site_hash[hash] = site;
+  ++zone_site_count;
+
+  return site;
+}
+
+static void Z_RecordAlloc(memblock_t *block, const char *file, int line)
+{
+  zone_site_t *site;
+  zone_tag_stats_t *tag_stats;
+
+  if (!zone_stats_filename)
+  {
+    block->site = NULL;
+    return;
+  }
+
+  site = block->site = Z_FindSite(file, line, block->tag);
+  site->bytes += block->size;
+  ++site->blocks;
+  ++site->allocations;
+  if (site->bytes > site->peak_bytes)
+    site->peak_bytes = site->bytes;
+
+  tag_stats = &zone_tag_stats[block->tag];
+  tag_stats->bytes += block->size;
+  ++tag_stats->blocks;
+  if (tag_stats->bytes > tag_stats->peak_bytes)
+    tag_stats->peak_bytes = tag_stats->bytes;
+}
+
+static void Z_RecordFree(memblock_t *block)
+{
+  block->site->bytes -= block->size;
+  --block->site->blocks;
+
+  zone_tag_stats[block->tag].bytes -= block->size;
+  --zone_tag_stats[block->tag].blocks;
+}
+
+static size_t Z_LevelChunkHeaderSize(void)
+{
+  return (sizeof(level_chunk_t) + LEVEL_BLOCK_ALIGN - 1) & ~(LEVEL_BLOCK_ALIGN - 1);
+}
+
+static memblock_t *Z_MallocArena(size_t size)
+{
+  memblock_t *block;
+  int size_class = (size - 1) / LEVEL_BLOCK_ALIGN;
+
+  if ((block = level_free_blocks[size_class]))
+  {
+    level_free_blocks[size_class] = block->next;
+  }
+  else
+  {
+    size_t block_size = HEADER_SIZE + (size_class + 1) * LEVEL_BLOCK_ALIGN;
+
+    if (!level_chunks || level_chunks->used + block_size > LEVEL_CHUNK_SIZE)
+    {
+      level_chunk_t *chunk;
+
+      if (!(chunk = malloc(LEVEL_CHUNK_SIZE)))
+        I_Error ("Z_Malloc: Failure trying to allocate %lu bytes", (unsigned long) LEVEL_CHUNK_SIZE);
+
+      chunk->next = level_chunks;
+      chunk->used = Z_LevelChunkHeaderSize();
+      level_chunks = chunk;
+    }
+
+    block = (memblock_t *)((char *) level_chunks + level_chunks->used);
+    level_chunks->used += block_size;
+  }
+
+  block->next = block->prev = NULL;
+  block->arena = true;
+
+  return block;
+}
+
+static void Z_FreeArena(memblock_t *block)
+{
+  int size_class = (block->size - 1) / LEVEL_BLOCK_ALIGN;
+
+  block->next = level_free_blocks[size_class];
+  level_free_blocks[size_class] = block;
+}
+
+static void Z_FreeLevelChunks(void)
+{
+  while (level_chunks)
+  {
+    level_chunk_t *next = level_chunks->next;
+    free(level_chunks);
+    level_chunks = next;
+  }
+
+  memset(level_free_blocks, 0, sizeof(level_free_blocks));
+}
+
 /* Z_Malloc
  * cph - the algorithm here was a very simple first-fit round-robin
  *  one - just keep looping around, freeing everything we can until
@@ -88,34 +257,44 @@ static memblock_t *blockbytag[ZONE_MAX];
  * free all the stuff we just pass on the way.
  */
 
-static void *Z_MallocTag(size_t size, int tag)
+static void *Z_MallocTag(size_t size, int tag, const char *file, int line)
 {
   memblock_t *block = NULL;
 
   if (!size)
     return NULL; // malloc(0) returns NULL
 
-  if (!(block = malloc(size + HEADER_SIZE)))
+  if (tag == ZONE_LEVEL && size <= LEVEL_BLOCK_MAX)
   {
-    I_Error ("Z_Malloc: Failure trying to allocate %lu bytes", (unsigned long) size);
-  }
-
-  if (!blockbytag[tag])
-  {
-    blockbytag[tag] = block;
-    block->next = block->prev = block;
+    block = Z_MallocArena(size);
   }
   else
   {
-    blockbytag[tag]->prev->next = block;
-    block->prev = blockbytag[tag]->prev;
-    block->next = blockbytag[tag];
-    blockbytag[tag]->prev = block;
+    if (!(block = malloc(size + HEADER_SIZE)))
+    {
+      I_Error ("Z_Malloc: Failure trying to allocate %lu bytes", (unsigned long) size);
+    }
+
+    if (!blockbytag[tag])
+    {
+      blockbytag[tag] = block;
+      block->next = block->prev = block;
+    }
+    else
+    {
+      blockbytag[tag]->prev->next = block;
+      block->prev = blockbytag[tag]->prev;
+      block->next = blockbytag[tag];
+      blockbytag[tag]->prev = block;
+    }
+
+    block->arena = false;
   }
 
   block->size = size;
   block->signature = ZONE_SIGNATURE;
   block->tag = tag;           // tag
+  Z_RecordAlloc(block, file, line);
   block = (memblock_t *)((char *) block + HEADER_SIZE);
 
   return block;
@@ -132,6 +311,15 @@ void Z_Free(void *p)
     I_Error("Z_Free: freed a non-zone pointer");
   block->signature = 0;       // Nullify signature so another free fails
 
+  if (block->site)
+    Z_RecordFree(block);
+
+  if (block->arena)
+  {
+    Z_FreeArena(block);
+    return;
+  }
+
   if (block == block->next)
     blockbytag[block->tag] = NULL;
   else
@@ -150,6 +338,33 @@ static void Z_FreeTag(int tag)
   if (tag < 0 || tag >= ZONE_MAX)
     I_Error("Z_FreeTag: Tag %i does not exist", tag);
 
+  if (tag == ZONE_LEVEL)
+  {
+    // Chunk memory is released in bulk, but the accounting still needs
+    //  to see each block that was live
+    if (zone_stats_filename)
+    {
+      int i;
+
+      for (i = 0; i < ZONE_SITE_HASH_SIZE; ++i)
+      {
+        zone_site_t *site;
+
+        for (site = zone_site_hash[i]; site; site = site->next)
+          if (site->tag == ZONE_LEVEL)
+          {
+            site->bytes = 0;
+            site->blocks = 0;
+          }
+      }
+
+      zone_tag_stats[ZONE_LEVEL].bytes = 0;
+      zone_tag_stats[ZONE_LEVEL].blocks = 0;
+    }
+
+    Z_FreeLevelChunks();
+  }
+
   block = blockbytag[tag];
   if (!block)
     return;
@@ -157,6 +372,8 @@ static void Z_FreeTag(int tag)
   while (1)
   {
     memblock_t *next = block->next;
+    if (tag == ZONE_LEVEL)
+      block->site = NULL;     // already cleared above
     Z_Free((char *) block + HEADER_SIZE);
     if (block == end_block)
       break;
@@ -164,9 +381,9 @@ static void Z_FreeTag(int tag)
   }
 }
 
-static void *Z_ReallocTag(void *ptr, size_t n, int tag)
+static void *Z_ReallocTag(void *ptr, size_t n, int tag, const char *file, int line)
 {
-  void *p = Z_MallocTag(n, tag);
+  void *p = Z_MallocTag(n, tag, file, line);
   if (ptr)
     {
       memblock_t *block = (memblock_t *)((char *) ptr - HEADER_SIZE);
@@ -176,35 +393,35 @@ static void *Z_ReallocTag(void *ptr, size_t n, int tag)
   return p;
 }
 
-static void *Z_CallocTag(size_t n1, size_t n2, int tag)
+static void *Z_CallocTag(size_t n1, size_t n2, int tag, const char *file, int line)
 {
   return
-    (n1*=n2) ? memset(Z_MallocTag(n1, tag), 0, n1) : NULL;
+    (n1*=n2) ? memset(Z_MallocTag(n1, tag, file, line), 0, n1) : NULL;
 }
 
-static char *Z_StrdupTag(const char *s, int tag)
+static char *Z_StrdupTag(const char *s, int tag, const char *file, int line)
 {
-  return strcpy(Z_MallocTag(strlen(s)+1, tag), s);
+  return strcpy(Z_MallocTag(strlen(s)+1, tag, file, line), s);
 }
 
-void *Z_Malloc(size_t size)
+void *(Z_Malloc)(size_t size, const char *file, int line)
 {
-  return Z_MallocTag(size, ZONE_STATIC);
+  return Z_MallocTag(size, ZONE_STATIC, file, line);
 }
 
-void *Z_Calloc(size_t n, size_t n2)
+void *(Z_Calloc)(size_t n, size_t n2, const char *file, int line)
 {
-  return Z_CallocTag(n, n2, ZONE_STATIC);
+  return Z_CallocTag(n, n2, ZONE_STATIC, file, line);
 }
 
-void *Z_Realloc(void *p, size_t n)
+void *(Z_Realloc)(void *p, size_t n, const char *file, int line)
 {
-  return Z_ReallocTag(p, n, ZONE_STATIC);
+  return Z_ReallocTag(p, n, ZONE_STATIC, file, line);
 }
 
-char *Z_Strdup(const char *s)
+char *(Z_Strdup)(const char *s, const char *file, int line)
 {
-  return Z_StrdupTag(s, ZONE_STATIC);
+  return Z_StrdupTag(s, ZONE_STATIC, file, line);
 }
 
 void Z_FreeLevel(void)
@@ -212,22 +429,170 @@ void Z_FreeLevel(void)
   return Z_FreeTag(ZONE_LEVEL);
 }
 
-void *Z_MallocLevel(size_t size)
+void *(Z_MallocLevel)(size_t size, const char *file, int line)
 {
-  return Z_MallocTag(size, ZONE_LEVEL);
+  return Z_MallocTag(size, ZONE_LEVEL, file, line);
 }
 
-void *Z_CallocLevel(size_t n, size_t n2)
+void *(Z_CallocLevel)(size_t n, size_t n2, const char *file, int line)
 {
-  return Z_CallocTag(n, n2, ZONE_LEVEL);
+  return Z_CallocTag(n, n2, ZONE_LEVEL, file, line);
 }
 
-void *Z_ReallocLevel(void *p, size_t n)
+void *(Z_ReallocLevel)(void *p, size_t n, const char *file, int line)
 {
-  return Z_ReallocTag(p, n, ZONE_LEVEL);
+  return Z_ReallocTag(p, n, ZONE_LEVEL, file, line);
 }
 
-char *Z_StrdupLevel(const char *s)
+char *(Z_StrdupLevel)(const char *s, const char *file, int line)
 {
-  return Z_StrdupTag(s, ZONE_LEVEL);
+  return Z_StrdupTag(s, ZONE_LEVEL, file, line);
+}
+
+//
+// Allocation accounting
+//
+
+// Build paths vary, so sites are shown relative to the source directory
+static const char *Z_SiteFileName(const char *file)
+{
+  const char *p;
+
+  for (p = file; *p; ++p)
+    if ((p[0] == '/' || p[0] == '\\') && !strncmp(p + 1, "src", 3) &&
+        (p[4] == '/' || p[4] == '\\'))
+      file = p + 5;
+
+  return file;
+}
+
+static int C_DECL Z_CompareSites(const void *a, const void *b)
+{
+  const zone_site_t *s1 = *(const zone_site_t * const *) a;
+  const zone_site_t *s2 = *(const zone_site_t * const *) b;
+
+  if (s1->bytes != s2->bytes)
+    return s1->bytes < s2->bytes ? 1 : -1;
+
+  return s1->peak_bytes < s2->peak_bytes ? 1 : s1->peak_bytes > s2->peak_bytes ? -1 : 0;
+}
+
+static zone_site_t **Z_SortedSites(void)
+{
+  int i, count;
+  zone_site_t **sites;
+
+  if (!(sites = malloc((zone_site_count + 1) * sizeof(*sites))))
+    I_Error ("Z_SortedSites: Failure trying to allocate site list");
+
+  count = 0;
+  for (i = 0; i < ZONE_SITE_HASH_SIZE; ++i)
+  {
+    zone_site_t *site;
+
+    for (site = zone_site_hash[i]; site; site = site->next)
+      sites[count++] = site;
+  }
+
+  qsort(sites, count, sizeof(*sites), Z_CompareSites);
+
+  return sites;
+}
+
+static void Z_FormatTag(char *buffer, size_t size, int tag)
+{
+  snprintf(buffer, size, "%-8s %12lu %12lu %10d", zone_tag_names[tag],
+           (unsigned long) zone_tag_stats[tag].bytes,
+           (unsigned long) zone_tag_stats[tag].peak_bytes,
+           zone_tag_stats[tag].blocks);
+}
+
+static void Z_FormatSite(char *buffer, size_t size, zone_site_t *site)
+{
+  snprintf(buffer, size, "%12lu %12lu %10d %12llu  %-6s %s:%d",
+           (unsigned long) site->bytes, (unsigned long) site->peak_bytes,
+           site->blocks, site->allocations, zone_tag_names[site->tag],
+           Z_SiteFileName(site->file), site->line);
+}
+
+static const char zone_tag_header[] = "tag             bytes         peak     blocks";
+static const char zone_site_header[] =
+  "       bytes         peak     blocks  allocations  tag    site";
+
+int Z_StatsEnabled(void)
+{
+  return zone_stats_filename != NULL;
+}
+
+void Z_PrintStats(int count)
+{
+  int i;
+  char line[256];
+  zone_site_t **sites;
+
+  if (!zone_stats_filename)
+  {
+    lprintf(LO_INFO, "Allocation accounting is off (use -zone_stats)\n");
+    return;
+  }
+
+  lprintf(LO_INFO, "%s\n", zone_tag_header);
+  for (i = 0; i < ZONE_MAX; ++i)
+  {
+    Z_FormatTag(line, sizeof(line), i);
+    lprintf(LO_INFO, "%s\n", line);
+  }
+
+  sites = Z_SortedSites();
+
+  lprintf(LO_INFO, "%s\n", zone_site_header);
+  for (i = 0; i < count && i < zone_site_count; ++i)
+  {
+    Z_FormatSite(line, sizeof(line), sites[i]);
+    lprintf(LO_INFO, "%s\n", line);
+  }
+
+  free(sites);
+}
+
+static void Z_WriteStats(void)
+{
+  int i;
+  char line[256];
+  FILE *fstream;
+  zone_site_t **sites;
+
+  fstream = M_OpenFile(zone_stats_filename, "w");
+  if (!fstream)
+  {
+    lprintf(LO_WARN, "Z_WriteStats: unable to open %s\n", zone_stats_filename);
+    return;
+  }
+
+  fprintf(fstream, "%s\n", zone_tag_header);
+  for (i = 0; i < ZONE_MAX; ++i)
+  {
+    Z_FormatTag(line, sizeof(line), i);
+    fprintf(fstream, "%s\n", line);
+  }
+
+  sites = Z_SortedSites();
+
+  fprintf(fstream, "\n%s\n", zone_site_header);
+  for (i = 0; i < zone_site_count; ++i)
+  {
+    Z_FormatSite(line, sizeof(line), sites[i]);
+    fprintf(fstream, "%s\n", line);
+  }
+
+  free(sites);
+  fclose(fstream);
+}
+
+// Blocks allocated before this point are not counted
+void Z_EnableStats(const char *filename)
+{
+  zone_stats_filename = filename;
+
+  I_AtExit(Z_WriteStats, true, "Z_WriteStats", exit_priority_normal);
 }
@@ -52,14 +52,29 @@
 void Z_Free(void *ptr);
 void Z_FreeLevel(void);
 
-void *Z_Malloc(size_t size);
-void *Z_Calloc(size_t n, size_t n2);
-void *Z_Realloc(void *p, size_t n);
-char *Z_Strdup(const char *s);
+// The call site is recorded when allocation accounting is enabled
+void *(Z_Malloc)(size_t size, const char *file, int line);
+void *(Z_Calloc)(size_t n, size_t n2, const char *file, int line);
+void *(Z_Realloc)(void *p, size_t n, const char *file, int line);
+char *(Z_Strdup)(const char *s, const char *file, int line);
 
-void *Z_MallocLevel(size_t size);
-void *Z_CallocLevel(size_t n, size_t n2);
-void *Z_ReallocLevel(void *p, size_t n);
-char *Z_StrdupLevel(const char *s);
+void *(Z_MallocLevel)(size_t size, const char *file, int line);
+void *(Z_CallocLevel)(size_t n, size_t n2, const char *file, int line);
+void *(Z_ReallocLevel)(void *p, size_t n, const char *file, int line);
+char *(Z_StrdupLevel)(const char *s, const char *file, int line);
+
+#define Z_Malloc(a)          (Z_Malloc)(a, __FILE__, __LINE__)
+#define Z_Calloc(a, b)       (Z_Calloc)(a, b, __FILE__, __LINE__)
+#define Z_Realloc(a, b)      (Z_Realloc)(a, b, __FILE__, __LINE__)
+#define Z_Strdup(a)          (Z_Strdup)(a, __FILE__, __LINE__)
+
+#define Z_MallocLevel(a)     (Z_MallocLevel)(a, __FILE__, __LINE__)
+#define Z_CallocLevel(a, b)  (Z_CallocLevel)(a, b, __FILE__, __LINE__)
+#define Z_ReallocLevel(a, b) (Z_ReallocLevel)(a, b, __FILE__, __LINE__)
+#define Z_StrdupLevel(a)     (Z_StrdupLevel)(a, __FILE__, __LINE__)
+
+void Z_EnableStats(const char *filename);
+int Z_StatsEnabled(void);
+void Z_PrintStats(int count);
 
 #endif
@@ -95,4 +95,103 @@ RSpec.describe 'sync' do
       end
     end
   end
+
+  # Optimizations with a switch back to the original code must not change
+  # the game state. Each demo is played once to record per-tic state
+  # hashes, then again with the option toggled, which exits with an error
+  # at the first tic that differs.
+  describe 'state hash' do
+    let(:hash_file) { 'sync_hash_stream.txt' }
+    let(:extra) { "-hash_stream #{hash_file}" }
+
+    subject do
+      Utility.play_demo(
+        lmp: lmp, iwad: iwad, pwad: pwad, extra: "#{toggle} -hash_compare #{hash_file}"
+      )
+    end
+
+    after { File.delete(hash_file) if File.exist?(hash_file) }
+
+    shared_examples 'state hash demos' do
+      # complevel 2
+      context 'doom2 30uv in 17:55 by Looper' do
+        let(:lmp) { '30uv1755.lmp' }
+
+        it { is_expected.to eq(true) }
+      end
+
+      # complevel 9
+      context 'rush 12 uv max in 21:14 by Ancalagon' do
+        let(:lmp) { 'ru12-2114.lmp' }
+        let(:pwad) { 'rush.wad' }
+
+        it { is_expected.to eq(true) }
+      end
+
+      # complevel 11
+      context 'valiant e1 uv speed in 5:13 by Krankdud' do
+        let(:lmp) { 'vae1-513.lmp' }
+        let(:pwad) { 'Valiant.wad' }
+
+        it { is_expected.to eq(true) }
+      end
+
+      # crusher damage through P_CheckSector
+      context 'analysis test crusher' do
+        let(:lmp) { 'crusher.lmp' }
+        let(:pwad) { 'analysis_test.wad' }
+
+        it { is_expected.to eq(true) }
+      end
+
+      # udmf, Line_SetBlocking toggling sight blocking between a monster and
+      # the player; the wad and demo are not redistributable with the specs.
+      # Skipped through metadata so the engine isn't started without them.
+      set_blocking_missing =
+        !File.exist?('spec/support/lmps/set_blocking.lmp') ||
+        !File.exist?('spec/support/wads/set_blocking.wad')
+
+      context 'udmf line set blocking',
+              skip: set_blocking_missing && 'put set_blocking.wad and set_blocking.lmp in spec/support' do
+        let(:lmp) { 'set_blocking.lmp' }
+        let(:pwad) { 'set_blocking.wad' }
+
+        it { is_expected.to eq(true) }
+      end
+    end
+
+    context 'without the sight cache' do
+      let(:toggle) { '-no_sight_cache' }
+
+      include_examples 'state hash demos'
+    end
+
+    # monster sound floods through the sector graph
+    context 'with the original sound recursion' do
+      let(:toggle) { '-no_sound_graph' }
+
+      include_examples 'state hash demos'
+    end
+
+    # P_CheckSector resuming its thing scan instead of restarting
+    context 'with the original sector thing scan' do
+      let(:toggle) { '-no_sector_scan_resume' }
+
+      include_examples 'state hash demos'
+    end
+
+    # thinkers come from block pools, so only their addresses change
+    context 'with thinkers allocated from the level zone' do
+      let(:toggle) { '-no_thinker_slabs' }
+
+      include_examples 'state hash demos'
+    end
+
+    # the REJECT builder is never used during demos
+    context 'with -reject' do
+      let(:toggle) { '-reject' }
+
+      include_examples 'state hash demos'
+    end
+  end
 end